@@ -17,6 +17,17 @@ isEqual(IFW_DISABLE_TRANSLATIONS, 1) {
     DEFINES += IFW_DISABLE_TRANSLATIONS
 }
 
+# Set IFW_ZSTD to 1 to build the Zstandard codec, it needs libzstd. IFW_ZSTD_INCLUDEPATH and
+# IFW_ZSTD_LIBS can be set if it is not found in the default locations.
+isEmpty(IFW_ZSTD): IFW_ZSTD = $$(IFW_ZSTD)
+isEqual(IFW_ZSTD, 1) {
+    DEFINES += IFW_ZSTD
+    isEmpty(IFW_ZSTD_INCLUDEPATH): IFW_ZSTD_INCLUDEPATH = $$(IFW_ZSTD_INCLUDEPATH)
+    isEmpty(IFW_ZSTD_LIBS): IFW_ZSTD_LIBS = $$(IFW_ZSTD_LIBS)
+    isEmpty(IFW_ZSTD_LIBS): IFW_ZSTD_LIBS = -lzstd
+    INCLUDEPATH += $$IFW_ZSTD_INCLUDEPATH
+}
+
 defineTest(minQtVersion) {
     maj = $$1
     min = $$2
@@ -142,6 +153,7 @@ DEFINES += NOMINMAX QT_NO_CAST_FROM_ASCII QT_STRICT_ITERATORS QT_USE_QSTRINGBUIL
 DEFINES += IFW_REPOSITORY_FORMAT_VERSION=$$IFW_REPOSITORY_FORMAT_VERSION
 
 LIBS += -l7z
+isEqual(IFW_ZSTD, 1): LIBS += $$IFW_ZSTD_LIBS
 win32-g++*: LIBS += -lmpr -luuid
 
 equals(TEMPLATE, app) {
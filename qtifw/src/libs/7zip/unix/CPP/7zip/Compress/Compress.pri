@@ -27,3 +27,12 @@ SOURCES += $$7ZIP_BASE/CPP/7zip/Compress/Bcj2Coder.cpp \
     $$7ZIP_BASE/CPP/7zip/Compress/LzmaDecoder.cpp \
     $$7ZIP_BASE/CPP/7zip/Compress/LzmaEncoder.cpp \
     $$7ZIP_BASE/CPP/7zip/Compress/LzmaRegister.cpp
+
+isEqual(IFW_ZSTD, 1) {
+    HEADERS += $$7ZIP_BASE/CPP/7zip/Compress/ZstdDecoder.h \
+        $$7ZIP_BASE/CPP/7zip/Compress/ZstdEncoder.h
+
+    SOURCES += $$7ZIP_BASE/CPP/7zip/Compress/ZstdDecoder.cpp \
+        $$7ZIP_BASE/CPP/7zip/Compress/ZstdEncoder.cpp \
+        $$7ZIP_BASE/CPP/7zip/Compress/ZstdRegister.cpp
+}
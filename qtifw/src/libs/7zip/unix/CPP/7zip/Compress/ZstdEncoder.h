@@ -0,0 +1,42 @@
+// ZstdEncoder.h
+
+#ifndef __ZSTD_ENCODER_H
+#define __ZSTD_ENCODER_H
+
+#include <zstd.h>
+
+#include "../../Common/MyCom.h"
+
+#include "../ICoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+class CEncoder:
+  public ICompressCoder,
+  public ICompressSetCoderProperties,
+  public ICompressWriteCoderProperties,
+  public CMyUnknownImp
+{
+  ZSTD_CCtx *_ctx;
+  Byte *_inBuf;
+  Byte *_outBuf;
+  size_t _inBufSize;
+  size_t _outBufSize;
+  UInt32 _level;
+  UInt32 _numThreads;
+public:
+  MY_UNKNOWN_IMP2(ICompressSetCoderProperties, ICompressWriteCoderProperties)
+
+  STDMETHOD(Code)(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+      const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress);
+  STDMETHOD(SetCoderProperties)(const PROPID *propIDs, const PROPVARIANT *props, UInt32 numProps);
+  STDMETHOD(WriteCoderProperties)(ISequentialOutStream *outStream);
+
+  CEncoder();
+  virtual ~CEncoder();
+};
+
+}}
+
+#endif
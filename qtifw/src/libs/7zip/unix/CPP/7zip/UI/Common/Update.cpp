@@ -651,7 +651,7 @@ static HRESULT Compress(
   CMyComPtr<IOutStream> outSeekStream;
   CMyComPtr<ISequentialOutStream> outStream;
 
-  if (!options.StdOutMode)
+  if (!options.StdOutMode && !options.OutStream)
   {
     FString dirPrefix;
     if (!GetOnlyDirPrefix(us2fs(archivePath.GetFinalPath()), dirPrefix))
@@ -664,7 +664,12 @@ static HRESULT Compress(
 
   if (options.VolumesSizes.Size() == 0)
   {
-    if (options.StdOutMode)
+    if (options.OutStream)
+    {
+      outSeekStream = options.OutStream;
+      outStream = outSeekStream;
+    }
+    else if (options.StdOutMode)
       outStream = new CStdOutFileStream;
     else
     {
@@ -709,7 +714,7 @@ static HRESULT Compress(
   }
   else
   {
-    if (options.StdOutMode)
+    if (options.StdOutMode || options.OutStream)
       return E_FAIL;
     if (arc && arc->GetGlobalOffset() > 0)
       return E_NOTIMPL;
@@ -1025,7 +1030,7 @@ HRESULT UpdateArchive(
   else
   {
     NFind::CFileInfo fi;
-    if (!fi.Find(us2fs(arcPath)))
+    if (options.OutStream || !fi.Find(us2fs(arcPath)))
     {
       if (renameMode)
         throw "can't find archive";;
@@ -1221,7 +1226,7 @@ HRESULT UpdateArchive(
 
   bool createTempFile = false;
 
-  if (!options.StdOutMode && options.UpdateArchiveItself)
+  if (!options.StdOutMode && !options.OutStream && options.UpdateArchiveItself)
   {
     CArchivePath &ap = options.Commands[0].ArchivePath;
     ap = options.ArchivePath;
@@ -1249,7 +1254,7 @@ HRESULT UpdateArchive(
       // ap.Temp = true;
       // ap.TempPrefix = tempDirPrefix;
     }
-    if (!options.StdOutMode &&
+    if (!options.StdOutMode && !options.OutStream &&
         (i > 0 || !createTempFile))
     {
       const FString path = us2fs(ap.GetFinalPath());
@@ -94,6 +94,7 @@ struct CUpdateOptions
   bool StdInMode;
   UString StdInFileName;
   bool StdOutMode;
+  IOutStream *OutStream; // not owned; if set, the archive is written to it
 
   bool EMailMode;
   bool EMailRemoveAfter;
@@ -124,6 +125,7 @@ struct CUpdateOptions
     OpenShareForWrite(false),
     StdInMode(false),
     StdOutMode(false),
+    OutStream(NULL),
     EMailMode(false),
     EMailRemoveAfter(false),
     PathMode(NWildcard::k_RelatPath),
@@ -0,0 +1,125 @@
+// ZstdDecoder.cpp
+
+#include "StdAfx.h"
+
+#include "../../../C/Alloc.h"
+
+#include "../Common/StreamUtils.h"
+
+#include "ZstdDecoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+CDecoder::CDecoder():
+    _stream(0),
+    _inBuf(0),
+    _outBuf(0),
+    _inBufSize(ZSTD_DStreamInSize()),
+    _outBufSize(ZSTD_DStreamOutSize()),
+    _inSizeProcessed(0),
+    _outSizeProcessed(0)
+{
+}
+
+CDecoder::~CDecoder()
+{
+  if (_stream)
+    ZSTD_freeDStream(_stream);
+  ::MidFree(_inBuf);
+  ::MidFree(_outBuf);
+}
+
+STDMETHODIMP CDecoder::SetDecoderProperties2(const Byte * /* data */, UInt32 size)
+{
+  // major and minor version, level, and two reserved bytes in newer encoders
+  if (size != 3 && size != 5)
+    return E_NOTIMPL;
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::GetInStreamProcessedSize(UInt64 *value)
+{
+  *value = _inSizeProcessed;
+  return S_OK;
+}
+
+STDMETHODIMP CDecoder::Code(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+    const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress)
+{
+  if (!_stream)
+  {
+    _stream = ZSTD_createDStream();
+    if (!_stream)
+      return E_OUTOFMEMORY;
+  }
+  if (!_inBuf)
+  {
+    _inBuf = (Byte *)::MidAlloc(_inBufSize);
+    _outBuf = (Byte *)::MidAlloc(_outBufSize);
+    if (!_inBuf || !_outBuf)
+      return E_OUTOFMEMORY;
+  }
+
+  if (ZSTD_isError(ZSTD_initDStream(_stream)))
+    return E_FAIL;
+
+  _inSizeProcessed = 0;
+  _outSizeProcessed = 0;
+
+  ZSTD_inBuffer in = { _inBuf, 0, 0 };
+  bool inputFinished = false;
+  size_t result = 0;
+
+  for (;;)
+  {
+    if (in.pos == in.size && !inputFinished)
+    {
+      UInt32 size = (UInt32)_inBufSize;
+      if (inSize && size > *inSize - _inSizeProcessed)
+        size = (UInt32)(*inSize - _inSizeProcessed);
+      UInt32 processed = 0;
+      if (size != 0)
+      {
+        RINOK(inStream->Read(_inBuf, size, &processed));
+      }
+      in.size = processed;
+      in.pos = 0;
+      inputFinished = (processed == 0);
+    }
+
+    ZSTD_outBuffer out = { _outBuf, _outBufSize, 0 };
+    const size_t inPos = in.pos;
+    result = ZSTD_decompressStream(_stream, &out, &in);
+    if (ZSTD_isError(result))
+      return S_FALSE;
+    _inSizeProcessed += in.pos - inPos;
+
+    size_t outProcessed = out.pos;
+    if (outSize && outProcessed > *outSize - _outSizeProcessed)
+      outProcessed = (size_t)(*outSize - _outSizeProcessed);
+    if (outProcessed != 0 && outStream)
+    {
+      RINOK(WriteStream(outStream, _outBuf, outProcessed));
+    }
+    _outSizeProcessed += outProcessed;
+
+    if (progress)
+    {
+      RINOK(progress->SetRatioInfo(&_inSizeProcessed, &_outSizeProcessed));
+    }
+
+    if (outSize && _outSizeProcessed == *outSize)
+      return S_OK;
+    // the decoder holds no more data and there is no more input
+    if (inputFinished && in.pos == in.size && out.pos < out.size)
+      break;
+  }
+
+  // input ended in the middle of a frame, or before the expected output size
+  if (result != 0 || outSize)
+    return S_FALSE;
+  return S_OK;
+}
+
+}}
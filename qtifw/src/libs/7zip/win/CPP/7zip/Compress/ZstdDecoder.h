@@ -0,0 +1,49 @@
+// ZstdDecoder.h
+
+#ifndef __ZSTD_DECODER_H
+#define __ZSTD_DECODER_H
+
+#include <zstd.h>
+
+#include "../../Common/MyCom.h"
+
+#include "../ICoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+/*
+  Decoder for the ZSTD method (0x4F71101) of 7-Zip ZS. The coder properties are
+  the zstd version and the compression level used by the encoder, they are not
+  needed for decoding.
+*/
+class CDecoder:
+  public ICompressCoder,
+  public ICompressSetDecoderProperties2,
+  public ICompressGetInStreamProcessedSize,
+  public CMyUnknownImp
+{
+  ZSTD_DStream *_stream;
+  Byte *_inBuf;
+  Byte *_outBuf;
+  size_t _inBufSize;
+  size_t _outBufSize;
+  UInt64 _inSizeProcessed;
+  UInt64 _outSizeProcessed;
+public:
+  MY_UNKNOWN_IMP2(
+      ICompressSetDecoderProperties2,
+      ICompressGetInStreamProcessedSize)
+
+  STDMETHOD(Code)(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+      const UInt64 *inSize, const UInt64 *outSize, ICompressProgressInfo *progress);
+  STDMETHOD(SetDecoderProperties2)(const Byte *data, UInt32 size);
+  STDMETHOD(GetInStreamProcessedSize)(UInt64 *value);
+
+  CDecoder();
+  virtual ~CDecoder();
+};
+
+}}
+
+#endif
@@ -0,0 +1,130 @@
+// ZstdEncoder.cpp
+
+#include "StdAfx.h"
+
+#include "../../../C/Alloc.h"
+
+#include "../Common/StreamUtils.h"
+
+#include "ZstdEncoder.h"
+
+namespace NCompress {
+namespace NZstd {
+
+// zstd levels for the 7-Zip levels 0 to 9. Levels above 19 need a lot of memory to
+// decompress and are not used.
+static const int kLevels[10] = { 1, 1, 2, 3, 5, 9, 12, 15, 17, 19 };
+
+CEncoder::CEncoder():
+    _ctx(0),
+    _inBuf(0),
+    _outBuf(0),
+    _inBufSize(ZSTD_CStreamInSize()),
+    _outBufSize(ZSTD_CStreamOutSize()),
+    _level(5),
+    _numThreads(1)
+{
+}
+
+CEncoder::~CEncoder()
+{
+  if (_ctx)
+    ZSTD_freeCCtx(_ctx);
+  ::MidFree(_inBuf);
+  ::MidFree(_outBuf);
+}
+
+STDMETHODIMP CEncoder::SetCoderProperties(const PROPID *propIDs,
+    const PROPVARIANT *coderProps, UInt32 numProps)
+{
+  for (UInt32 i = 0; i < numProps; i++)
+  {
+    const PROPVARIANT &prop = coderProps[i];
+    switch (propIDs[i])
+    {
+      case NCoderPropID::kLevel:
+        if (prop.vt != VT_UI4)
+          return E_INVALIDARG;
+        _level = prop.ulVal > 9 ? 9 : prop.ulVal;
+        break;
+      case NCoderPropID::kNumThreads:
+        if (prop.vt != VT_UI4)
+          return E_INVALIDARG;
+        _numThreads = prop.ulVal;
+        break;
+      default:
+        break;
+    }
+  }
+  return S_OK;
+}
+
+STDMETHODIMP CEncoder::WriteCoderProperties(ISequentialOutStream *outStream)
+{
+  // same layout as 7-Zip ZS: major and minor version, level, two reserved bytes
+  const Byte props[5] = { ZSTD_VERSION_MAJOR, ZSTD_VERSION_MINOR,
+      (Byte)kLevels[_level], 0, 0 };
+  return WriteStream(outStream, props, sizeof(props));
+}
+
+STDMETHODIMP CEncoder::Code(ISequentialInStream *inStream, ISequentialOutStream *outStream,
+    const UInt64 * /* inSize */, const UInt64 * /* outSize */, ICompressProgressInfo *progress)
+{
+  if (!_ctx)
+  {
+    _ctx = ZSTD_createCCtx();
+    if (!_ctx)
+      return E_OUTOFMEMORY;
+  }
+  if (!_inBuf)
+  {
+    _inBuf = (Byte *)::MidAlloc(_inBufSize);
+    _outBuf = (Byte *)::MidAlloc(_outBufSize);
+    if (!_inBuf || !_outBuf)
+      return E_OUTOFMEMORY;
+  }
+
+  ZSTD_CCtx_reset(_ctx, ZSTD_reset_session_and_parameters);
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(_ctx, ZSTD_c_compressionLevel, kLevels[_level])))
+    return E_INVALIDARG;
+  ZSTD_CCtx_setParameter(_ctx, ZSTD_c_checksumFlag, 1);
+  // fails if libzstd is built without multithreading support, it then compresses on one thread
+  if (_numThreads > 1)
+    ZSTD_CCtx_setParameter(_ctx, ZSTD_c_nbWorkers, (int)_numThreads);
+
+  UInt64 inProcessed = 0;
+  UInt64 outProcessed = 0;
+  bool finished = false;
+  while (!finished)
+  {
+    size_t size = _inBufSize;
+    RINOK(ReadStream(inStream, _inBuf, &size));
+    inProcessed += size;
+    const ZSTD_EndDirective mode = (size < _inBufSize) ? ZSTD_e_end : ZSTD_e_continue;
+
+    ZSTD_inBuffer in = { _inBuf, size, 0 };
+    for (;;)
+    {
+      ZSTD_outBuffer out = { _outBuf, _outBufSize, 0 };
+      const size_t remaining = ZSTD_compressStream2(_ctx, &out, &in, mode);
+      if (ZSTD_isError(remaining))
+        return E_FAIL;
+      if (out.pos != 0)
+      {
+        RINOK(WriteStream(outStream, _outBuf, out.pos));
+        outProcessed += out.pos;
+      }
+      if (mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size)
+        break;
+    }
+    finished = (mode == ZSTD_e_end);
+
+    if (progress)
+    {
+      RINOK(progress->SetRatioInfo(&inProcessed, &outProcessed));
+    }
+  }
+  return S_OK;
+}
+
+}}
@@ -638,7 +638,7 @@ static HRESULT Compress(
   CMyComPtr<IOutStream> outSeekStream;
   CMyComPtr<ISequentialOutStream> outStream;
 
-  if (!options.StdOutMode)
+  if (!options.StdOutMode && !options.OutStream)
   {
     FString dirPrefix;
     if (!GetOnlyDirPrefix(us2fs(archivePath.GetFinalPath()), dirPrefix))
@@ -651,7 +651,12 @@ static HRESULT Compress(
 
   if (options.VolumesSizes.Size() == 0)
   {
-    if (options.StdOutMode)
+    if (options.OutStream)
+    {
+      outSeekStream = options.OutStream;
+      outStream = outSeekStream;
+    }
+    else if (options.StdOutMode)
       outStream = new CStdOutFileStream;
     else
     {
@@ -696,7 +701,7 @@ static HRESULT Compress(
   }
   else
   {
-    if (options.StdOutMode)
+    if (options.StdOutMode || options.OutStream)
       return E_FAIL;
     if (arc && arc->GetGlobalOffset() > 0)
       return E_NOTIMPL;
@@ -1012,7 +1017,7 @@ HRESULT UpdateArchive(
   else
   {
     NFind::CFileInfo fi;
-    if (!fi.Find(us2fs(arcPath)))
+    if (options.OutStream || !fi.Find(us2fs(arcPath)))
     {
       if (renameMode)
         throw "can't find archive";;
@@ -1208,7 +1213,7 @@ HRESULT UpdateArchive(
 
   bool createTempFile = false;
 
-  if (!options.StdOutMode && options.UpdateArchiveItself)
+  if (!options.StdOutMode && !options.OutStream && options.UpdateArchiveItself)
   {
     CArchivePath &ap = options.Commands[0].ArchivePath;
     ap = options.ArchivePath;
@@ -1236,7 +1241,7 @@ HRESULT UpdateArchive(
       // ap.Temp = true;
       // ap.TempPrefix = tempDirPrefix;
     }
-    if (!options.StdOutMode &&
+    if (!options.StdOutMode && !options.OutStream &&
         (i > 0 || !createTempFile))
     {
       const FString path = us2fs(ap.GetFinalPath());
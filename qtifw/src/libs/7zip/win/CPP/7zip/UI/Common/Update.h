@@ -94,6 +94,7 @@ struct CUpdateOptions
   bool StdInMode;
   UString StdInFileName;
   bool StdOutMode;
+  IOutStream *OutStream; // not owned; if set, the archive is written to it
 
   bool EMailMode;
   bool EMailRemoveAfter;
@@ -122,6 +123,7 @@ struct CUpdateOptions
     SfxMode(false),
     StdInMode(false),
     StdOutMode(false),
+    OutStream(NULL),
     EMailMode(false),
     EMailRemoveAfter(false),
     OpenShareForWrite(false),
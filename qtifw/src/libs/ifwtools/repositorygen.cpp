@@ -289,6 +289,27 @@ void QInstallerTools::copyMetaData(const QString &_targetDir, const QString &met
             fileElement.setAttribute(QLatin1String("OS"), QLatin1String("Any"));
             update.appendChild(fileElement);
 
+            // record size and hash of each archive, so that the installer does not need
+            // to fetch the separate .sha1 files
+            QDomElement checksumsElement = doc.createElement(QLatin1String("ArchiveChecksums"));
+            foreach (const QString &filePath, info.copiedFiles) {
+                if (filePath.endsWith(QLatin1String(".sha1"), Qt::CaseInsensitive))
+                    continue;
+                QFile hashFile(filePath + QLatin1String(".sha1"));
+                if (!hashFile.open(QIODevice::ReadOnly))
+                    continue;
+                const QFileInfo archiveInfo(filePath);
+                QDomElement archiveElement = doc.createElement(QLatin1String("Archive"));
+                archiveElement.setAttribute(QLatin1String("name"),
+                    archiveInfo.fileName().mid(info.version.count()));
+                archiveElement.setAttribute(QLatin1String("size"), archiveInfo.size());
+                archiveElement.setAttribute(QLatin1String("sha1"),
+                    QString::fromLatin1(hashFile.readAll().trimmed()));
+                checksumsElement.appendChild(archiveElement);
+            }
+            if (checksumsElement.hasChildNodes())
+                update.appendChild(checksumsElement);
+
             root.appendChild(update);
 
             // copy script file
@@ -667,6 +688,23 @@ QHash<QString, QString> QInstallerTools::buildPathToVersionMapping(const Package
     return map;
 }
 
+/*
+    Creates the archive \a target from \a sources and returns the SHA1 checksum of the written
+    archive, so that the archive does not need to be opened again for hashing.
+*/
+static QByteArray createArchiveWithSha1(const QString &target, const QStringList &sources,
+    Lib7z::Method method = Lib7z::Method::Lzma2)
+{
+    QFile archive(target);
+    if (!archive.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        throw QInstaller::Error(QString::fromLatin1("Cannot open file \"%1\" for writing: %2")
+            .arg(QDir::toNativeSeparators(target), archive.errorString()));
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    Lib7z::createArchive(&archive, sources, Lib7z::Compression::Normal, method, 0, &hash);
+    return hash.result();
+}
+
 static void writeSHA1ToNodeWithName(QDomDocument &doc, QDomNodeList &list, const QByteArray &sha1sum,
     const QString &nodename = QString())
 {
@@ -812,12 +850,10 @@ void QInstallerTools::splitMetadata(const QStringList &entryList, const QString
         const QString versionPrefix = versionMapping[path];
         const QString fn = QLatin1String(versionPrefix.toLatin1() + "meta.7z");
         const QString tmpTarget = repoDir + QLatin1String("/") + fn;
-        Lib7z::createArchive(tmpTarget, QStringList() << absPath, Lib7z::TmpFile::No);
+        const QByteArray sha1Sum = createArchiveWithSha1(tmpTarget, QStringList() << absPath);
         // remove the files that got compressed
         QInstaller::removeFiles(absPath, true);
         QFile tmp(tmpTarget);
-        tmp.open(QFile::ReadOnly);
-        const QByteArray sha1Sum = QInstaller::calculateHash(&tmp, QCryptographicHash::Sha1);
         writeSHA1ToNodeWithName(doc, elements, sha1Sum, path);
         const QString finalTarget = absPath + QLatin1String("/") + fn;
         if (!tmp.rename(finalTarget)) {
@@ -829,7 +865,7 @@ void QInstallerTools::splitMetadata(const QStringList &entryList, const QString
 }
 
 void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QString &repoDir,
-    PackageInfoVector *const infos)
+    PackageInfoVector *const infos, Lib7z::Method method)
 {
     for (int i = 0; i < infos->count(); ++i) {
         const PackageInfo info = infos->at(i);
@@ -845,6 +881,7 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
         if (info.copiedFiles.isEmpty()) {
             QStringList compressedFiles;
             QStringList filesToCompress;
+            QHash<QString, QByteArray> archiveHashes;
             foreach (const QString &packageDir, packageDirs) {
                 const QDir dataDir(QString::fromLatin1("%1/%2/data").arg(packageDir, name));
                 foreach (const QString &entry, dataDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Files)) {
@@ -866,8 +903,8 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                     } else if (fileInfo.isDir()) {
                         qDebug() << "Compressing data directory" << entry;
                         QString target = QString::fromLatin1("%1/%3%2.7z").arg(namedRepoDir, entry, info.version);
-                        Lib7z::createArchive(target, QStringList() << dataDir.absoluteFilePath(entry),
-                            Lib7z::TmpFile::No);
+                        archiveHashes.insert(target, createArchiveWithSha1(target,
+                            QStringList() << dataDir.absoluteFilePath(entry), method));
                         compressedFiles.append(target);
                     } else if (fileInfo.isSymLink()) {
                         filesToCompress.append(dataDir.absoluteFilePath(entry));
@@ -879,7 +916,7 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                 qDebug() << "Compressing files found in data directory:" << filesToCompress;
                 QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, QLatin1String("content.7z"),
                     info.version);
-                Lib7z::createArchive(target, filesToCompress, Lib7z::TmpFile::No);
+                archiveHashes.insert(target, createArchiveWithSha1(target, filesToCompress, method));
                 compressedFiles.append(target);
             }
 
@@ -890,13 +927,16 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                 QFile archiveHashFile(archiveFile.fileName() + QLatin1String(".sha1"));
 
                 qDebug() << "Hash is stored in" << archiveHashFile.fileName();
-                qDebug() << "Creating hash of archive" << archiveFile.fileName();
 
                 try {
-                    QInstaller::openForRead(&archiveFile);
-                    const QByteArray hashOfArchiveData = QInstaller::calculateHash(&archiveFile,
-                        QCryptographicHash::Sha1).toHex();
-                    archiveFile.close();
+                    QByteArray hashOfArchiveData = archiveHashes.value(target).toHex();
+                    if (hashOfArchiveData.isEmpty()) {
+                        qDebug() << "Creating hash of archive" << archiveFile.fileName();
+                        QInstaller::openForRead(&archiveFile);
+                        hashOfArchiveData = QInstaller::calculateHash(&archiveFile,
+                            QCryptographicHash::Sha1).toHex();
+                        archiveFile.close();
+                    }
 
                     QInstaller::openForWrite(&archiveHashFile);
                     archiveHashFile.write(hashOfArchiveData);
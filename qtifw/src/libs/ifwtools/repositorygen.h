@@ -30,6 +30,7 @@
 #define REPOSITORYGEN_H
 
 #include "ifwtools_global.h"
+#include "lib7z_create.h"
 
 #include <QHash>
 #include <QString>
@@ -77,7 +78,8 @@ void splitMetadata(const QStringList &entryList, const QString &repoDir, QDomDoc
 
 void IFWTOOLS_EXPORT copyMetaData(const QString &outDir, const QString &dataDir, const PackageInfoVector &packages,
     const QString &appName, const QString& appVersion, const QStringList &uniteMetadatas);
-void IFWTOOLS_EXPORT copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos);
+void IFWTOOLS_EXPORT copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos,
+    Lib7z::Method method = Lib7z::Method::Lzma2);
 
 void IFWTOOLS_EXPORT filterNewComponents(const QString &repositoryDir, QInstallerTools::PackageInfoVector &packages);
 
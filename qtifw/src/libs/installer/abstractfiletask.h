@@ -46,6 +46,10 @@ enum TaskRole
     TargetFile,
     Name,
     ChecksumMismatch,
+    RequestHeaders,
+    ETag,
+    LastModified,
+    NotModified,
     UserRole = 1000
 };
 }
@@ -84,6 +88,7 @@ public:
     QByteArray checkSum() const { return value(TaskRole::Checksum).toByteArray(); }
     FileTaskItem taskItem() const { return value(TaskRole::TaskItem).value<FileTaskItem>(); }
     bool checksumMismatch() const { return value(TaskRole::ChecksumMismatch).toBool(); }
+    bool notModified() const { return value(TaskRole::NotModified).toBool(); }
 };
 
 class INSTALLER_EXPORT AbstractFileTask : public AbstractTask<FileTaskResult>
@@ -0,0 +1,264 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "archivecache.h"
+
+#include "globals.h"
+#include "lockfile.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#ifdef Q_OS_WIN
+#   include <qt_windows.h>
+#else
+#   include <unistd.h>
+#endif
+
+using namespace QInstaller;
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ArchiveCache
+    \internal
+    \brief The ArchiveCache class provides a content-addressed store for downloaded archives.
+
+    Archives are stored under the hex encoded SHA-1 of their content, so that the same archive is
+    found again regardless of the repository, component, or version it was downloaded for. The
+    cache may be shared by several installer processes. Lookups need no coordination, since files
+    only appear in the cache by an atomic rename. Modifications are serialized with a lock file;
+    if another process holds the lock, the modification is skipped.
+
+    The size of the cache is limited by removing the least recently used archives. Each lookup
+    that hits the cache marks the archive as used. Another process may evict an archive at any
+    time, archives that are used for an installation are therefore taken out of the cache with
+    fetch().
+*/
+
+static const QLatin1String scLockFileName("cache.lock");
+
+/*
+    Creates \a fileName as a hard link to \a original. Returns \c false if the file system does
+    not support hard links or the files are located on different file systems.
+*/
+static bool createHardLink(const QString &original, const QString &fileName)
+{
+#ifdef Q_OS_WIN
+    return CreateHardLinkW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(fileName)
+        .utf16()), reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(original).utf16()),
+        nullptr);
+#else
+    return ::link(QFile::encodeName(original).constData(),
+        QFile::encodeName(fileName).constData()) == 0;
+#endif
+}
+
+static bool hasChecksum(const QString &fileName, const QByteArray &sha1)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    return hash.addData(&file) && hash.result().toHex() == sha1.trimmed().toLower();
+}
+
+static void markUsed(const QString &fileName)
+{
+    // the modification time tracks the last use
+    QFile file(fileName);
+    if (file.open(QIODevice::Append))
+        file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+}
+
+/*!
+    Creates a cache located at \a path that holds at most \a maxSize bytes. A \a maxSize of \c 0
+    does not limit the size of the cache.
+*/
+ArchiveCache::ArchiveCache(const QString &path, qint64 maxSize)
+    : m_path(path)
+    , m_maxSize(maxSize)
+{
+    if (!m_path.isEmpty() && !QDir().mkpath(m_path)) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot create archive cache directory"
+            << QDir::toNativeSeparators(m_path);
+        m_path.clear();
+    }
+}
+
+/*!
+    Returns \c true if the cache has a usable location.
+*/
+bool ArchiveCache::isValid() const
+{
+    return !m_path.isEmpty();
+}
+
+/*!
+    Returns the path of the cached archive with the checksum \a sha1, or an empty string if the
+    cache does not hold it. The content of the archive is verified against \a sha1; a damaged
+    archive is removed from the cache.
+*/
+QString ArchiveCache::lookup(const QByteArray &sha1) const
+{
+    const QString fileName = cacheFileName(sha1);
+    if (fileName.isEmpty() || !QFileInfo::exists(fileName))
+        return QString();
+
+    if (!hasChecksum(fileName, sha1)) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Removing damaged archive"
+            << QDir::toNativeSeparators(fileName) << "from cache.";
+        QFile::remove(fileName);
+        return QString();
+    }
+    markUsed(fileName);
+    return fileName;
+}
+
+/*!
+    Places the cached archive with the checksum \a sha1 at \a fileName, replacing an existing
+    file. The archive is hard linked if \a fileName is located on the same file system as the
+    cache and copied otherwise, so that \a fileName stays intact when any process evicts the
+    archive from the cache afterwards. Returns \c false if the cache does not hold the archive.
+
+    The content of \a fileName is verified against \a sha1; a damaged archive is removed from
+    the cache. Since this reads the whole archive, the function is meant to be called from a
+    worker thread.
+*/
+bool ArchiveCache::fetch(const QByteArray &sha1, const QString &fileName) const
+{
+    const QString cached = cacheFileName(sha1);
+    if (cached.isEmpty())
+        return false;
+
+    QFile::remove(fileName);
+    if (!createHardLink(cached, fileName) && !QFile::copy(cached, fileName))
+        return false;
+
+    if (!hasChecksum(fileName, sha1)) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Removing damaged archive"
+            << QDir::toNativeSeparators(cached) << "from cache.";
+        QFile::remove(fileName);
+        QFile::remove(cached);
+        return false;
+    }
+    markUsed(cached);
+    return true;
+}
+
+/*!
+    Adds \a fileName to the cache under the checksum \a sha1 and removes the least recently
+    used archives if the cache grows beyond its maximum size. The file is hard linked into the
+    cache if possible and copied otherwise. Returns \c true if the cache holds
+    the archive afterwards. The caller is responsible for \a sha1 matching the content of
+    \a fileName. Since copying can take long, the function is meant to be called from a worker
+    thread; concurrent calls are serialized.
+*/
+bool ArchiveCache::insert(const QByteArray &sha1, const QString &fileName)
+{
+    const QString target = cacheFileName(sha1);
+    if (target.isEmpty())
+        return false;
+    QMutexLocker locker(&m_mutex);
+    if (QFileInfo::exists(target))
+        return true;
+
+    KDUpdater::LockFile lock(m_path + QLatin1Char('/') + scLockFileName);
+    if (!lock.lock())
+        return false;
+
+    const QString temporary = target + QLatin1String(".tmp");
+    QFile::remove(temporary);
+    const bool inserted = (createHardLink(fileName, temporary) || QFile::copy(fileName, temporary))
+        && QFile::rename(temporary, target);
+    if (!inserted) {
+        QFile::remove(temporary);
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot add"
+            << QDir::toNativeSeparators(fileName) << "to archive cache.";
+    } else {
+        markUsed(target);
+    }
+
+    removeLeastRecentlyUsed();
+    lock.unlock();
+    return inserted;
+}
+
+/*!
+    Removes the least recently used archives until the cache fits into its maximum size. Nothing
+    is removed if another process is modifying the cache.
+*/
+void ArchiveCache::evict()
+{
+    if (!isValid())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    KDUpdater::LockFile lock(m_path + QLatin1Char('/') + scLockFileName);
+    if (!lock.lock())
+        return;
+    removeLeastRecentlyUsed();
+    lock.unlock();
+}
+
+QString ArchiveCache::cacheFileName(const QByteArray &sha1) const
+{
+    static const QRegularExpression regExp(QLatin1String("^[0-9a-f]{40}$"));
+    const QString name = QString::fromLatin1(sha1.trimmed().toLower());
+    if (!isValid() || !regExp.match(name).hasMatch())
+        return QString();
+    return m_path + QLatin1Char('/') + name;
+}
+
+void ArchiveCache::removeLeastRecentlyUsed()
+{
+    if (m_maxSize <= 0)
+        return;
+
+    static const QRegularExpression regExp(QLatin1String("^[0-9a-f]{40}$"));
+    QFileInfoList archives;
+    qint64 size = 0;
+    foreach (const QFileInfo &info, QDir(m_path).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed)) {
+        if (!regExp.match(info.fileName()).hasMatch())
+            continue;
+        archives.append(info);
+        size += info.size();
+    }
+
+    // oldest first, archives that are in use on Windows cannot be removed and are skipped
+    foreach (const QFileInfo &info, archives) {
+        if (size <= m_maxSize)
+            break;
+        if (QFile::remove(info.absoluteFilePath()))
+            size -= info.size();
+    }
+}
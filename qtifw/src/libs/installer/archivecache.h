@@ -0,0 +1,69 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef ARCHIVECACHE_H
+#define ARCHIVECACHE_H
+
+#include "installer_global.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT ArchiveCache
+{
+    Q_DISABLE_COPY(ArchiveCache)
+
+public:
+    explicit ArchiveCache(const QString &path, qint64 maxSize = 0);
+
+    QString path() const { return m_path; }
+    qint64 maxSize() const { return m_maxSize; }
+    bool isValid() const;
+
+    QString lookup(const QByteArray &sha1) const;
+    bool fetch(const QByteArray &sha1, const QString &fileName) const;
+    bool insert(const QByteArray &sha1, const QString &fileName);
+    void evict();
+
+private:
+    QString cacheFileName(const QByteArray &sha1) const;
+    void removeLeastRecentlyUsed();
+
+private:
+    QString m_path;
+    qint64 m_maxSize;
+    QMutex m_mutex; // the lock file only serializes modifications of different processes
+};
+
+} // namespace QInstaller
+
+#endif // ARCHIVECACHE_H
@@ -63,6 +63,7 @@
 using namespace QInstaller;
 
 static const QLatin1String scScriptTag("Script");
+static const QLatin1String scPostLoadScript("PostLoadScript");
 static const QLatin1String scVirtual("Virtual");
 static const QLatin1String scInstalled("Installed");
 static const QLatin1String scUpdateText("UpdateText");
@@ -262,6 +263,9 @@ Component::~Component()
 {
     if (parentComponent() != 0)
         d->m_parentComponent->d->m_allChildComponents.removeAll(this);
+    // the component index must not keep a pointer to the deleted component
+    if (d->m_core)
+        d->m_core->invalidateComponentIndex();
 
     //why can we delete all create operations if the component gets destroyed
     if (!d->m_newlyInstalled)
@@ -332,6 +336,8 @@ void Component::loadDataFromPackage(const Package &package)
     setValue(scRequiresAdminRights, package.data(scRequiresAdminRights).toString());
 
     setValue(scScriptTag, package.data(scScriptTag).toString());
+    if (package.data(scPostLoadScript, false).toBool())
+        setValue(scPostLoadScript, scTrue);
     setValue(scReplaces, package.data(scReplaces).toString());
     setValue(scReleaseDate, package.data(scReleaseDate).toString());
     setValue(scCheckable, package.data(scCheckable).toString());
@@ -356,6 +362,11 @@ void Component::loadDataFromPackage(const Package &package)
     QHash<QString, QVariant> licenseHash = package.data(QLatin1String("Licenses")).toHash();
     if (!licenseHash.isEmpty())
         loadLicenses(QString::fromLatin1("%1/%2/").arg(localTempPath(), name()), licenseHash);
+    const QHash<QString, QVariant> archiveChecksums = package.data(scArchiveChecksums).toHash();
+    for (QHash<QString, QVariant>::const_iterator it = archiveChecksums.constBegin();
+            it != archiveChecksums.constEnd(); ++it) {
+        d->m_archiveChecksums.insert(it.key(), it.value().toMap());
+    }
     QVariant operationsVariant = package.data(QLatin1String("Operations"));
     if (operationsVariant.canConvert<QList<QPair<QString, QVariant>>>())
         m_operationsList = operationsVariant.value<QList<QPair<QString, QVariant>>>();
@@ -426,8 +437,10 @@ void Component::setValue(const QString &key, const QString &value)
     if (key == scDefault && d->m_core->noDefaultInstallation())
         normalizedValue = scFalse;
 
-    if (key == scName)
+    if (key == scName) {
         d->m_componentName = normalizedValue;
+        d->m_core->invalidateComponentIndex();
+    }
     if (key == scCheckable)
         this->setCheckable(normalizedValue.toLower() == scTrue);
     if (key == scExpandedByDefault)
@@ -484,6 +497,7 @@ void Component::appendComponent(Component *component)
         parent->removeComponent(component);
     component->d->m_parentComponent = this;
     setTristate(d->m_childComponents.count() > 0);
+    d->m_core->invalidateComponentIndex();
 }
 
 /*!
@@ -496,6 +510,7 @@ void Component::removeComponent(Component *component)
         component->d->m_parentComponent = 0;
         d->m_childComponents.removeAll(component);
         d->m_allChildComponents.removeAll(component);
+        d->m_core->invalidateComponentIndex();
     }
 }
 
@@ -545,13 +560,20 @@ QString Component::treeName() const
 }
 
 /*!
-    Loads the component script into the script engine.
+    Loads the component script into the script engine. If the script is marked to be loaded
+    post load, it is only loaded when the component first calls into it.
 */
 void Component::loadComponentScript()
 {
     const QString script = d->m_vars.value(scScriptTag);
-    if (!localTempPath().isEmpty() && !script.isEmpty())
-        loadComponentScript(QString::fromLatin1("%1/%2/%3").arg(localTempPath(), name(), script));
+    if (localTempPath().isEmpty() || script.isEmpty())
+        return;
+
+    const QString fileName = QString::fromLatin1("%1/%2/%3").arg(localTempPath(), name(), script);
+    if (d->m_vars.value(scPostLoadScript) == scTrue)
+        d->m_postLoadScriptFileName = fileName;
+    else
+        loadComponentScript(fileName);
 }
 
 /*!
@@ -564,6 +586,8 @@ void Component::loadComponentScript()
 */
 void Component::loadComponentScript(const QString &fileName)
 {
+    d->m_postLoadScriptFileName.clear();
+
     // introduce the component object as javascript value and call the name to check that it
     // was successful
     try {
@@ -597,7 +621,8 @@ void Component::loadComponentScript(const QString &fileName)
 /*!
     \internal
     Calls the script method retranslateUi(), if any. This is done whenever a
-    QTranslator file is being loaded.
+    QTranslator file is being loaded. Post load scripts not loaded yet are translated once they
+    get loaded.
 */
 void Component::languageChanged()
 {
@@ -802,7 +827,7 @@ void Component::createOperationsForPath(const QString &path)
         return;
 
     // the script can override this method
-    if (!d->scriptEngine()->callScriptMethod(d->m_scriptContext,
+    if (!d->scriptEngine()->callScriptMethod(d->scriptContext(),
         QLatin1String("createOperationsForPath"), QJSValueList() << path).isUndefined()) {
             return;
     }
@@ -848,7 +873,7 @@ void Component::createOperationsForArchive(const QString &archive)
         return;
 
     // the script can override this method
-    if (!d->scriptEngine()->callScriptMethod(d->m_scriptContext,
+    if (!d->scriptEngine()->callScriptMethod(d->scriptContext(),
         QLatin1String("createOperationsForArchive"), QJSValueList() << archive).isUndefined()) {
             return;
     }
@@ -872,7 +897,7 @@ void Component::createOperationsForArchive(const QString &archive)
 void Component::beginInstallation()
 {
     // the script can override this method
-    d->scriptEngine()->callScriptMethod(d->m_scriptContext, QLatin1String("beginInstallation"));
+    d->scriptEngine()->callScriptMethod(d->scriptContext(), QLatin1String("beginInstallation"));
 }
 
 /*!
@@ -882,7 +907,7 @@ void Component::beginInstallation()
 void Component::createOperations()
 {
     // the script can override this method
-    if (!d->scriptEngine()->callScriptMethod(d->m_scriptContext, QLatin1String("createOperations"))
+    if (!d->scriptEngine()->callScriptMethod(d->scriptContext(), QLatin1String("createOperations"))
         .isUndefined()) {
             d->m_operationsCreated = true;
             return;
@@ -965,6 +990,36 @@ QStringList Component::downloadableArchives() const
     return d->m_downloadableArchives;
 }
 
+static QString versionFreeArchiveName(const QString &archive, const QString &version)
+{
+    if (!version.isEmpty() && archive.startsWith(version))
+        return archive.mid(version.length());
+    return archive;
+}
+
+/*!
+    Returns the hex encoded SHA-1 checksum of the downloadable archive \a archive as recorded in
+    the repository metadata, or an empty byte array if the repository does not provide it.
+    \a archive may contain the component version as prefix, as returned by downloadableArchives().
+*/
+QByteArray Component::archiveSha1(const QString &archive) const
+{
+    const QString name = versionFreeArchiveName(archive, d->m_vars.value(scVersion));
+    return d->m_archiveChecksums.value(name).value(QLatin1String("sha1")).toString().toLatin1();
+}
+
+/*!
+    Returns the size in bytes of the downloadable archive \a archive as recorded in the repository
+    metadata, or \c -1 if the repository does not provide it.
+*/
+qint64 Component::archiveSize(const QString &archive) const
+{
+    const QString name = versionFreeArchiveName(archive, d->m_vars.value(scVersion));
+    bool ok = false;
+    const qint64 size = d->m_archiveChecksums.value(name).value(QLatin1String("size")).toLongLong(&ok);
+    return ok ? size : -1;
+}
+
 /*!
     Adds a request for quitting the process \a process before installing, updating, or uninstalling
     the component.
@@ -1292,7 +1347,7 @@ void Component::setValidatorCallbackName(const QString &name)
 bool Component::validatePage()
 {
     if (!validatorCallbackName.isEmpty())
-        return d->scriptEngine()->callScriptMethod(d->m_scriptContext, validatorCallbackName).toBool();
+        return d->scriptEngine()->callScriptMethod(d->scriptContext(), validatorCallbackName).toBool();
     return true;
 }
 
@@ -1404,7 +1459,7 @@ bool Component::isDefault() const
     if (d->m_vars.value(scDefault).compare(scScript, Qt::CaseInsensitive) == 0) {
         QJSValue valueFromScript;
         try {
-            valueFromScript = d->scriptEngine()->callScriptMethod(d->m_scriptContext,
+            valueFromScript = d->scriptEngine()->callScriptMethod(d->scriptContext(),
                 QLatin1String("isDefault"));
         } catch (const Error &error) {
             MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
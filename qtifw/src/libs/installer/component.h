@@ -150,6 +150,8 @@ public:
     QStringList downloadableArchives() const;
     Q_INVOKABLE void addDownloadableArchive(const QString &path);
     Q_INVOKABLE void removeDownloadableArchive(const QString &path);
+    QByteArray archiveSha1(const QString &archive) const;
+    qint64 archiveSize(const QString &archive) const;
 
     QStringList stopProcessForUpdateRequests() const;
     Q_INVOKABLE void addStopProcessForUpdateRequest(const QString &process);
@@ -77,6 +77,17 @@ ScriptEngine *ComponentPrivate::scriptEngine() const
     return m_core->componentScriptEngine();
 }
 
+/*!
+    Returns the context of the component script, loading a post load script first if it was not
+    loaded yet.
+*/
+QJSValue ComponentPrivate::scriptContext()
+{
+    if (!m_postLoadScriptFileName.isEmpty())
+        q->loadComponentScript(m_postLoadScriptFileName);
+    return m_scriptContext;
+}
+
 // -- ComponentModelHelper
 
 ComponentModelHelper::ComponentModelHelper()
@@ -51,6 +51,7 @@ public:
     ~ComponentPrivate();
 
     ScriptEngine *scriptEngine() const;
+    QJSValue scriptContext();
 
     PackageManagerCore *m_core;
     Component *m_parentComponent;
@@ -69,6 +70,7 @@ public:
     QUrl m_repositoryUrl;
     QString m_localTempPath;
     QJSValue m_scriptContext;
+    QString m_postLoadScriptFileName; // script that is loaded on first use
     QHash<QString, QString> m_vars;
     QList<Component*> m_childComponents;
     QList<Component*> m_allChildComponents;
@@ -78,6 +80,8 @@ public:
 
     // < display name, < file name, file content > >
     QHash<QString, QVariantMap> m_licenses;
+    // < archive name, < size, sha1 > >
+    QHash<QString, QVariantMap> m_archiveChecksums;
     QList<QPair<QString, bool> > m_pathsForUninstallation;
 };
 
@@ -67,6 +67,7 @@ static const QLatin1String scUncompressedSizeSum("UncompressedSizeSum");
 static const QLatin1String scRequiresAdminRights("RequiresAdminRights");
 static const QLatin1String scOfflineBinaryName("OfflineBinaryName");
 static const QLatin1String scSHA1("SHA1");
+static const QLatin1String scArchiveChecksums("ArchiveChecksums");
 
 // constants used throughout the components class
 static const QLatin1String scVirtual("Virtual");
@@ -105,6 +106,14 @@ static const QLatin1String scSupportsModify("SupportsModify");
 static const QLatin1String scAllowUnstableComponents("AllowUnstableComponents");
 static const QLatin1String scSaveDefaultRepositories("SaveDefaultRepositories");
 static const QLatin1String scRepositoryCategoryDisplayName("RepositoryCategoryDisplayName");
+static const QLatin1String scMaxConcurrentDownloads("MaxConcurrentDownloads");
+static const QLatin1String scMaxSegmentsPerDownload("MaxSegmentsPerDownload");
+static const QLatin1String scArchiveCacheDirectory("ArchiveCacheDirectory");
+static const QLatin1String scArchiveCacheSize("ArchiveCacheSize");
+static const QLatin1String scPipelinedInstallation("PipelinedInstallation");
+static const QLatin1String scMaxConcurrentExtractions("MaxConcurrentExtractions");
+static const QLatin1String scArchiveDecoderThreads("ArchiveDecoderThreads");
+static const QLatin1String scDeduplicateFiles("DeduplicateFiles");
 static const QLatin1String scHighDpi("@2x.");
 static const QLatin1String scWatermark("Watermark");
 static const QLatin1String scBanner("Banner");
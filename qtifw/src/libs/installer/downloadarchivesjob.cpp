@@ -27,21 +27,32 @@
 **************************************************************************/
 #include "downloadarchivesjob.h"
 
+#include "archivecache.h"
 #include "binaryformatenginehandler.h"
 #include "component.h"
+#include "fileutils.h"
+#include "globals.h"
 #include "messageboxhandler.h"
+#include "mirrorselector.h"
 #include "packagemanagercore.h"
 #include "utils.h"
 
 #include "filedownloader.h"
 #include "filedownloaderfactory.h"
 
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QTimerEvent>
 
+#include <QtConcurrentRun>
+
 using namespace QInstaller;
 using namespace KDUpdater;
 
+// A download that stays below a quarter of its peak speed this long switches to the next mirror.
+static const qint64 scSlowDownloadTimeout = 15000;
+
 
 /*!
     Creates a new DownloadArchivesJob with parent \a core.
@@ -49,11 +60,15 @@ using namespace KDUpdater;
 DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
     : Job(core)
     , m_core(core)
-    , m_downloader(nullptr)
     , m_archivesDownloaded(0)
     , m_archivesToDownloadCount(0)
+    , m_maxConcurrentDownloads(1)
+    , m_maxSegmentsPerDownload(1)
+    , m_mirrorSelector(nullptr)
+    , m_retryPromptVisible(false)
     , m_canceled(false)
-    , m_lastFileProgress(0)
+    , m_finished(false)
+    , m_inFlightProgress(0)
     , m_progressChangedTimerId(0)
 {
     setCapabilities(Cancelable);
@@ -64,8 +79,13 @@ DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
 */
 DownloadArchivesJob::~DownloadArchivesJob()
 {
-    if (m_downloader)
-        m_downloader->deleteLater();
+    abortDownloads();
+
+    // running cache lookups and inserts access the archive cache
+    foreach (QFutureWatcher<bool> *watcher, m_cacheLookups.keys() + m_cacheInserts.keys()) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+    }
 }
 
 /*!
@@ -79,112 +99,229 @@ void DownloadArchivesJob::setArchivesToDownload(const QList<QPair<QString, QStri
 }
 
 /*!
-    \reimp
+    Sets the maximum number of archives that are downloaded in parallel to \a count. A value
+    of \c 1 downloads the archives one after another.
 */
-void DownloadArchivesJob::doStart()
+void DownloadArchivesJob::setMaxConcurrentDownloads(int count)
 {
-    m_archivesDownloaded = 0;
-    fetchNextArchiveHash();
+    m_maxConcurrentDownloads = qMax(1, count);
 }
 
 /*!
-    \reimp
+    Sets the maximum number of connections used to download a single archive to \a count. Only
+    archives that exceed the segment threshold of the downloader are split.
 */
-void DownloadArchivesJob::doCancel()
+void DownloadArchivesJob::setMaxSegmentsPerDownload(int count)
 {
-    m_canceled = true;
-    if (m_downloader != nullptr)
-        m_downloader->cancelDownload();
+    m_maxSegmentsPerDownload = qMax(1, count);
 }
 
-void DownloadArchivesJob::fetchNextArchiveHash()
+/*!
+    Sets the archive \a cache that is consulted before an archive is downloaded. Downloaded
+    archives are added to it. The job takes ownership of \a cache.
+*/
+void DownloadArchivesJob::setArchiveCache(ArchiveCache *cache)
 {
-    if (m_core->testChecksum()) {
-        if (m_canceled) {
-            finishWithError(tr("Canceled"));
-            return;
-        }
-
-        if (m_archivesToDownload.isEmpty()) {
-            emitFinished();
-            return;
-        }
+    m_cache.reset(cache);
+}
 
-        if (m_downloader)
-            m_downloader->deleteLater();
+/*!
+    Returns \c true if \a archive has been downloaded and registered in the installer's file
+    system. This allows to install components while later archives are still downloading.
 
-        m_downloader = setupDownloader(QLatin1String(".sha1"));
-        if (!m_downloader) {
-            m_archivesToDownload.removeFirst();
-            QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-            return;
-        }
+    \sa archiveRegistered()
+*/
+bool DownloadArchivesJob::isArchiveRegistered(const QString &archive) const
+{
+    return m_registeredArchives.contains(archive);
+}
 
-        connect(m_downloader, &FileDownloader::downloadCompleted,
-                this, &DownloadArchivesJob::finishedHashDownload, Qt::QueuedConnection);
-        m_downloader->download();
-    } else {
-        QMetaObject::invokeMethod(this, "fetchNextArchive", Qt::QueuedConnection);
-    }
+/*!
+    Sets the directory where partially downloaded archives are kept to \a directory. Downloads
+    that are interrupted, for example because the installer was closed, continue from there
+    the next time the archive is requested. An empty \a directory disables resuming across
+    sessions.
+*/
+void DownloadArchivesJob::setResumeDirectory(const QString &directory)
+{
+    m_resumeDirectory = directory;
 }
 
-void DownloadArchivesJob::finishedHashDownload()
+/*!
+    \reimp
+*/
+void DownloadArchivesJob::doStart()
 {
-    Q_ASSERT(m_downloader != nullptr);
+    m_archivesDownloaded = 0;
+    removeStalePartialDownloads();
+    fetchNextArchives();
+}
 
-    QFile sha1HashFile(m_downloader->downloadedFileName());
-    if (sha1HashFile.open(QFile::ReadOnly)) {
-        m_currentHash = sha1HashFile.readAll();
-        fetchNextArchive();
-    } else {
-        finishWithError(tr("Downloading hash signature failed."));
-    }
+/*!
+    \reimp
+*/
+void DownloadArchivesJob::doCancel()
+{
+    m_canceled = true;
+    m_finished = true;
+    abortDownloads();
 }
 
 /*!
-    Fetches the next archive and registers it in the installer.
+    Fills the free download slots with the next archives from the queue. If checksum testing
+    is enabled, the hash of an archive is fetched before the archive itself.
 */
-void DownloadArchivesJob::fetchNextArchive()
+void DownloadArchivesJob::fetchNextArchives()
 {
+    if (m_finished)
+        return;
+
     if (m_canceled) {
         finishWithError(tr("Canceled"));
         return;
     }
 
-    if (m_archivesToDownload.isEmpty()) {
+    while (m_downloads.count() + m_cacheLookups.count() + m_cacheInserts.count()
+            < m_maxConcurrentDownloads
+            && !m_archivesToDownload.isEmpty()) {
+        ArchiveDownload download;
+        download.archive = m_archivesToDownload.takeFirst();
+        // Repositories created by newer versions of repogen record the checksum of each
+        // archive in Updates.xml, older ones only provide a separate .sha1 file.
+        download.hash = archiveHashFromMetadata(download.archive.first);
+        if (m_core->testChecksum() && download.hash.isEmpty())
+            fetchArchiveHash(download);
+        else
+            fetchFromCache(download);
+    }
+
+    if (m_downloads.isEmpty() && m_cacheLookups.isEmpty() && m_cacheInserts.isEmpty()
+            && m_archivesToDownload.isEmpty()) {
+        m_finished = true;
         emitFinished();
-        return;
     }
+}
 
-    if (m_downloader != nullptr)
-        m_downloader->deleteLater();
+/*!
+    Returns the expected SHA-1 checksum of \a archive as recorded in the metadata of its
+    component, or an empty byte array if the repository does not provide it.
+*/
+QByteArray DownloadArchivesJob::archiveHashFromMetadata(const QString &archive) const
+{
+    const QFileInfo fi(archive);
+    const Component *const component = m_core->componentByName(PackageManagerCore::checkableName(QFileInfo(fi.path()).fileName()));
+    if (!component)
+        return QByteArray();
+    return component->archiveSha1(fi.fileName());
+}
+
+/*!
+    Fetches the checksum of the archive described by \a download. Returns \c false if the
+    download cannot be started.
+*/
+bool DownloadArchivesJob::fetchArchiveHash(const ArchiveDownload &download)
+{
+    FileDownloader *const downloader = setupDownloader(download, QLatin1String(".sha1"));
+    if (!downloader)
+        return false;
+
+    ArchiveDownload hashDownload = download;
+    hashDownload.hashDownload = true;
+    m_downloads.insert(downloader, hashDownload);
+    connect(downloader, &FileDownloader::downloadCompleted,
+            this, &DownloadArchivesJob::finishedHashDownload, Qt::QueuedConnection);
+    downloader->download();
+    return true;
+}
+
+void DownloadArchivesJob::finishedHashDownload()
+{
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (m_finished || !m_downloads.contains(downloader))
+        return;
 
-    m_downloader = setupDownloader(QString(), m_core->value(scUrlQueryString));
-    if (!m_downloader) {
-        m_archivesToDownload.removeFirst();
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
+    ArchiveDownload download = m_downloads.value(downloader);
+    QFile sha1HashFile(downloader->downloadedFileName());
+    if (!sha1HashFile.open(QFile::ReadOnly)) {
+        finishWithError(tr("Downloading hash signature failed."));
         return;
     }
+    download.hash = sha1HashFile.readAll();
+    download.hashDownload = false;
+    removeDownload(downloader);
 
-    emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-    connect(m_downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
-    connect(m_downloader, &FileDownloader::downloadCompleted,
+    fetchFromCache(download);
+    fetchNextArchives();
+}
+
+/*!
+    Fetches the archive described by \a download. The archive gets registered in the installer
+    once the download has finished. Returns \c false if the download cannot be started.
+*/
+bool DownloadArchivesJob::fetchArchive(const ArchiveDownload &download)
+{
+    FileDownloader *const downloader = setupDownloader(download, QString(),
+        m_core->value(scUrlQueryString));
+    if (!downloader)
+        return false;
+
+    ArchiveDownload archiveDownload = download;
+    archiveDownload.startTime = QDateTime::currentMSecsSinceEpoch();
+    m_downloads.insert(downloader, archiveDownload);
+    emit progressChanged(totalProgress());
+    connect(downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
+    connect(downloader, &FileDownloader::downloadSpeed, this, &DownloadArchivesJob::checkDownloadSpeed);
+    connect(downloader, &FileDownloader::downloadCompleted,
             this, &DownloadArchivesJob::registerFile, Qt::QueuedConnection);
 
-    m_downloader->download();
+    downloader->download();
+    return true;
 }
 
 /*!
-    Emits the global download \a progress during a single download in a lazy way (uses a timer to reduce to
-    much processChanged).
+    Updates the download \a progress of the sending downloader and emits the global download
+    progress in a lazy way (uses a timer to reduce to much processChanged).
 */
 void DownloadArchivesJob::emitDownloadProgress(double progress)
 {
-    m_lastFileProgress = progress;
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    QHash<FileDownloader *, ArchiveDownload>::iterator it = m_downloads.find(downloader);
+    if (it == m_downloads.end())
+        return;
+
+    m_inFlightProgress += progress - it->progress;
+    it->progress = progress;
     if (!m_progressChangedTimerId)
         m_progressChangedTimerId = startTimer(5);
 }
 
+/*!
+    Switches the sending downloader to the next mirror if its speed stays below a quarter of
+    the peak speed \a bytesPerSecond has reached so far for a while, which usually means that
+    the mirror got overloaded or the route to it degraded.
+*/
+void DownloadArchivesJob::checkDownloadSpeed(qint64 bytesPerSecond)
+{
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    QHash<FileDownloader *, ArchiveDownload>::iterator it = m_downloads.find(downloader);
+    if (it == m_downloads.end())
+        return;
+
+    it->peakSpeed = qMax(it->peakSpeed, bytesPerSecond);
+    if (bytesPerSecond * 4 >= it->peakSpeed) {
+        it->slowSince = -1;
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (it->slowSince < 0)
+        it->slowSince = now;
+    else if (now - it->slowSince >= scSlowDownloadTimeout && it->progress < 0.9) {
+        switchToNextMirror(downloader, tr("Download speed dropped to %1/s.")
+            .arg(humanReadableSize(bytesPerSecond)));
+    }
+}
+
 /*!
     This is used to reduce the \c progressChanged signals for \a event.
 */
@@ -193,93 +330,370 @@ void DownloadArchivesJob::timerEvent(QTimerEvent *event)
     if (event->timerId() == m_progressChangedTimerId) {
         killTimer(m_progressChangedTimerId);
         m_progressChangedTimerId = 0;
-        emit progressChanged((double(m_archivesDownloaded) + m_lastFileProgress) / m_archivesToDownloadCount);
+        emit progressChanged(totalProgress());
     }
 }
 
 /*!
-    Registers the just downloaded file in the installer's file system.
+    Registers the just downloaded file in the installer's file system. Files are registered in
+    the order their downloads complete. If an archive cache is set, the file is added to it in a
+    worker thread first, which occupies the download slot until it has finished.
 */
 void DownloadArchivesJob::registerFile()
 {
-    Q_ASSERT(m_downloader != nullptr);
-
-    if (m_canceled)
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (m_canceled || m_finished || !m_downloads.contains(downloader))
         return;
 
-    if (m_core->testChecksum() && m_currentHash != m_downloader->sha1Sum().toHex()) {
+    const ArchiveDownload download = m_downloads.value(downloader);
+    if (m_core->testChecksum() && download.hash != downloader->sha1Sum().toHex()) {
         //TODO: Maybe we should try to download the file again automatically
-        const QMessageBox::Button res =
-            MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
-            QLatin1String("DownloadError"), tr("Download Error"), tr("Hash verification while "
-            "downloading failed. This is a temporary error, please retry."),
-            QMessageBox::Retry | QMessageBox::Cancel, QMessageBox::Cancel);
-
-        // If run from command line instance, do not continue if hash verification failed.
-        // Same download is tried again and again causing infinite loop if hash not
-        // fixed to repositories.
-        if (res == QMessageBox::Cancel || m_core->isCommandLineInstance()) {
-            finishWithError(tr("Cannot verify Hash"));
-            return;
-        }
-    } else {
-        ++m_archivesDownloaded;
-        if (m_progressChangedTimerId) {
-            killTimer(m_progressChangedTimerId);
-            m_progressChangedTimerId = 0;
-            emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-        }
+        const FailedDownload failed = { downloader, QLatin1String("DownloadError"),
+            tr("Hash verification while downloading failed. This is a temporary error, "
+            "please retry."), true };
+        promptForRetry(failed);
+        return;
+    }
 
-        const QPair<QString, QString> pair = m_archivesToDownload.takeFirst();
-        BinaryFormatEngineHandler::instance()->registerResource(pair.first,
-            m_downloader->downloadedFileName());
+    ++m_archivesDownloaded;
+    const QString fileName = downloader->downloadedFileName();
+    if (m_mirrorSelector && m_mirrorSelector->mirrorCount(download.archive.second) > 1) {
+        const qint64 elapsed = qMax<qint64>(1, QDateTime::currentMSecsSinceEpoch() - download.startTime);
+        qCDebug(QInstaller::lcInstallerInstallLog).noquote() << "Downloaded"
+            << QFileInfo(fileName).fileName() << "from" << downloader->url().host() << "at"
+            << humanReadableSize(QFileInfo(fileName).size() * 1000 / elapsed) + QLatin1String("/s");
     }
-    fetchNextArchiveHash();
+    const QByteArray hash = downloader->sha1Sum().toHex();
+    removeDownload(downloader);
+    if (m_progressChangedTimerId) {
+        killTimer(m_progressChangedTimerId);
+        m_progressChangedTimerId = 0;
+    }
+    emit progressChanged(totalProgress());
+
+    if (m_cache) {
+        // copying the archive into the cache can take long if it is on another file system
+        QFutureWatcher<bool> *const watcher = new QFutureWatcher<bool>(this);
+        m_cacheInserts.insert(watcher, qMakePair(download.archive.first, fileName));
+        connect(watcher, &QFutureWatcherBase::finished, this,
+            &DownloadArchivesJob::cacheInsertFinished);
+        ArchiveCache *const cache = m_cache.data();
+        watcher->setFuture(QtConcurrent::run([cache, hash, fileName]() {
+            return cache->insert(hash, fileName);
+        }));
+        return;
+    }
+
+    BinaryFormatEngineHandler::instance()->registerResource(download.archive.first, fileName);
+    m_registeredArchives.insert(download.archive.first);
+    emit archiveRegistered(download.archive.first);
+    fetchNextArchives();
+}
+
+/*!
+    Registers the downloaded archive once it has been added to the archive cache.
+*/
+void DownloadArchivesJob::cacheInsertFinished()
+{
+    QFutureWatcher<bool> *const watcher = static_cast<QFutureWatcher<bool> *>(sender());
+    if (!m_cacheInserts.contains(watcher))
+        return;
+
+    const QPair<QString, QString> archive = m_cacheInserts.take(watcher);
+    watcher->deleteLater();
+    if (m_finished)
+        return;
+
+    BinaryFormatEngineHandler::instance()->registerResource(archive.first, archive.second);
+    m_registeredArchives.insert(archive.first);
+    emit archiveRegistered(archive.first);
+    fetchNextArchives();
 }
 
 void DownloadArchivesJob::downloadCanceled()
 {
-    emitFinishedWithError(Job::Canceled, m_downloader->errorString());
+    finishCanceled(qobject_cast<const FileDownloader *>(sender()));
 }
 
 void DownloadArchivesJob::downloadFailed(const QString &error)
 {
-    if (m_canceled)
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (m_canceled || m_finished || !m_downloads.contains(downloader))
         return;
 
-    const QMessageBox::StandardButton b =
-        MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
-        QLatin1String("archiveDownloadError"), tr("Download Error"), tr("Cannot download archive %1: %2")
-        .arg(m_archivesToDownload.first().second, error), QMessageBox::Retry | QMessageBox::Cancel);
+    if (switchToNextMirror(downloader, error))
+        return;
 
-    // Do not call fetchNextArchiveHash when using command line instance,
-    // installer tries to download the same archive causing infinite loop
-    if (b == QMessageBox::Retry && !m_core->isCommandLineInstance())
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-    else
-        downloadCanceled();
+    const FailedDownload failed = { downloader, QLatin1String("archiveDownloadError"),
+        tr("Cannot download archive %1: %2").arg(m_downloads.value(downloader).archive.second,
+        error), false };
+    promptForRetry(failed);
 }
 
 void DownloadArchivesJob::finishWithError(const QString &error)
 {
-    const FileDownloader *const dl = qobject_cast<const FileDownloader*> (sender());
+    const FileDownloader *dl = qobject_cast<const FileDownloader*> (sender());
+    if (!dl && !m_downloads.isEmpty())
+        dl = m_downloads.constBegin().key();
+    finishWithError(error, dl);
+}
+
+void DownloadArchivesJob::finishWithError(const QString &error, const FileDownloader *downloader)
+{
+    if (m_finished)
+        return;
+
     const QString msg = tr("Cannot fetch archives: %1\nError while loading %2");
-    if (dl != nullptr)
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, dl->url().toString()));
-    else
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, m_downloader->url().toString()));
+    const QString url = downloader ? downloader->url().toString() : QString();
+    m_finished = true;
+    abortDownloads();
+    emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, url));
+}
+
+void DownloadArchivesJob::finishCanceled(const FileDownloader *downloader)
+{
+    if (m_finished)
+        return;
+
+    const QString error = downloader ? downloader->errorString() : tr("Canceled");
+    m_finished = true;
+    abortDownloads();
+    emitFinishedWithError(Job::Canceled, error);
+}
+
+/*!
+    Asks the user whether the \a failed download should be retried. The message box runs its
+    own event loop, so further downloads can fail while it is shown. Their prompts are queued
+    and shown one after another once the current one has been answered, instead of stacking
+    message boxes on top of each other. The failed downloads keep their download slot until
+    the user has answered.
+*/
+void DownloadArchivesJob::promptForRetry(const FailedDownload &failed)
+{
+    m_failedDownloads.append(failed);
+    if (m_retryPromptVisible)
+        return;
+
+    m_retryPromptVisible = true;
+    while (!m_finished && !m_failedDownloads.isEmpty()) {
+        const FailedDownload next = m_failedDownloads.takeFirst();
+        if (!m_downloads.contains(next.downloader))
+            continue;
+
+        const QMessageBox::StandardButton b =
+            MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
+            next.identifier, tr("Download Error"), next.message,
+            QMessageBox::Retry | QMessageBox::Cancel,
+            next.hashMismatch ? QMessageBox::Cancel : QMessageBox::NoButton);
+        if (m_finished || !m_downloads.contains(next.downloader))
+            break; // the job was canceled while the message box was shown
+
+        // Do not retry when using command line instance, installer tries to download the
+        // same archive causing infinite loop. Same for hash verification failures if the
+        // hash is not fixed in the repository.
+        if (b != QMessageBox::Retry || m_core->isCommandLineInstance()) {
+            if (next.hashMismatch)
+                finishWithError(tr("Cannot verify Hash"), next.downloader);
+            else
+                finishCanceled(next.downloader);
+            break;
+        }
+        retryDownload(next.downloader);
+    }
+    m_failedDownloads.clear();
+    m_retryPromptVisible = false;
+
+    if (!m_finished)
+        QMetaObject::invokeMethod(this, "fetchNextArchives", Qt::QueuedConnection);
+}
+
+/*!
+    Removes \a downloader from the running downloads and puts its archive back in front of the
+    download queue, so that it is fetched again with the next free download slot.
+*/
+void DownloadArchivesJob::retryDownload(FileDownloader *downloader)
+{
+    if (!m_downloads.contains(downloader))
+        return;
+
+    const QPair<QString, QString> archive = m_downloads.value(downloader).archive;
+    removeDownload(downloader);
+    m_archivesToDownload.prepend(archive);
+}
+
+/*!
+    Restarts the download of \a downloader from the next mirror of its repository and logs
+    \a reason. Returns \c false if there are no more mirrors to try. If the download cannot be
+    started from the next mirror, the job finishes with \a reason as error.
+*/
+bool DownloadArchivesJob::switchToNextMirror(FileDownloader *downloader, const QString &reason)
+{
+    if (!m_mirrorSelector || !m_downloads.contains(downloader))
+        return false;
+
+    ArchiveDownload download = m_downloads.value(downloader);
+    const QString nextUrl = m_mirrorSelector->mirrorUrl(download.archive.second, download.mirror + 1);
+    if (nextUrl.isEmpty())
+        return false;
+
+    qCWarning(QInstaller::lcInstallerInstallLog).noquote() << "Cannot download"
+        << downloader->url().toString() << "-" << reason << "Switching to mirror" << nextUrl;
+    removeDownload(downloader);
+
+    ++download.mirror;
+    download.progress = 0;
+    download.peakSpeed = 0;
+    download.slowSince = -1;
+    bool started = false;
+    if (download.hashDownload) {
+        download.hashDownload = false;
+        started = fetchArchiveHash(download);
+    } else {
+        started = fetchArchive(download);
+    }
+    if (!started) {
+        // nothing else would complete the job, setupDownloader() reported why the mirror failed
+        finishWithError(reason, downloader);
+        return true;
+    }
+    emit progressChanged(totalProgress());
+    return true;
+}
+
+/*!
+    Stops all running downloads without reporting their cancellation back to the job.
+*/
+void DownloadArchivesJob::abortDownloads()
+{
+    const QList<FileDownloader *> downloaders = m_downloads.keys();
+    m_downloads.clear();
+    m_inFlightProgress = 0;
+
+    foreach (FileDownloader *downloader, downloaders) {
+        downloader->disconnect(this);
+        downloader->cancelDownload();
+        downloader->deleteLater();
+    }
+}
+
+void DownloadArchivesJob::removeDownload(FileDownloader *downloader)
+{
+    m_inFlightProgress -= m_downloads.value(downloader).progress;
+    m_downloads.remove(downloader);
+    downloader->disconnect(this);
+    downloader->deleteLater();
+}
+
+double DownloadArchivesJob::totalProgress() const
+{
+    if (m_archivesToDownloadCount <= 0)
+        return 1;
+    return (double(m_archivesDownloaded) + m_inFlightProgress) / m_archivesToDownloadCount;
+}
+
+/*!
+    Takes the archive of \a download from the archive cache, or downloads it if the cache does
+    not hold an archive with the expected checksum. The archive is copied or linked to the same
+    location a download would use, so that evicting it from the cache does not affect the
+    installation. Since the checksum of the archive gets verified, the lookup runs in a worker
+    thread and occupies a download slot until it has finished.
+*/
+void DownloadArchivesJob::fetchFromCache(const ArchiveDownload &download)
+{
+    const QString fileName = localFileName(download);
+    if (!m_cache || download.hash.isEmpty() || fileName.isEmpty()) {
+        fetchArchive(download);
+        return;
+    }
+
+    QFutureWatcher<bool> *const watcher = new QFutureWatcher<bool>(this);
+    m_cacheLookups.insert(watcher, download);
+    connect(watcher, &QFutureWatcherBase::finished, this, &DownloadArchivesJob::cacheLookupFinished);
+
+    const ArchiveCache *const cache = m_cache.data();
+    const QByteArray hash = download.hash;
+    watcher->setFuture(QtConcurrent::run([cache, hash, fileName]() {
+        return cache->fetch(hash, fileName);
+    }));
+}
+
+/*!
+    Registers the archive taken from the archive cache, or starts downloading it if the cache
+    did not hold it.
+*/
+void DownloadArchivesJob::cacheLookupFinished()
+{
+    QFutureWatcher<bool> *const watcher = static_cast<QFutureWatcher<bool> *>(sender());
+    if (!m_cacheLookups.contains(watcher))
+        return;
+
+    const ArchiveDownload download = m_cacheLookups.take(watcher);
+    const bool cached = watcher->result();
+    watcher->deleteLater();
+    if (m_finished)
+        return;
+
+    if (!cached) {
+        fetchArchive(download);
+    } else {
+        emit outputTextChanged(tr("Using cached archive \"%1\".")
+            .arg(QFileInfo(download.archive.first).fileName()));
+        ++m_archivesDownloaded;
+        emit progressChanged(totalProgress());
+        BinaryFormatEngineHandler::instance()->registerResource(download.archive.first,
+            localFileName(download));
+        m_registeredArchives.insert(download.archive.first);
+        emit archiveRegistered(download.archive.first);
+    }
+    fetchNextArchives();
+}
+
+/*!
+    Returns the file name the archive of \a download is stored at locally, or an empty string if
+    its component cannot be found.
+*/
+QString DownloadArchivesJob::localFileName(const ArchiveDownload &download) const
+{
+    const QFileInfo fi = QFileInfo(download.archive.first);
+    const Component *const component = m_core->componentByName(PackageManagerCore::checkableName(QFileInfo(fi.path()).fileName()));
+    if (!component)
+        return QString();
+    return component->localTempPath() + QLatin1Char('/') + component->name() + QLatin1Char('/')
+        + fi.fileName();
+}
+
+/*!
+    Removes partial downloads from the resume directory that have not been touched for two
+    weeks, as the archives they belong to are most likely not requested anymore.
+*/
+void DownloadArchivesJob::removeStalePartialDownloads()
+{
+    if (m_resumeDirectory.isEmpty())
+        return;
+
+    const QDateTime expiry = QDateTime::currentDateTime().addDays(-14);
+    const QFileInfoList entries = QDir(m_resumeDirectory).entryInfoList(QStringList()
+        << QLatin1String("*.part") << QLatin1String("*.part.state"), QDir::Files);
+    foreach (const QFileInfo &entry, entries) {
+        if (entry.lastModified() < expiry)
+            QFile::remove(entry.absoluteFilePath());
+    }
 }
 
-KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &suffix, const QString &queryString)
+KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const ArchiveDownload &download,
+    const QString &suffix, const QString &queryString)
 {
+    const QPair<QString, QString> &archive = download.archive;
+    const QString source = m_mirrorSelector
+        ? m_mirrorSelector->mirrorUrl(archive.second, download.mirror) : archive.second;
     KDUpdater::FileDownloader *downloader = nullptr;
-    const QFileInfo fi = QFileInfo(m_archivesToDownload.first().first);
+    const QFileInfo fi = QFileInfo(archive.first);
     const Component *const component = m_core->componentByName(PackageManagerCore::checkableName(QFileInfo(fi.path()).fileName()));
     if (component) {
         QString fullQueryString;
         if (!queryString.isEmpty())
             fullQueryString = QLatin1String("?") + queryString;
-        const QUrl url(m_archivesToDownload.first().second + suffix + fullQueryString);
+        const QUrl url(source + suffix + fullQueryString);
         const QString &scheme = url.scheme();
         downloader = FileDownloaderFactory::instance().create(scheme, this);
 
@@ -300,6 +714,11 @@ KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &s
             if (FileDownloaderFactory::isSupportedScheme(scheme)) {
                 downloader->setDownloadedFileName(component->localTempPath() + QLatin1Char('/')
                     + component->name() + QLatin1Char('/') + fi.fileName() + suffix);
+                // checksums are small enough to be fetched again
+                if (suffix.isEmpty()) {
+                    downloader->setResumeDirectory(m_resumeDirectory);
+                    downloader->setMaxSegments(m_maxSegmentsPerDownload);
+                }
             }
 
             emit outputTextChanged(tr("Downloading archive \"%1\" for component %2.")
@@ -31,7 +31,11 @@
 
 #include "job.h"
 
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QHash>
 #include <QtCore/QPair>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSet>
 
 QT_BEGIN_NAMESPACE
 class QTimerEvent;
@@ -43,7 +47,9 @@ namespace KDUpdater {
 
 namespace QInstaller {
 
+class ArchiveCache;
 class MessageBoxHandler;
+class MirrorSelector;
 class PackageManagerCore;
 
 class DownloadArchivesJob : public Job
@@ -57,10 +63,29 @@ public:
     int numberOfDownloads() const { return m_archivesDownloaded; }
     void setArchivesToDownload(const QList<QPair<QString, QString> > &archives);
 
+    int maxConcurrentDownloads() const { return m_maxConcurrentDownloads; }
+    void setMaxConcurrentDownloads(int count);
+
+    int maxSegmentsPerDownload() const { return m_maxSegmentsPerDownload; }
+    void setMaxSegmentsPerDownload(int count);
+
+    ArchiveCache *archiveCache() const { return m_cache.data(); }
+    void setArchiveCache(ArchiveCache *cache);
+
+    bool isFinished() const { return m_finished; }
+    bool isArchiveRegistered(const QString &archive) const;
+
+    QString resumeDirectory() const { return m_resumeDirectory; }
+    void setResumeDirectory(const QString &directory);
+
+    MirrorSelector *mirrorSelector() const { return m_mirrorSelector; }
+    void setMirrorSelector(MirrorSelector *selector) { m_mirrorSelector = selector; }
+
 Q_SIGNALS:
     void progressChanged(double progress);
     void outputTextChanged(const QString &progress);
     void downloadStatusChanged(const QString &status);
+    void archiveRegistered(const QString &archive);
 
 protected:
     void doStart();
@@ -72,25 +97,77 @@ protected Q_SLOTS:
     void downloadCanceled();
     void downloadFailed(const QString &error);
     void finishWithError(const QString &error);
-    void fetchNextArchive();
-    void fetchNextArchiveHash();
+    void fetchNextArchives();
     void finishedHashDownload();
+    void cacheLookupFinished();
+    void cacheInsertFinished();
     void emitDownloadProgress(double progress);
+    void checkDownloadSpeed(qint64 bytesPerSecond);
 
 private:
-    KDUpdater::FileDownloader *setupDownloader(const QString &suffix = QString(), const QString &queryString = QString());
+    struct ArchiveDownload
+    {
+        ArchiveDownload()
+            : progress(0), mirror(0), hashDownload(false), startTime(0), peakSpeed(0), slowSince(-1)
+        {}
+
+        QPair<QString, QString> archive;
+        QByteArray hash;
+        double progress;
+        int mirror;         // rank of the mirror the archive is downloaded from
+        bool hashDownload;  // true while the .sha1 file is fetched
+        qint64 startTime;
+        qint64 peakSpeed;
+        qint64 slowSince;
+    };
+
+    struct FailedDownload
+    {
+        KDUpdater::FileDownloader *downloader;
+        QString identifier;
+        QString message;
+        bool hashMismatch;
+    };
+
+    QByteArray archiveHashFromMetadata(const QString &archive) const;
+    bool fetchArchiveHash(const ArchiveDownload &download);
+    bool fetchArchive(const ArchiveDownload &download);
+    void retryDownload(KDUpdater::FileDownloader *downloader);
+    void promptForRetry(const FailedDownload &failed);
+    void finishCanceled(const KDUpdater::FileDownloader *downloader);
+    void finishWithError(const QString &error, const KDUpdater::FileDownloader *downloader);
+    void abortDownloads();
+    void removeDownload(KDUpdater::FileDownloader *downloader);
+    double totalProgress() const;
+
+    void removeStalePartialDownloads();
+    void fetchFromCache(const ArchiveDownload &download);
+    QString localFileName(const ArchiveDownload &download) const;
+    bool switchToNextMirror(KDUpdater::FileDownloader *downloader, const QString &reason);
+    KDUpdater::FileDownloader *setupDownloader(const ArchiveDownload &download,
+        const QString &suffix = QString(), const QString &queryString = QString());
 
 private:
     PackageManagerCore *m_core;
-    KDUpdater::FileDownloader *m_downloader;
+    QHash<KDUpdater::FileDownloader *, ArchiveDownload> m_downloads;
+    QHash<QFutureWatcher<bool> *, ArchiveDownload> m_cacheLookups;
+    QHash<QFutureWatcher<bool> *, QPair<QString, QString> > m_cacheInserts; // archive, file name
 
     int m_archivesDownloaded;
     int m_archivesToDownloadCount;
+    int m_maxConcurrentDownloads;
+    int m_maxSegmentsPerDownload;
+    QString m_resumeDirectory;
+    QScopedPointer<ArchiveCache> m_cache;
+    MirrorSelector *m_mirrorSelector;
+    QSet<QString> m_registeredArchives;
     QList<QPair<QString, QString> > m_archivesToDownload;
+    QList<FailedDownload> m_failedDownloads;
+    bool m_retryPromptVisible;
 
     bool m_canceled;
-    QByteArray m_currentHash;
-    double m_lastFileProgress;
+    bool m_finished;
+    double m_inFlightProgress;
     int m_progressChangedTimerId;
 };
 
@@ -73,6 +73,9 @@ AuthenticationRequiredException::AuthenticationRequiredException(Type type, cons
 
 Downloader::Downloader()
     : m_finished(0)
+    , m_maxRequestsPerHost(DownloadFileTask::DefaultMaxRequestsPerHost)
+    , m_queued(0)
+    , m_progress(0)
 {
     connect(&m_timer, &QTimer::timeout, this, &Downloader::onTimeout);
     connect(&m_nam, &QNetworkAccessManager::finished, this, &Downloader::onFinished);
@@ -89,10 +92,11 @@ Downloader::~Downloader()
 }
 
 void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
-    QNetworkProxyFactory *networkProxyFactory)
+    QNetworkProxyFactory *networkProxyFactory, int maxRequestsPerHost)
 {
     m_items = items;
     m_futureInterface = &fi;
+    m_maxRequestsPerHost = qMax(1, maxRequestsPerHost);
 
     fi.reportStarted();
     fi.setExpectedResultCount(items.count());
@@ -109,8 +113,14 @@ void Downloader::doDownload()
 {
     m_timer.start(1000); // Use a timer to check for canceled downloads.
 
-    foreach (const FileTaskItem &item, m_items) {
-        if (!startDownload(item))
+    // Queue all items per host and keep only a limited number of requests in flight per host.
+    // Whenever a request finishes, the next one queued for the same host is started.
+    foreach (const FileTaskItem &item, m_items)
+        m_queues[QUrl(item.source()).host()].enqueue(item);
+    m_queued = m_items.count();
+
+    foreach (const QString &host, m_queues.keys()) {
+        if (!startQueuedDownloads(host))
             break;
     }
 
@@ -199,12 +209,10 @@ void Downloader::onReadyRead()
         data.observer->addBytesTransfered(read);
         data.observer->addCheckSumData(buffer.data(), read);
 
-        int progress = m_finished * 100;
-        for (const auto &pair : m_downloads)
-            progress += pair.second->observer->progressValue();
+        updateProgress(data);
         if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid()) {
-            m_futureInterface->setProgressValueAndText(progress / m_items.count(),
-                data.observer->progressText());
+            const qint64 progress = (m_finished * 100 + m_progress) / m_items.count();
+            m_futureInterface->setProgressValueAndText(int(progress), data.observer->progressText());
         }
     }
 }
@@ -225,6 +233,11 @@ void Downloader::onFinished(QNetworkReply *reply)
                 FileTaskItem taskItem = data.taskItem;
                 taskItem.insert(TaskRole::SourceFile, url.toString());
                 QNetworkReply *const redirectReply = startDownload(taskItem);
+                if (!redirectReply)
+                    return;
+                // The redirected request takes over the request slot of the original one.
+                m_downloads[redirectReply]->host = data.host;
+                m_progress -= data.progress;
 
                 foreach (const QUrl &redirect, redirects)
                     m_redirects.insertMulti(redirectReply, redirect);
@@ -255,15 +268,28 @@ void Downloader::onFinished(QNetworkReply *reply)
         if (expectedCheckSum != data.observer->checkSum().toHex())
             checksumMismatch = true;
     }
-    m_futureInterface->reportResult(FileTaskResult(filename, data.observer->checkSum(), data.taskItem,
-                                                  checksumMismatch));
-
+    FileTaskResult result(filename, data.observer->checkSum(), data.taskItem, checksumMismatch);
+    // Expose the validators of the response, so callers can send a conditional request next time.
+    result.insert(TaskRole::NotModified,
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304);
+    if (reply->hasRawHeader("ETag"))
+        result.insert(TaskRole::ETag, QString::fromLatin1(reply->rawHeader("ETag")));
+    if (reply->hasRawHeader("Last-Modified"))
+        result.insert(TaskRole::LastModified, QString::fromLatin1(reply->rawHeader("Last-Modified")));
+    m_futureInterface->reportResult(result);
+
+    const QString host = data.host;
+    m_progress -= data.progress;
     m_downloads.erase(reply);
     m_redirects.remove(reply);
     reply->deleteLater();
 
     m_finished++;
-    if (m_downloads.empty() || m_futureInterface->isCanceled()) {
+    --m_running[host];
+    if (!m_futureInterface->isCanceled())
+        startQueuedDownloads(host);
+
+    if ((m_downloads.empty() && m_queued == 0) || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
     }
@@ -386,6 +412,34 @@ bool Downloader::testCanceled()
     return m_futureInterface->isCanceled();
 }
 
+bool Downloader::startQueuedDownloads(const QString &host)
+{
+    QQueue<FileTaskItem> &queue = m_queues[host];
+    int &running = m_running[host];
+    while (running < m_maxRequestsPerHost && !queue.isEmpty()) {
+        QNetworkReply *const reply = startDownload(queue.dequeue());
+        --m_queued;
+        if (!reply)
+            return false;
+        m_downloads[reply]->host = host;
+        ++running;
+    }
+    return true;
+}
+
+/*!
+    \internal
+
+    Adds the change of the progress of \a data to the aggregated progress of all running
+    downloads, so it does not need to be summed up again for every received buffer.
+*/
+void Downloader::updateProgress(Data &data)
+{
+    const int progress = data.observer->progressValue();
+    m_progress += progress - data.progress;
+    data.progress = progress;
+}
+
 QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
 {
     QUrl const source = item.source();
@@ -396,7 +450,12 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
         return 0;
     }
 
-    QNetworkReply *reply = m_nam.get(QNetworkRequest(source));
+    QNetworkRequest request(source);
+    const QVariantMap headers = item.value(TaskRole::RequestHeaders).toMap();
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it)
+        request.setRawHeader(it.key().toLatin1(), it.value().toString().toLatin1());
+
+    QNetworkReply *reply = m_nam.get(request);
     std::unique_ptr<Data> data(new Data(item));
     m_downloads[reply] = std::move(data);
 
@@ -415,6 +474,7 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
 
 DownloadFileTask::DownloadFileTask(const QList<FileTaskItem> &items)
     : AbstractFileTask()
+    , m_maxRequestsPerHost(DefaultMaxRequestsPerHost)
 {
     setTaskItems(items);
 }
@@ -449,6 +509,15 @@ void DownloadFileTask::setProxyFactory(KDUpdater::FileDownloaderProxyFactory *fa
     m_proxyFactory.reset(factory);
 }
 
+/*!
+    Sets the maximum number of requests sent to the same host at a time to \a count. Further
+    items are queued and started as soon as a running request to the host finishes.
+*/
+void DownloadFileTask::setMaxRequestsPerHost(int count)
+{
+    m_maxRequestsPerHost = qMax(1, count);
+}
+
 void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
 {
     QEventLoop el;
@@ -462,7 +531,8 @@ void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
                 items[i].insert(TaskRole::Authenticator, QVariant::fromValue(m_authenticator));
         }
     }
-    downloader.download(fi, items, (m_proxyFactory.isNull() ? 0 : m_proxyFactory->clone()));
+    downloader.download(fi, items, (m_proxyFactory.isNull() ? 0 : m_proxyFactory->clone()),
+        m_maxRequestsPerHost);
     el.exec();  // That's tricky here, we need to run our own event loop to keep QNAM working.
 }
 
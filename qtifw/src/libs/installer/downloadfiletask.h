@@ -79,15 +79,18 @@ class INSTALLER_EXPORT DownloadFileTask : public AbstractFileTask
     Q_DISABLE_COPY(DownloadFileTask)
 
 public:
-    DownloadFileTask() {}
+    // Matches the number of connections QNetworkAccessManager opens per host.
+    enum { DefaultMaxRequestsPerHost = 6 };
+
+    DownloadFileTask() : m_maxRequestsPerHost(DefaultMaxRequestsPerHost) {}
     explicit DownloadFileTask(const FileTaskItem &item)
-        : AbstractFileTask(item) {}
+        : AbstractFileTask(item), m_maxRequestsPerHost(DefaultMaxRequestsPerHost) {}
     explicit DownloadFileTask(const QList<FileTaskItem> &items);
 
     explicit DownloadFileTask(const QString &source)
-        : AbstractFileTask(source) {}
+        : AbstractFileTask(source), m_maxRequestsPerHost(DefaultMaxRequestsPerHost) {}
     DownloadFileTask(const QString &source, const QString &target)
-        : AbstractFileTask(source, target) {}
+        : AbstractFileTask(source, target), m_maxRequestsPerHost(DefaultMaxRequestsPerHost) {}
 
     void addTaskItem(const FileTaskItem &items);
     void addTaskItems(const QList<FileTaskItem> &items);
@@ -98,12 +101,16 @@ public:
     void setAuthenticator(const QAuthenticator &authenticator);
     void setProxyFactory(KDUpdater::FileDownloaderProxyFactory *factory);
 
+    int maxRequestsPerHost() const { return m_maxRequestsPerHost; }
+    void setMaxRequestsPerHost(int count);
+
     void doTask(QFutureInterface<FileTaskResult> &fi);
 
 private:
     friend class Downloader;
     QAuthenticator m_authenticator;
     QScopedPointer<KDUpdater::FileDownloaderProxyFactory> m_proxyFactory;
+    int m_maxRequestsPerHost;
 };
 
 }   // namespace QInstaller
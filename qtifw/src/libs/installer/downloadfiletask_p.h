@@ -36,6 +36,7 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QQueue>
 #include <QTimer>
 
 #include <memory>
@@ -54,17 +55,21 @@ struct Data
     Data()
         : file(Q_NULLPTR)
         , observer(Q_NULLPTR)
+        , progress(0)
     {}
 
     Data(const FileTaskItem &fti)
         : taskItem(fti)
         , file(Q_NULLPTR)
         , observer(new FileTaskObserver(QCryptographicHash::Sha1))
+        , progress(0)
     {}
 
     FileTaskItem taskItem;
     std::unique_ptr<QFile> file;
     std::unique_ptr<FileTaskObserver> observer;
+    QString host;   // the host this download holds a request slot for
+    int progress;   // the progress value last added to the aggregated progress
 };
 
 class Downloader : public QObject
@@ -77,7 +82,7 @@ public:
     ~Downloader();
 
     void download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
-        QNetworkProxyFactory *networkProxyFactory);
+        QNetworkProxyFactory *networkProxyFactory, int maxRequestsPerHost);
 
 signals:
     void finished();
@@ -95,6 +100,8 @@ private slots:
 
 private:
     bool testCanceled();
+    bool startQueuedDownloads(const QString &host);
+    void updateProgress(Data &data);
     QNetworkReply *startDownload(const FileTaskItem &item);
 
 private:
@@ -102,6 +109,11 @@ private:
 
     QTimer m_timer;
     int m_finished;
+    int m_maxRequestsPerHost;
+    int m_queued;
+    qint64 m_progress;
+    QHash<QString, QQueue<FileTaskItem> > m_queues;
+    QHash<QString, int> m_running;
     QNetworkAccessManager m_nam;
     QList<FileTaskItem> m_items;
     QMultiHash<QNetworkReply*, QUrl> m_redirects;
@@ -29,12 +29,14 @@
 #include "extractarchiveoperation_p.h"
 
 #include "constants.h"
+#include "filemanifest.h"
 #include "globals.h"
+#include "lib7z_archive.h"
+#include "settings.h"
 
 #include <QEventLoop>
 #include <QThreadPool>
 #include <QFileInfo>
-#include <QDataStream>
 
 namespace QInstaller {
 
@@ -69,6 +71,10 @@ ExtractArchiveOperation::ExtractArchiveOperation(PackageManagerCore *core)
     setName(QLatin1String("Extract"));
 }
 
+ExtractArchiveOperation::~ExtractArchiveOperation()
+{
+}
+
 void ExtractArchiveOperation::backup()
 {
     // we need to backup on the fly...
@@ -92,7 +98,10 @@ bool ExtractArchiveOperation::performOperation()
         connect(core, &PackageManagerCore::statusChanged, &callback, &Callback::statusChanged);
     }
 
-    Runnable *runnable = new Runnable(archivePath, targetDir, &callback);
+    const int threads = packageManager() ? packageManager()->settings().archiveDecoderThreads() : 1;
+    callback.setDeduplicateFiles(packageManager() && packageManager()->settings().deduplicateFiles());
+    Runnable *runnable = new Runnable(archivePath, targetDir, &callback, threads,
+        m_archiveHandle.data());
     connect(runnable, &Runnable::finished, &receiver, &Receiver::runnableFinished,
         Qt::QueuedConnection);
 
@@ -108,6 +117,8 @@ bool ExtractArchiveOperation::performOperation()
         runnable->run();
         receiver.runnableFinished(true, QString());
     }
+    m_archiveHandle.reset();
+    m_archive.reset();
 
     // Write all file names which belongs to a package to a separate file and only the separate
     // filename to a .dat file. There can be enormous amount of files in a package, which makes
@@ -119,8 +130,7 @@ bool ExtractArchiveOperation::performOperation()
     // -installerResources (dir)
     //   -<component_name> (dir)
     //    -<filename>.txt (file)
-
-    QStringList files = callback.extractedFiles();
+    // The file is a binary manifest, see FileManifestWriter.
 
     QString installDir = targetDir;
     // If we have package manager in use (normal installer run) then use
@@ -149,11 +159,13 @@ bool ExtractArchiveOperation::performOperation()
     QFile file(targetDirectoryInfo.absolutePath() + QLatin1Char('/') + fileName);
     if (file.open(QIODevice::WriteOnly)) {
         setDefaultFilePermissions(file.fileName(), DefaultFilePermissions::NonExecutable);
-        QDataStream out (&file);
-        for (int i = 0; i < files.count(); ++i) {
-            files[i] = replacePath(files.at(i), installDir, QLatin1String(scRelocatable));
+        FileManifestWriter manifest(&file);
+        foreach (const QString &path, callback.extractedFiles())
+            manifest.add(replacePath(path, installDir, QLatin1String(scRelocatable)));
+        if (!manifest.finish()) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot write file list"
+                << file.fileName() << ":" << manifest.errorString();
         }
-        out << files;
         setValue(QLatin1String("files"), file.fileName());
         file.close();
     } else {
@@ -184,23 +196,19 @@ bool ExtractArchiveOperation::undoOperation()
     QString targetDir = arguments().at(1);
     if (packageManager())
         targetDir = packageManager()->value(QLatin1String("TargetDir"));
-    QStringList files;
     if (useStringListType) {
-        files = value(QLatin1String("files")).toStringList();
+        startUndoProcess(new WorkerThread(this, value(QLatin1String("files")).toStringList()));
     } else {
-        if (!readDataFileContents(targetDir, &files))
-            return false;
-    }
-    startUndoProcess(files);
-    if (!useStringListType)
+        relocateDataFile(targetDir);
+        startUndoProcess(new WorkerThread(this, m_relocatedDataFileName, targetDir));
         deleteDataFile(m_relocatedDataFileName);
+    }
 
     return true;
 }
 
-void ExtractArchiveOperation::startUndoProcess(const QStringList &files)
+void ExtractArchiveOperation::startUndoProcess(WorkerThread *thread)
 {
-    WorkerThread *const thread = new WorkerThread(this, files);
     connect(thread, &WorkerThread::currentFileChanged, this,
         &ExtractArchiveOperation::outputTextChanged);
     connect(thread, &WorkerThread::progressChanged, this,
@@ -235,21 +243,22 @@ bool ExtractArchiveOperation::testOperation()
     return true;
 }
 
-bool ExtractArchiveOperation::readDataFileContents(QString &targetDir, QStringList *resultList)
+void ExtractArchiveOperation::relocateDataFile(QString &targetDir)
 {
     const QString filePath = value(QLatin1String("files")).toString();
     // Does not change target on non macOS platforms.
     if (QInstaller::isInBundle(targetDir, &targetDir))
         targetDir = QDir::cleanPath(targetDir + QLatin1String("/.."));
     m_relocatedDataFileName = replacePath(filePath, QLatin1String(scRelocatable), targetDir);
+}
+
+bool ExtractArchiveOperation::readDataFileContents(QString &targetDir, QStringList *resultList)
+{
+    relocateDataFile(targetDir);
     QFile file(m_relocatedDataFileName);
 
     if (file.open(QIODevice::ReadOnly)) {
-        QDataStream in(&file);
-        in >> *resultList;
-        for (int i = 0; i < resultList->count(); ++i)
-            resultList->replace(i, replacePath(resultList->at(i),  QLatin1String(scRelocatable), targetDir));
-
+        *resultList = FileManifestReader::readAll(&file, QLatin1String(scRelocatable), targetDir);
     } else {
         // We should not be here. Either user has manually deleted the installer related
         // files or same component is installed several times.
@@ -260,4 +269,25 @@ bool ExtractArchiveOperation::readDataFileContents(QString &targetDir, QStringLi
     return true;
 }
 
+/*!
+    Opens the archive to extract and returns the files and directories it contains. The
+    archive is kept open, the next performOperation() extracts it without opening and
+    reading its headers again.
+
+    \note Throws Lib7z::SevenZipException on error.
+*/
+QVector<Lib7z::File> ExtractArchiveOperation::archiveContents()
+{
+    m_archiveHandle.reset();
+    m_archive.reset(new QFile(arguments().value(0)));
+    if (!m_archive->open(QIODevice::ReadOnly)) {
+        const QString errorString = m_archive->errorString();
+        m_archive.reset();
+        throw Lib7z::SevenZipException(tr("Cannot open archive \"%1\" for reading: %2")
+            .arg(arguments().value(0), errorString));
+    }
+    m_archiveHandle.reset(new Lib7z::ArchiveHandle(m_archive.data()));
+    return m_archiveHandle->files();
+}
+
 } // namespace QInstaller
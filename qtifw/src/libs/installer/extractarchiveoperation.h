@@ -30,11 +30,21 @@
 #define EXTRACTARCHIVEOPERATION_H
 
 #include "qinstallerglobal.h"
+#include "lib7z_list.h"
 
 #include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+
+QT_FORWARD_DECLARE_CLASS(QFile)
+
+namespace Lib7z {
+class ArchiveHandle;
+}
 
 namespace QInstaller {
 
+class WorkerThread;
+
 class INSTALLER_EXPORT ExtractArchiveOperation : public QObject, public Operation
 {
     Q_OBJECT
@@ -42,6 +52,7 @@ class INSTALLER_EXPORT ExtractArchiveOperation : public QObject, public Operatio
 
 public:
     explicit ExtractArchiveOperation(PackageManagerCore *core);
+    ~ExtractArchiveOperation();
 
     void backup();
     bool performOperation();
@@ -49,17 +60,21 @@ public:
     bool testOperation();
 
     bool readDataFileContents(QString &targetDir, QStringList *resultList);
+    QVector<Lib7z::File> archiveContents();
 
 Q_SIGNALS:
     void outputTextChanged(const QString &progress);
     void progressChanged(double);
 
 private:
-    void startUndoProcess(const QStringList &files);
+    void startUndoProcess(WorkerThread *thread);
+    void relocateDataFile(QString &targetDir);
     void deleteDataFile(const QString &fileName);
 
 private:
     QString m_relocatedDataFileName;
+    QScopedPointer<QFile> m_archive;
+    QScopedPointer<Lib7z::ArchiveHandle> m_archiveHandle;
 
 private:
     class Callback;
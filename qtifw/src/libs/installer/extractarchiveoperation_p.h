@@ -30,7 +30,12 @@
 
 #include "extractarchiveoperation.h"
 
+#include "constants.h"
+#include "filemanifest.h"
+#include "fileremover.h"
 #include "fileutils.h"
+#include "globals.h"
+#include "lib7z_archive.h"
 #include "lib7z_extract.h"
 #include "lib7z_facade.h"
 #include "packagemanagercore.h"
@@ -53,32 +58,90 @@ public:
         setObjectName(QLatin1String("ExtractArchive"));
     }
 
+    WorkerThread(ExtractArchiveOperation *op, const QString &manifestFileName,
+            const QString &targetDir)
+        : m_manifestFileName(manifestFileName)
+        , m_targetDir(targetDir)
+        , m_op(op)
+    {
+        setObjectName(QLatin1String("ExtractArchive"));
+    }
+
     void run()
     {
         Q_ASSERT(m_op != 0);
 
-        int removedCounter = 0;
-        foreach (const QString &file, m_files) {
-            removedCounter++;
-
-            const QFileInfo fi(file);
-            emit currentFileChanged(QDir::toNativeSeparators(file));
-            emit progressChanged(double(removedCounter) / m_files.count());
-            if (fi.isFile() || fi.isSymLink()) {
-                m_op->deleteFileNowOrLater(fi.absoluteFilePath());
-            } else if (fi.isDir()) {
-                removeSystemGeneratedFiles(file);
-                fi.dir().rmdir(file); // directory may not exist
-            }
+        FileRemover remover;
+        if (m_manifestFileName.isEmpty()) {
+            connect(&remover, &FileRemover::progressChanged, [this](int removed, const QString &file) {
+                emit currentFileChanged(file);
+                emit progressChanged(double(removed) / qMax(1, m_files.count()));
+            });
+            remover.removeFiles(m_files);
+        } else {
+            removeManifestFiles(&remover);
         }
+        remover.removeDirectories();
+
+        // files that cannot be removed right now are renamed and deleted later
+        foreach (const QString &file, remover.failedFiles())
+            m_op->deleteFileNowOrLater(file);
     }
 
 signals:
     void currentFileChanged(const QString &filename);
     void progressChanged(double);
 
+private:
+    // The manifest is streamed in batches, the file list of a component is never held in memory.
+    void removeManifestFiles(FileRemover *remover)
+    {
+        QFile manifest(m_manifestFileName);
+        if (!manifest.open(QIODevice::ReadOnly)) {
+            // We should not be here. Either user has manually deleted the installer related
+            // files or same component is installed several times.
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot open file " << manifest.fileName()
+                << " for reading:" << manifest.errorString() << ". Component is already uninstalled "
+                << "or file is manually deleted.";
+            return;
+        }
+
+        FileManifestReader reader(&manifest);
+        reader.setPathReplacement(QLatin1String(scRelocatable), m_targetDir);
+        QStringList batch;
+        double batchStart = 0.0;
+        double batchEnd = 0.0;
+        int removedBefore = 0;
+        const QMetaObject::Connection connection = connect(remover,
+                &FileRemover::progressChanged, [&](int removed, const QString &file) {
+            emit currentFileChanged(file);
+            emit progressChanged(batchStart + (batchEnd - batchStart)
+                * (removed - removedBefore) / qMax(1, batch.count()));
+        });
+
+        static const int scBatchSize = 4096;
+        bool atEnd = false;
+        while (!atEnd) {
+            while (batch.count() < scBatchSize && !(atEnd = !reader.readNext()))
+                batch.append(reader.path());
+            batchEnd = reader.progress();
+            remover->removeFiles(batch);
+
+            batch.clear();
+            batchStart = batchEnd;
+            removedBefore = remover->removedCount();
+        }
+        disconnect(connection);
+        if (reader.hasError()) {
+            qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot read file list"
+                << manifest.fileName() << ":" << reader.errorString();
+        }
+    }
+
 private:
     QStringList m_files;
+    QString m_manifestFileName;
+    QString m_targetDir;
     ExtractArchiveOperation *m_op;
 };
 
@@ -170,23 +233,30 @@ class ExtractArchiveOperation::Runnable : public QObject, public QRunnable
 
 public:
     Runnable(const QString &archivePath, const QString &targetDir,
-            ExtractArchiveOperation::Callback *callback)
+            ExtractArchiveOperation::Callback *callback, int threads = 1,
+            Lib7z::ArchiveHandle *archiveHandle = nullptr)
         : m_archivePath(archivePath)
         , m_targetDir(targetDir)
         , m_callback(callback)
+        , m_threads(threads)
+        , m_archiveHandle(archiveHandle)
     {}
 
     void run()
     {
         QFile archive(m_archivePath);
-        if (!archive.open(QIODevice::ReadOnly)) {
+        if (!m_archiveHandle && !archive.open(QIODevice::ReadOnly)) {
             emit finished(false, tr("Cannot open archive \"%1\" for reading: %2").arg(m_archivePath,
                 archive.errorString()));
             return;
         }
 
         try {
-            Lib7z::extractArchive(&archive, m_targetDir, m_callback);
+            // an archive that was listed before is already open
+            if (m_archiveHandle)
+                m_archiveHandle->extract(m_targetDir, m_callback, m_threads);
+            else
+                Lib7z::extractArchive(&archive, m_targetDir, m_callback, m_threads);
             emit finished(true, QString());
         } catch (const Lib7z::SevenZipException& e) {
             emit finished(false, tr("Error while extracting archive \"%1\": %2").arg(m_archivePath,
@@ -204,6 +274,8 @@ private:
     QString m_archivePath;
     QString m_targetDir;
     ExtractArchiveOperation::Callback *m_callback;
+    int m_threads;
+    Lib7z::ArchiveHandle *m_archiveHandle;
 };
 
 class ExtractArchiveOperation::Receiver : public QObject
@@ -0,0 +1,335 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "filemanifest.h"
+
+#include "fileutils.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QIODevice>
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::FileManifestWriter
+    \brief The FileManifestWriter class writes the list of files installed from an archive.
+
+    A manifest starts with the magic bytes \c IFWM and a format version, followed by a stream
+    of records. Each record starts with a variable length integer: \c 0 defines the next entry
+    of the directory table and is followed by the directory path, any other value \c n is a file
+    entry in directory \c n-1. A file entry holds the file name, a flags byte, and the file size
+    and hash if the flags say so. Integers are stored as unsigned LEB128, strings as their UTF-8
+    length followed by the UTF-8 bytes.
+
+    Directories are defined right before their first use, so a manifest can be written and read
+    as a stream and the order of the added paths is kept.
+*/
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::FileManifestReader
+    \brief The FileManifestReader class reads the list of files installed from an archive.
+
+    Besides the current manifest format, the reader understands the files written by earlier
+    versions, which contain a QStringList serialized by QDataStream. Those are read completely
+    on construction.
+*/
+
+static const char scManifestMagic[] = "IFWM";
+static const quint8 scManifestVersion = 1;
+static const int scMaxBufferSize = 64 * 1024;
+
+enum EntryFlag {
+    HasSize = 0x01,
+    HasHash = 0x02
+};
+
+/*!
+    Creates a writer that writes the manifest to the open \a device.
+*/
+FileManifestWriter::FileManifestWriter(QIODevice *device)
+    : m_device(device)
+{
+    m_buffer.reserve(scMaxBufferSize);
+    m_buffer.append(scManifestMagic, 4);
+    m_buffer.append(char(scManifestVersion));
+}
+
+/*!
+    Destroys the writer. Call finish() to write out the buffered entries.
+*/
+FileManifestWriter::~FileManifestWriter()
+{
+}
+
+/*!
+    Adds the file \a path, with optional \a size and \a hash, to the manifest.
+*/
+void FileManifestWriter::add(const QString &path, qint64 size, const QByteArray &hash)
+{
+    // split off the file name, keeping the separator so that joining is lossless
+    const int separator = qMax(path.lastIndexOf(QLatin1Char('/')),
+        path.lastIndexOf(QLatin1Char('\\')));
+    const QString directory = path.left(qMax(separator, 0));
+    const QString name = path.mid(qMax(separator, 0));
+
+    quint64 index = m_directories.value(directory, quint64(-1));
+    if (index == quint64(-1)) {
+        index = quint64(m_directories.size());
+        m_directories.insert(directory, index);
+        writeVarInt(0);
+        writeString(directory);
+    }
+
+    writeVarInt(index + 1);
+    writeString(name);
+    quint8 flags = 0;
+    if (size >= 0)
+        flags |= HasSize;
+    if (!hash.isEmpty())
+        flags |= HasHash;
+    m_buffer.append(char(flags));
+    if (flags & HasSize)
+        writeVarInt(quint64(size));
+    if (flags & HasHash) {
+        writeVarInt(quint64(hash.size()));
+        m_buffer.append(hash);
+    }
+
+    if (m_buffer.size() >= scMaxBufferSize)
+        flush();
+}
+
+/*!
+    Writes the buffered entries to the device. Returns \c true on success; otherwise returns
+    \c false and sets the error string.
+*/
+bool FileManifestWriter::finish()
+{
+    return flush() && m_errorString.isEmpty();
+}
+
+void FileManifestWriter::writeVarInt(quint64 value)
+{
+    while (value >= 0x80) {
+        m_buffer.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_buffer.append(char(value));
+}
+
+void FileManifestWriter::writeString(const QString &string)
+{
+    const QByteArray utf8 = string.toUtf8();
+    writeVarInt(quint64(utf8.size()));
+    m_buffer.append(utf8);
+}
+
+bool FileManifestWriter::flush()
+{
+    if (m_buffer.isEmpty() || !m_errorString.isEmpty()) {
+        m_buffer.resize(0);
+        return m_errorString.isEmpty();
+    }
+    if (m_device->write(m_buffer) != m_buffer.size())
+        m_errorString = m_device->errorString();
+    m_buffer.resize(0);
+    return m_errorString.isEmpty();
+}
+
+
+/*!
+    Creates a reader for the manifest in the open \a device.
+*/
+FileManifestReader::FileManifestReader(QIODevice *device)
+    : m_device(device)
+    , m_legacy(false)
+    , m_legacyIndex(0)
+    , m_size(-1)
+{
+    if (m_device->peek(4) == QByteArray(scManifestMagic, 4)) {
+        m_device->read(4);
+        char version = 0;
+        if (!m_device->getChar(&version) || quint8(version) != scManifestVersion) {
+            setError(QCoreApplication::translate("QInstaller",
+                "Unsupported file manifest version %1.").arg(int(quint8(version))));
+        }
+        return;
+    }
+
+    m_legacy = true;
+    if (m_device->atEnd())
+        return;
+    QDataStream in(m_device);
+    in >> m_legacyPaths;
+    if (in.status() != QDataStream::Ok) {
+        setError(QCoreApplication::translate("QInstaller", "Cannot read the file list."));
+    }
+}
+
+/*!
+    Replaces \a before with \a after at the beginning of every path read. Must be called before
+    the first call to readNext().
+*/
+void FileManifestReader::setPathReplacement(const QString &before, const QString &after)
+{
+    m_before = before;
+    m_after = after;
+}
+
+/*!
+    Reads the next entry. Returns \c false at the end of the manifest or on error.
+*/
+bool FileManifestReader::readNext()
+{
+    m_path.clear();
+    m_size = -1;
+    m_hash.clear();
+    if (hasError())
+        return false;
+
+    if (m_legacy) {
+        if (m_legacyIndex >= m_legacyPaths.count())
+            return false;
+        m_path = replaced(m_legacyPaths.at(m_legacyIndex++));
+        return true;
+    }
+
+    quint64 record = 0;
+    while (true) {
+        if (m_device->atEnd())
+            return false;
+        if (!readVarInt(&record))
+            return false;
+        if (record != 0)
+            break;
+
+        QString directory;
+        if (!readString(&directory))
+            return false;
+        m_directories.append(directory.isEmpty() ? directory : replaced(directory));
+    }
+
+    if (record > quint64(m_directories.size()))
+        return setError(QCoreApplication::translate("QInstaller", "Invalid file manifest entry."));
+    const QString &directory = m_directories.at(int(record - 1));
+
+    QString name;
+    if (!readString(&name))
+        return false;
+    // paths without a directory are replaced as a whole, as they can match the replaced path
+    m_path = directory.isEmpty() ? replaced(name) : directory + name;
+
+    char flags = 0;
+    if (!m_device->getChar(&flags))
+        return setError(QCoreApplication::translate("QInstaller", "Truncated file manifest."));
+    if (flags & HasSize) {
+        quint64 size = 0;
+        if (!readVarInt(&size))
+            return false;
+        m_size = qint64(size);
+    }
+    if (flags & HasHash) {
+        quint64 length = 0;
+        if (!readVarInt(&length))
+            return false;
+        m_hash = m_device->read(qint64(length));
+        if (quint64(m_hash.size()) != length)
+            return setError(QCoreApplication::translate("QInstaller", "Truncated file manifest."));
+    }
+    return true;
+}
+
+/*!
+    Returns the part of the manifest that was read so far, as a value between \c 0 and \c 1.
+*/
+double FileManifestReader::progress() const
+{
+    if (m_legacy)
+        return m_legacyPaths.isEmpty() ? 1.0 : double(m_legacyIndex) / m_legacyPaths.count();
+    const qint64 size = m_device->size();
+    return size > 0 ? double(m_device->pos()) / size : 1.0;
+}
+
+/*!
+    Reads all paths of the manifest in \a device, replacing \a before with \a after at their
+    beginning. Reading stops at the first error.
+*/
+QStringList FileManifestReader::readAll(QIODevice *device, const QString &before,
+    const QString &after)
+{
+    FileManifestReader reader(device);
+    reader.setPathReplacement(before, after);
+    QStringList paths;
+    while (reader.readNext())
+        paths.append(reader.path());
+    return paths;
+}
+
+bool FileManifestReader::readVarInt(quint64 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char byte = 0;
+        if (!m_device->getChar(&byte))
+            return setError(QCoreApplication::translate("QInstaller", "Truncated file manifest."));
+        *value |= quint64(quint8(byte) & 0x7f) << shift;
+        if (!(quint8(byte) & 0x80))
+            return true;
+    }
+    return setError(QCoreApplication::translate("QInstaller", "Invalid file manifest entry."));
+}
+
+bool FileManifestReader::readString(QString *string)
+{
+    quint64 length = 0;
+    if (!readVarInt(&length))
+        return false;
+    const QByteArray utf8 = m_device->read(qint64(length));
+    if (quint64(utf8.size()) != length)
+        return setError(QCoreApplication::translate("QInstaller", "Truncated file manifest."));
+    *string = QString::fromUtf8(utf8);
+    return true;
+}
+
+QString FileManifestReader::replaced(const QString &path) const
+{
+    return m_before.isEmpty() ? path : replacePath(path, m_before, m_after);
+}
+
+bool FileManifestReader::setError(const QString &errorString)
+{
+    if (m_errorString.isEmpty())
+        m_errorString = errorString;
+    return false;
+}
+
+} // namespace QInstaller
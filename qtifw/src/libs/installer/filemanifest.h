@@ -0,0 +1,116 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef FILEMANIFEST_H
+#define FILEMANIFEST_H
+
+#include "installer_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT FileManifestWriter
+{
+    Q_DISABLE_COPY(FileManifestWriter)
+
+public:
+    explicit FileManifestWriter(QIODevice *device);
+    ~FileManifestWriter();
+
+    void add(const QString &path, qint64 size = -1, const QByteArray &hash = QByteArray());
+    bool finish();
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    void writeVarInt(quint64 value);
+    void writeString(const QString &string);
+    bool flush();
+
+private:
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    QHash<QString, quint64> m_directories;
+    QString m_errorString;
+};
+
+class INSTALLER_EXPORT FileManifestReader
+{
+    Q_DISABLE_COPY(FileManifestReader)
+
+public:
+    explicit FileManifestReader(QIODevice *device);
+
+    bool isLegacyFormat() const { return m_legacy; }
+    void setPathReplacement(const QString &before, const QString &after);
+
+    bool readNext();
+    QString path() const { return m_path; }
+    qint64 size() const { return m_size; }
+    QByteArray hash() const { return m_hash; }
+    double progress() const;
+
+    bool hasError() const { return !m_errorString.isEmpty(); }
+    QString errorString() const { return m_errorString; }
+
+    static QStringList readAll(QIODevice *device, const QString &before = QString(),
+        const QString &after = QString());
+
+private:
+    bool readVarInt(quint64 *value);
+    bool readString(QString *string);
+    QString replaced(const QString &path) const;
+    bool setError(const QString &errorString);
+
+private:
+    QIODevice *m_device;
+    bool m_legacy;
+    QStringList m_legacyPaths;
+    int m_legacyIndex;
+    QVector<QString> m_directories;
+    QString m_before;
+    QString m_after;
+    QString m_path;
+    qint64 m_size;
+    QByteArray m_hash;
+    QString m_errorString;
+};
+
+} // namespace QInstaller
+
+#endif // FILEMANIFEST_H
@@ -0,0 +1,348 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "fileremover.h"
+
+#include "fileutils.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::FileRemover
+    \internal
+    \brief The FileRemover class removes many files concurrently.
+
+    Files are grouped by their directory and the groups are removed on a thread pool. On Unix
+    each group opens its directory once and unlinks the files relative to it with \c unlinkat(),
+    which saves resolving the full path for every file. Directories are never removed while
+    files are removed. They are collected and removed bottom-up in a single pass by
+    removeDirectories(), once they are empty.
+
+    The functions block until they are done. The progressChanged() signal is emitted from the
+    calling thread at a fixed rate while the removal is running, and once at its end.
+*/
+
+/*!
+    \fn void QInstaller::FileRemover::progressChanged(int removedCount, const QString &currentFile)
+
+    Emitted periodically while files are removed. \a removedCount is the number of files removed
+    so far, \a currentFile one of the files being removed.
+*/
+
+// Files of one directory are split into chunks of this size, to remove large directories in
+// parallel as well.
+static const int scChunkSize = 256;
+static const int scProgressInterval = 100;
+
+static QString joinPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith(QLatin1Char('/')) ? directory + name
+        : directory + QLatin1Char('/') + name;
+}
+
+/*!
+    Creates a file remover with \a parent.
+*/
+FileRemover::FileRemover(QObject *parent)
+    : QObject(parent)
+    , m_interval(scProgressInterval)
+    , m_removed(0)
+{
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+}
+
+/*!
+    Destroys the file remover.
+*/
+FileRemover::~FileRemover()
+{
+    m_pool.waitForDone();
+}
+
+/*!
+    Sets the interval between two progressChanged() signals to \a msecs milliseconds.
+*/
+void FileRemover::setProgressInterval(int msecs)
+{
+    m_interval = qMax(1, msecs);
+}
+
+/*!
+    Sets the number of threads removing files to \a count.
+*/
+void FileRemover::setMaxThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+/*!
+    Removes the files and symbolic links in \a paths. Paths that turn out to be directories are
+    remembered and removed by the next call to removeDirectories(). Paths that do not exist are
+    ignored, paths that cannot be removed are added to failedFiles().
+*/
+void FileRemover::removeFiles(const QStringList &paths)
+{
+    QVector<Batch> batches;
+    QHash<QString, int> batchOfDirectory;
+    foreach (const QString &path, paths) {
+        if (path.isEmpty())
+            continue;
+        const QString normalized = QDir::fromNativeSeparators(path);
+        const int separator = normalized.lastIndexOf(QLatin1Char('/'));
+        const QString directory = separator < 0 ? QString::fromLatin1(".")
+            : separator == 0 ? QString::fromLatin1("/") : normalized.left(separator);
+
+        int index = batchOfDirectory.value(directory, -1);
+        if (index < 0 || batches.at(index).names.count() >= scChunkSize) {
+            index = batches.count();
+            batchOfDirectory.insert(directory, index);
+            batches.append(Batch { directory, QStringList() });
+        }
+        batches[index].names.append(normalized.mid(separator + 1));
+    }
+    run(batches);
+}
+
+/*!
+    Removes the directories found by removeFiles(), deepest first. Directories that are not
+    empty or do not exist are left alone.
+*/
+void FileRemover::removeDirectories()
+{
+    QStringList directories;
+    {
+        QMutexLocker _(&m_mutex);
+        directories = m_directories.values();
+        m_directories.clear();
+    }
+    removeDirectories(directories, false);
+}
+
+/*!
+    Removes the directory \a path with all its contents. Symbolic links are removed, not
+    followed. Errors are added to errors().
+*/
+void FileRemover::removeDirectory(const QString &path)
+{
+    // QDir("") points to the working directory! We never want to remove that one.
+    if (path.isEmpty() || !QFileInfo(path).isDir())
+        return;
+
+    QStringList files;
+    QStringList directories(path);
+    QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+        QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        if (fi.isDir() && !fi.isSymLink())
+            directories.append(fi.filePath());
+        else
+            files.append(fi.filePath());
+    }
+
+    removeFiles(files);
+    {
+        QMutexLocker _(&m_mutex);
+        directories += m_directories.values();
+        m_directories.clear();
+    }
+    removeDirectories(directories, true);
+}
+
+/*!
+    Returns the number of files removed so far.
+*/
+int FileRemover::removedCount() const
+{
+    return m_removed.load();
+}
+
+/*!
+    Returns the files that could not be removed.
+*/
+QStringList FileRemover::failedFiles() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_failedFiles;
+}
+
+/*!
+    Returns the error messages of all failed removals.
+*/
+QStringList FileRemover::errors() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_errors;
+}
+
+void FileRemover::run(const QVector<Batch> &batches)
+{
+    foreach (const Batch &batch, batches)
+        QtConcurrent::run(&m_pool, [this, batch]() { removeBatch(batch); });
+
+    while (!m_pool.waitForDone(m_interval))
+        emitProgress();
+    emitProgress();
+}
+
+void FileRemover::removeBatch(const Batch &batch)
+{
+    {
+        QMutexLocker _(&m_mutex);
+        m_currentFile = joinPath(batch.directory, batch.names.first());
+    }
+
+#ifdef Q_OS_UNIX
+    const int dirFd = ::open(QFile::encodeName(batch.directory).constData(),
+        O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        const int error = errno;
+        if (error == ENOENT || error == ENOTDIR)
+            return; // nothing left to remove
+        foreach (const QString &name, batch.names)
+            addFailure(joinPath(batch.directory, name), QString::fromLocal8Bit(strerror(error)));
+        return;
+    }
+
+    foreach (const QString &name, batch.names) {
+        const QByteArray encodedName = QFile::encodeName(name);
+        if (::unlinkat(dirFd, encodedName.constData(), 0) == 0) {
+            ++m_removed;
+            continue;
+        }
+        const int error = errno;
+        if (error == ENOENT)
+            continue;
+
+        // unlink() fails with EISDIR on Linux and EPERM elsewhere for directories
+        struct stat info;
+        if ((error == EISDIR || error == EPERM)
+                && ::fstatat(dirFd, encodedName.constData(), &info, AT_SYMLINK_NOFOLLOW) == 0
+                && S_ISDIR(info.st_mode)) {
+            QMutexLocker _(&m_mutex);
+            m_directories.insert(joinPath(batch.directory, name));
+            continue;
+        }
+        addFailure(joinPath(batch.directory, name), QString::fromLocal8Bit(strerror(error)));
+    }
+    ::close(dirFd);
+#else
+    foreach (const QString &name, batch.names) {
+        const QString path = joinPath(batch.directory, name);
+        QFile file(path);
+        if (file.remove()) {
+            ++m_removed;
+            continue;
+        }
+        const QFileInfo fi(path);
+        if (!fi.exists() && !fi.isSymLink())
+            continue;
+        if (fi.isDir() && !fi.isSymLink()) {
+            QMutexLocker _(&m_mutex);
+            m_directories.insert(path);
+            continue;
+        }
+        //ReadOnly can prevent removing in Windows. Change permission and try again.
+        const QFile::Permissions permissions = file.permissions();
+        if (!(permissions & QFile::WriteUser) && file.setPermissions(permissions | QFile::WriteUser)
+                && file.remove()) {
+            ++m_removed;
+            continue;
+        }
+        addFailure(path, file.errorString());
+    }
+#endif
+}
+
+void FileRemover::removeDirectories(QStringList directories, bool reportErrors)
+{
+    // deepest first, so every directory is empty by the time it is reached
+    std::sort(directories.begin(), directories.end(), [](const QString &lhs, const QString &rhs) {
+        return lhs.count(QLatin1Char('/')) > rhs.count(QLatin1Char('/'));
+    });
+
+    QDir dir;
+    foreach (const QString &directory, directories) {
+        removeSystemGeneratedFiles(directory);
+        errno = 0;
+        if (dir.rmdir(directory) || !reportErrors)
+            continue;
+        const int error = errno;
+        if (!dir.exists(directory))
+            continue;
+        const QString errorString = QCoreApplication::translate("QInstaller",
+            "Cannot remove directory \"%1\": %2").arg(QDir::toNativeSeparators(directory),
+            QString::fromLocal8Bit(strerror(error)));
+        QMutexLocker _(&m_mutex);
+        m_errors.append(errorString);
+    }
+}
+
+void FileRemover::addFailure(const QString &path, const QString &errorString)
+{
+    const QString nativePath = QDir::toNativeSeparators(path);
+    QMutexLocker _(&m_mutex);
+    m_failedFiles.append(nativePath);
+    m_errors.append(QCoreApplication::translate("QInstaller", "Cannot remove file \"%1\": %2")
+        .arg(nativePath, errorString));
+}
+
+void FileRemover::emitProgress()
+{
+    QString currentFile;
+    {
+        QMutexLocker _(&m_mutex);
+        currentFile = m_currentFile;
+    }
+    emit progressChanged(m_removed.load(), QDir::toNativeSeparators(currentFile));
+}
+
+} // namespace QInstaller
@@ -0,0 +1,95 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef FILEREMOVER_H
+#define FILEREMOVER_H
+
+#include "installer_global.h"
+
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT FileRemover : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(FileRemover)
+
+public:
+    explicit FileRemover(QObject *parent = nullptr);
+    ~FileRemover();
+
+    void setProgressInterval(int msecs);
+    void setMaxThreadCount(int count);
+
+    void removeFiles(const QStringList &paths);
+    void removeDirectories();
+    void removeDirectory(const QString &path);
+
+    int removedCount() const;
+    QStringList failedFiles() const;
+    QStringList errors() const;
+
+Q_SIGNALS:
+    void progressChanged(int removedCount, const QString &currentFile);
+
+private:
+    struct Batch
+    {
+        QString directory;
+        QStringList names;
+    };
+
+    void run(const QVector<Batch> &batches);
+    void removeBatch(const Batch &batch);
+    void removeDirectories(QStringList directories, bool reportErrors);
+    void addFailure(const QString &path, const QString &errorString);
+    void emitProgress();
+
+private:
+    int m_interval;
+    QThreadPool m_pool;
+    std::atomic<int> m_removed;
+
+    mutable QMutex m_mutex;
+    QString m_currentFile;
+    QSet<QString> m_directories;
+    QStringList m_failedFiles;
+    QStringList m_errors;
+};
+
+} // namespace QInstaller
+
+#endif // FILEREMOVER_H
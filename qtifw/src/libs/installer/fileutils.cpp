@@ -27,6 +27,7 @@
 **************************************************************************/
 #include "fileutils.h"
 
+#include "fileremover.h"
 #include "globals.h"
 #include "constants.h"
 #include "fileio.h"
@@ -279,10 +280,14 @@ protected:
      */
     void run()
     {
-        try {
-            removeDirectory(p, ignore);
-        } catch (const Error &e) {
-            err = e.message();
+        FileRemover remover;
+        remover.removeDirectory(p);
+        foreach (const QString &errorMessage, remover.errors()) {
+            if (!ignore) {
+                err = errorMessage;
+                break;
+            }
+            qCWarning(QInstaller::lcInstallerInstallLog).noquote() << errorMessage;
         }
     }
 
@@ -294,6 +299,9 @@ private:
 
 /*!
     \internal
+
+    Removes the directory at \a path recursively on worker threads, see FileRemover. Throws
+    QInstaller::Error with the first error if removing fails and \a ignoreErrors is \c false.
 */
 void QInstaller::removeDirectoryThreaded(const QString &path, bool ignoreErrors)
 {
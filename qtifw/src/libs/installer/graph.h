@@ -33,6 +33,9 @@
 #include <QList>
 #include <QPair>
 #include <QSet>
+#include <QVector>
+
+#include <algorithm>
 
 namespace QInstaller {
 
@@ -47,12 +50,12 @@ public:
 
     const QList<T> nodes() const
     {
-        return m_graph.keys();
+        return m_nodes;
     }
 
     void addNode(const T &node)
     {
-        m_graph.insert(node, QSet<T>());
+        nodeId(node);
     }
 
     void addNodes(const QList<T> &nodes)
@@ -63,12 +66,23 @@ public:
 
     QList<T> edges(const T &node) const
     {
-        return m_graph.value(node).toList();
+        QList<T> result;
+        const int id = m_ids.value(node, -1);
+        if (id < 0)
+            return result;
+        foreach (int edge, m_adjacency.at(id))
+            result.append(m_nodes.at(edge));
+        return result;
     }
 
     void addEdge(const T &node, const T &edge)
     {
-        m_graph[node].insert(edge);
+        const int nodeIndex = nodeId(node);
+        const QPair<int, int> ids = qMakePair(nodeIndex, nodeId(edge));
+        if (m_edgeSet.contains(ids))
+            return;
+        m_edgeSet.insert(ids);
+        m_adjacency[ids.first].append(ids.second);
     }
 
     void addEdges(const T &node, const QList<T> &edges)
@@ -79,23 +93,69 @@ public:
 
     bool hasCycle() const
     {
-        return m_hasCycle;
+        return !m_cycles.isEmpty();
     }
 
     QPair<T, T> cycle() const
     {
-        return m_cycle;
+        return m_cycles.isEmpty() ? qMakePair(T(), T()) : m_cycles.first();
+    }
+
+    /*
+        Returns every edge found by the last sort() that closes a cycle, as the pair of the node
+        the edge starts at and the node it points back to.
+    */
+    QList<QPair<T, T> > cycles() const
+    {
+        return m_cycles;
     }
 
     QList<T> sort() const
     {
-        QSet<T> visitedNodes;
-        QList<T> resolvedNodes;
+        const int count = m_nodes.count();
+
+        // compressed adjacency: the edges of node i are targets[offsets[i]] to targets[offsets[i + 1]]
+        QVector<int> offsets(count + 1, 0);
+        QVector<int> targets;
+        targets.reserve(m_edgeSet.count());
+        for (int i = 0; i < count; ++i) {
+            targets += m_adjacency.at(i);
+            offsets[i + 1] = targets.count();
+        }
+        QVector<int> nextEdge = offsets; // the next edge to follow for each node
 
-        m_hasCycle = false;
-        m_cycle = qMakePair(T(), T());
-        foreach (const T &node, nodes())
-            visit(node, &resolvedNodes, &visitedNodes);
+        enum State { Unvisited, Visiting, Resolved };
+        QVector<State> states(count, Unvisited);
+        QVector<int> stack;
+        QList<T> resolvedNodes;
+        resolvedNodes.reserve(count);
+
+        m_cycles.clear();
+        for (int root = 0; root < count; ++root) {
+            if (states.at(root) != Unvisited)
+                continue;
+
+            states[root] = Visiting;
+            stack.append(root);
+            while (!stack.isEmpty()) {
+                const int node = stack.last();
+                if (nextEdge.at(node) < offsets.at(node + 1)) {
+                    const int adjacency = targets.at(nextEdge[node]++);
+                    if (states.at(adjacency) == Unvisited) {
+                        states[adjacency] = Visiting;
+                        stack.append(adjacency);
+                    } else if (states.at(adjacency) == Visiting) {
+                        // the node is not yet in the ordered list, we detected a cycle
+                        m_cycles.append(qMakePair(m_nodes.at(node), m_nodes.at(adjacency)));
+                    }
+                } else {
+                    // all adjacency visited, append this node to the ordered list
+                    stack.removeLast();
+                    states[node] = Resolved;
+                    resolvedNodes.append(m_nodes.at(node));
+                }
+            }
+        }
         return resolvedNodes;
     }
 
@@ -107,38 +167,24 @@ public:
     }
 
 private:
-    void visit(const T &node, QList<T> *const resolvedNodes, QSet<T> *const visitedNodes) const
+    int nodeId(const T &node)
     {
-        if (m_hasCycle)
-            return;
-
-        // if we visited this node already
-        if (visitedNodes->contains(node)) {
-            // and if the node is already in the ordered list
-            if (resolvedNodes->contains(node))
-                return;
-
-            m_hasCycle = true;
-            m_cycle.second = node;
-            return; // if not yet in the ordered list, we detected a cycle
-        }
-
-        // mark this node as visited
-        visitedNodes->insert(node);
-
-        m_cycle.first = node;
-        // recursively visit all adjacency
-        foreach (const T &adjacency, edges(node))
-            visit(adjacency, resolvedNodes, visitedNodes);
-
-        // append this node to the ordered list
-        resolvedNodes->append(node);
+        typename QHash<T, int>::const_iterator it = m_ids.constFind(node);
+        if (it != m_ids.constEnd())
+            return it.value();
+        const int id = m_nodes.count();
+        m_ids.insert(node, id);
+        m_nodes.append(node);
+        m_adjacency.append(QVector<int>());
+        return id;
     }
 
 private:
-    mutable bool m_hasCycle;
-    QHash<T, QSet<T> > m_graph;
-    mutable QPair<T,T> m_cycle;
+    QHash<T, int> m_ids;
+    QList<T> m_nodes; // by id, in the order they were added
+    QVector<QVector<int> > m_adjacency; // by id, in the order the edges were added
+    QSet<QPair<int, int> > m_edgeSet;
+    mutable QList<QPair<T, T> > m_cycles;
 };
 
 }
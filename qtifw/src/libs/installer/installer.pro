@@ -43,8 +43,10 @@ QT += \
 win32:QT += winextras
 
 HEADERS += packagemanagercore.h \
+    archivecache.h \
     aspectratiolabel.h \
     loggingutils.h \
+    mirrorselector.h \
     packagemanagercore_p.h \
     packagemanagergui.h \
     binaryformat.h \
@@ -135,6 +137,9 @@ HEADERS += packagemanagercore.h \
     lib7z_create.h \
     lib7z_extract.h \
     lib7z_list.h \
+    lib7z_archive.h \
+    filemanifest.h \
+    fileremover.h \
     repositorycategory.h \
     componentselectionpage_p.h \
     commandlineparser.h \
@@ -147,8 +152,10 @@ win32 {
 }
 
 SOURCES += packagemanagercore.cpp \
+    archivecache.cpp \
     aspectratiolabel.cpp \
     loggingutils.cpp \
+    mirrorselector.cpp \
     packagemanagercore_p.cpp \
     packagemanagergui.cpp \
     binaryformat.cpp \
@@ -156,6 +163,8 @@ SOURCES += packagemanagercore.cpp \
     binaryformatenginehandler.cpp \
     repository.cpp \
     fileutils.cpp \
+    filemanifest.cpp \
+    fileremover.cpp \
     utils.cpp \
     component.cpp \
     scriptengine.cpp \
@@ -35,6 +35,8 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 namespace QInstaller {
 
 /*!
@@ -114,11 +116,88 @@ QString InstallerCalculator::recursionError(Component *component)
         "already added with reason: \"%2\"").arg(component->name(), installReason(component));
 }
 
+/*
+    Indexes the components by name, position and auto depend on names. Dependencies and auto
+    dependencies can be changed by scripts at any time, so the indexes are only kept for the
+    duration of a calculation.
+*/
+void InstallerCalculator::updateIndexes()
+{
+    m_componentsByName.clear();
+    m_componentPositions.clear();
+    m_autoDependees.clear();
+    for (int i = 0; i < m_allComponents.count(); ++i) {
+        Component *component = m_allComponents.at(i);
+        const QString name = component->name();
+        if (!name.isEmpty() && !m_componentsByName.contains(name))
+            m_componentsByName.insert(name, component);
+        m_componentPositions.insert(component, i);
+        foreach (const QString &autoDependOn, component->autoDependencies())
+            m_autoDependees[autoDependOn].append(component);
+    }
+}
+
+/*
+    Returns the first component matching \a name, which can contain a version requirement, like
+    PackageManagerCore::componentByName() does for the list of all components.
+*/
+Component *InstallerCalculator::componentByName(const QString &name) const
+{
+    if (name.isEmpty())
+        return nullptr;
+
+    QString fixedName;
+    QString fixedVersion;
+    PackageManagerCore::parseNameAndVersion(name, &fixedName, &fixedVersion);
+
+    Component *component = m_componentsByName.value(fixedName);
+    if (!component || fixedVersion.isEmpty()
+            || PackageManagerCore::versionMatches(component->value(scVersion), fixedVersion)) {
+        return component;
+    }
+    foreach (Component *candidate, m_allComponents) {
+        if (candidate->name() == fixedName
+                && PackageManagerCore::versionMatches(candidate->value(scVersion), fixedVersion)) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+/*
+    Returns the components that auto depend on any of \a addedComponentIds, in the order of all
+    components. A component that did not auto depend on the components to install before can only
+    do so once one of its auto depend on names was added.
+*/
+QList<Component *> InstallerCalculator::autoDependOnCandidates(const QSet<QString> &addedComponentIds) const
+{
+    QSet<Component *> candidates;
+    foreach (const QString &id, addedComponentIds) {
+        foreach (Component *component, m_autoDependees.value(id))
+            candidates.insert(component);
+    }
+
+    QList<Component *> result = candidates.toList();
+    std::sort(result.begin(), result.end(), [this](Component *lhs, Component *rhs) {
+        return m_componentPositions.value(lhs) < m_componentPositions.value(rhs);
+    });
+    return result;
+}
+
 bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &components)
+{
+    updateIndexes();
+    return appendComponentsToInstall(components, true);
+}
+
+bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &components,
+    bool checkAllAutoDependOn)
 {
     if (components.isEmpty())
         return true;
 
+    const QSet<QString> componentIdsBefore = m_toInstallComponentIds;
+
     QList<Component*> notAppendedComponents; // for example components with unresolved dependencies
     foreach (Component *component, components){
         if (m_toInstallComponentIds.contains(component->name())) {
@@ -141,9 +220,14 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
             return false;
     }
 
-    QList<Component *> foundAutoDependOnList;
     // All regular dependencies are resolved. Now we are looking for auto depend on components.
-    foreach (Component *component, m_allComponents) {
+    // Components installed already can satisfy auto dependencies as well, so the first pass checks
+    // all components, the following ones only those affected by the newly added components.
+    const QList<Component *> candidates = checkAllAutoDependOn ? m_allComponents
+        : autoDependOnCandidates(QSet<QString>(m_toInstallComponentIds).subtract(componentIdsBefore));
+
+    QList<Component *> foundAutoDependOnList;
+    foreach (Component *component, candidates) {
         // If a components is already installed or is scheduled for installation, no need to check
         // for auto depend installation.
         if ((!component->isInstalled() || component->updateRequested())
@@ -158,7 +242,7 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
     }
 
     if (!foundAutoDependOnList.isEmpty())
-        return appendComponentsToInstall(foundAutoDependOnList);
+        return appendComponentsToInstall(foundAutoDependOnList, false);
     return true;
 }
 
@@ -169,8 +253,7 @@ bool InstallerCalculator::appendComponentToInstall(Component *component, const Q
     foreach (const QString &dependencyComponentName, allDependencies) {
         // PackageManagerCore::componentByName returns 0 if dependencyComponentName contains a
         // version which is not available
-        Component *dependencyComponent =
-            PackageManagerCore::componentByName(dependencyComponentName, m_allComponents);
+        Component *dependencyComponent = componentByName(dependencyComponentName);
         if (!dependencyComponent) {
             const QString errorMessage = QCoreApplication::translate("InstallerCalculator",
                 "Cannot find missing dependency \"%1\" for \"%2\".").arg(dependencyComponentName,
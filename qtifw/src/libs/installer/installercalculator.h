@@ -65,10 +65,19 @@ private:
                              InstallReasonType installReasonType,
                              const QString &referencedComponentName = QString());
     void realAppendToInstallComponents(Component *component, const QString &version = QString());
+    bool appendComponentsToInstall(const QList<Component*> &components, bool checkAllAutoDependOn);
     bool appendComponentToInstall(Component *components, const QString &version = QString());
     QString recursionError(Component *component);
 
+    void updateIndexes();
+    Component *componentByName(const QString &name) const;
+    QList<Component*> autoDependOnCandidates(const QSet<QString> &addedComponentIds) const;
+
     QList<Component*> m_allComponents;
+    // indexes of m_allComponents, updated whenever a calculation starts
+    QHash<QString, Component*> m_componentsByName; // the first component of each name
+    QHash<Component*, int> m_componentPositions;
+    QHash<QString, QList<Component*> > m_autoDependees; // by the names in their auto depend on
     QHash<Component*, QSet<Component*> > m_visitedComponents;
     QSet<QString> m_toInstallComponentIds; //for faster lookups
     QString m_componentsToInstallError;
@@ -35,6 +35,7 @@
 #include <7zip/UI/Common/Update.h>
 
 QT_BEGIN_NAMESPACE
+class QCryptographicHash;
 class QFileDevice;
 class QStringList;
 QT_END_NAMESPACE
@@ -55,6 +56,11 @@ namespace Lib7z
         Ultra = 9
     };
 
+    enum struct Method {
+        Lzma2,
+        Zstd
+    };
+
     class INSTALLER_EXPORT UpdateCallback : public IUpdateCallbackUI2, public CMyUnknownImp
     {
         Q_DISABLE_COPY(UpdateCallback)
@@ -67,10 +73,14 @@ namespace Lib7z
         INTERFACE_IUpdateCallbackUI2(;)
     };
 
+    bool INSTALLER_EXPORT isSupportedMethod(Method method);
+
     void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sources,
-        Compression level = Compression::Normal, UpdateCallback *callback = 0);
+        Compression level = Compression::Normal, Method method = Method::Lzma2,
+        UpdateCallback *callback = 0, QCryptographicHash *hash = 0);
     void INSTALLER_EXPORT createArchive(const QString &archive, const QStringList &sources,
-        TmpFile mode, Compression level = Compression::Normal, UpdateCallback *callback = 0);
+        TmpFile mode, Compression level = Compression::Normal, Method method = Method::Lzma2,
+        UpdateCallback *callback = 0);
 
 } // namespace Lib7z
 
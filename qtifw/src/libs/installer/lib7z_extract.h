@@ -46,6 +46,8 @@
 
 #include <QString>
 
+#include <memory>
+
 class CArc;
 
 QT_BEGIN_NAMESPACE
@@ -54,6 +56,8 @@ QT_END_NAMESPACE
 
 namespace Lib7z
 {
+    class ExtractSink;
+
     class INSTALLER_EXPORT ExtractCallback : public IArchiveExtractCallback, public CMyUnknownImp
     {
         Q_DISABLE_COPY(ExtractCallback)
@@ -63,7 +67,8 @@ namespace Lib7z
         virtual ~ExtractCallback() = default;
 
         void setArchive(CArc *carc) { arc = carc; }
-        void setTarget(const QString &dir) { targetDir = dir; }
+        void setTarget(const QString &dir) { targetDir = dir; sink.reset(); }
+        void setDeduplicateFiles(bool enable) { deduplicate = enable; }
 
         MY_UNKNOWN_IMP
         INTERFACE_IArchiveExtractCallback(;)
@@ -74,16 +79,23 @@ namespace Lib7z
         virtual HRESULT setCompleted(quint64 /*completed*/, quint64 /*total*/) { return S_OK; }
 
     private:
+        friend class FolderExtractCallback;
+        friend class ArchiveHandle;
+
+        HRESULT waitForFiles();
+
         CArc *arc = 0;
 
         QString targetDir;
         quint64 total = 0;
         quint64 completed = 0;
         quint32 currentIndex = 0;
+        bool deduplicate = false;
+        std::shared_ptr<ExtractSink> sink;
     };
 
     void INSTALLER_EXPORT extractArchive(QFileDevice *archive, const QString &targetDirectory,
-        ExtractCallback *callback = 0);
+        ExtractCallback *callback = 0, int threads = 1);
 
 } // namespace Lib7z
 
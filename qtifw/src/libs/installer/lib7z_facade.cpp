@@ -31,6 +31,7 @@
 #include "errors.h"
 #include "fileio.h"
 
+#include "lib7z_archive.h"
 #include "lib7z_create.h"
 #include "lib7z_extract.h"
 #include "lib7z_list.h"
@@ -54,15 +55,28 @@
 #include <Windows/PropVariantConv.h>
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDir>
+#include <QFileDevice>
 #include <QFileInfo>
+#include <QHash>
 #include <QIODevice>
+#include <QMutex>
 #include <QPointer>
-#include <QReadWriteLock>
+#include <QSemaphore>
+#include <QSet>
 #include <QTemporaryFile>
-
+#include <QThread>
+#include <QThreadStorage>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <mutex>
 #include <memory>
+#include <numeric>
 
 #ifdef Q_OS_WIN
 HINSTANCE g_hInstance = nullptr;
@@ -79,6 +93,12 @@ extern "C" int global_use_utf16_conversion;
 
 #include <myWindows/config.h>
 #include <sys/stat.h>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 #endif
 
 namespace NArchive {
@@ -106,6 +126,9 @@ void registerCodecBCJ();
 void registerCodecBCJ2();
 
 void registerCodecLZMA();
+#ifdef IFW_ZSTD
+void registerCodecZSTD();
+#endif
 void registerCodecLZMA2();
 
 void registerCodecCopy();
@@ -197,8 +220,13 @@ namespace Lib7z {
 
 std::once_flag gOnceFlag;
 
+// The registry of codecs and archive formats, loaded once and only read afterwards.
+Q_GLOBAL_STATIC(CCodecs, sharedCodecs)
+static HRESULT gCodecsLoadResult = E_FAIL;
+
 /*!
-    Initializes 7z and registers codecs and compression methods.
+    Initializes 7z, registers codecs and compression methods, and loads the codec registry
+    shared by all archive operations.
 */
 void initSevenZ()
 {
@@ -210,6 +238,9 @@ void initSevenZ()
 
         registerCodecLZMA();
         registerCodecLZMA2();
+#ifdef IFW_ZSTD
+        registerCodecZSTD();
+#endif
 
         registerCodecCopy();
         registerCodecDelta();
@@ -233,27 +264,40 @@ void initSevenZ()
         global_use_utf16_conversion = 0;
 # endif
 #endif
+        gCodecsLoadResult = sharedCodecs()->Load();
     });
 }
 
+/*
+    Returns the shared codec registry. It is safe to use from several threads at once, as the
+    archive handlers only read from it.
+
+    \note Throws SevenZipException if the codecs cannot be loaded.
+*/
+static CCodecs *codecs()
+{
+    initSevenZ();
+    if (gCodecsLoadResult != S_OK)
+        throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
+    return sharedCodecs();
+}
+
 
 // -- error handling
 
-Q_GLOBAL_STATIC(QString, getLastErrorString)
-Q_GLOBAL_STATIC(QReadWriteLock, lastErrorReadWriteLock)
+// The error is kept per thread, so that concurrent extractions do not report each other's
+// errors. An archive handler calls the extract callback, and with it everything that sets the
+// error, on the thread that called Extract() and reads the error afterwards.
+Q_GLOBAL_STATIC(QThreadStorage<QString>, lastErrorString)
 
 QString lastError()
 {
-    QReadLocker locker(lastErrorReadWriteLock());
-    Q_UNUSED(locker)
-    return *getLastErrorString();
+    return lastErrorString()->localData();
 }
 
 void setLastError(const QString &errorString)
 {
-    QWriteLocker locker(lastErrorReadWriteLock());
-    Q_UNUSED(locker)
-    *getLastErrorString() = errorString;
+    lastErrorString()->setLocalData(errorString);
 }
 
 QString errorMessageFrom7zResult(const LONG  &extractResult)
@@ -431,6 +475,16 @@ static quint32 getUInt32Property(IInArchive *archive, int index, int propId, qui
     return static_cast<quint32>(prop.ulVal);
 }
 
+static bool isSymlink(IInArchive *archive, int index)
+{
+    const quint32 attributes = getUInt32Property(archive, index, kpidAttrib, 0);
+    if (!(attributes & FILE_ATTRIBUTE_UNIX_EXTENSION))
+        return false;
+    struct stat stat_info;
+    stat_info.st_mode = attributes >> 16;
+    return S_ISLNK(stat_info.st_mode);
+}
+
 static QFile::Permissions getPermissions(IInArchive *archive, int index, bool *hasPermissions)
 {
     quint32 attributes = getUInt32Property(archive, index, kpidAttrib, 0);
@@ -455,44 +509,558 @@ static QFile::Permissions getPermissions(IInArchive *archive, int index, bool *h
     Q_ASSERT(X->is ## MODE()); \
     Q_ASSERT(!X->isSequential());
 
-class QIODeviceSequentialOutStream : public ISequentialOutStream, public CMyUnknownImp
+// Extracted files are written in blocks of this size, smaller writes of the decoder are collected.
+static const int scWriteBufferSize = 1024 * 1024;
+// Maximum number of extracted files waiting to be closed in the background.
+static const int scMaxPendingFiles = 64;
+
+/*
+    Reserves \a size bytes on disk for \a file, so the file system can allocate it in one piece.
+    Failures are ignored, the file then grows while it is written.
+*/
+static void preallocate(QFile *file, quint64 size)
+{
+#ifdef Q_OS_LINUX
+    // FALLOC_FL_KEEP_SIZE leaves the file size alone, and unlike posix_fallocate() the call
+    // fails instead of writing zeros on file systems without support for it.
+    if (size > 0)
+        ::fallocate(file->handle(), FALLOC_FL_KEEP_SIZE, 0, off_t(size));
+#else
+    Q_UNUSED(file)
+    Q_UNUSED(size)
+#endif
+}
+
+/*
+    A file being extracted. The file is opened unbuffered, the data of the decoder is collected
+    and written in large blocks.
+*/
+class BufferedFile
+{
+    Q_DISABLE_COPY(BufferedFile)
+
+public:
+    BufferedFile(std::unique_ptr<QFile> file, quint64 size)
+        : m_file(std::move(file))
+    {
+        // reserving marks the capacity as reserved, so resize(0) keeps the memory
+        m_buffer.reserve(int(qMin(size, quint64(scWriteBufferSize))));
+    }
+
+    QString fileName() const {
+        return m_file->fileName();
+    }
+
+    QString errorString() const {
+        return m_errorString;
+    }
+
+    bool write(const char *data, qint64 size)
+    {
+        if (m_buffer.size() + size > scWriteBufferSize && !flush())
+            return false;
+        if (size >= scWriteBufferSize)
+            return writeToFile(data, size);
+        m_buffer.append(data, int(size));
+        return true;
+    }
+
+    bool close()
+    {
+        const bool success = flush();
+        m_file->close();
+        return success;
+    }
+
+private:
+    bool flush()
+    {
+        const bool success = writeToFile(m_buffer.constData(), m_buffer.size());
+        m_buffer.resize(0);
+        return success;
+    }
+
+    bool writeToFile(const char *data, qint64 size)
+    {
+        while (size > 0) {
+            const qint64 written = m_file->write(data, size);
+            if (written <= 0) {
+                m_errorString = m_file->errorString();
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<QFile> m_file;
+    QByteArray m_buffer;
+    QString m_errorString;
+};
+
+/*
+    Opens \a fileName for an extracted item of \a size bytes. Sets the last error and returns a
+    null pointer on failure.
+*/
+static std::shared_ptr<BufferedFile> openExtractedFile(const QString &fileName, quint64 size)
+{
+    std::unique_ptr<QFile> file(new QFile(fileName));
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                                                 "Cannot open file \"%1\" for writing: %2").arg(
+                         QDir::toNativeSeparators(fileName), file->errorString()));
+        return std::shared_ptr<BufferedFile>();
+    }
+    preallocate(file.get(), size);
+    return std::make_shared<BufferedFile>(std::move(file), size);
+}
+
+class BufferedFileOutStream : public ISequentialOutStream, public CMyUnknownImp
 {
-    Q_DISABLE_COPY(QIODeviceSequentialOutStream)
+    Q_DISABLE_COPY(BufferedFileOutStream)
 
 public:
     MY_UNKNOWN_IMP
 
-    explicit QIODeviceSequentialOutStream(std::unique_ptr<QIODevice> device)
+    explicit BufferedFileOutStream(const std::shared_ptr<BufferedFile> &file)
         : ISequentialOutStream()
-        , m_device(std::move(device))
+        , m_file(file)
+    {}
+
+    STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+    {
+        if (processedSize)
+            *processedSize = 0;
+
+        if (!m_file->write(reinterpret_cast<const char*>(data), size)) {
+            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(m_file->fileName()),
+                m_file->errorString()));
+            return E_FAIL;
+        }
+
+        if (processedSize)
+            *processedSize = size;
+        return S_OK;
+    }
+
+private:
+    std::shared_ptr<BufferedFile> m_file;
+};
+
+/*
+    Identifies an extracted file for deduplication: the size, CRC and attributes of its item.
+*/
+struct DuplicateKey
+{
+    quint64 size;
+    quint32 crc;
+    quint32 attributes;
+};
+
+inline bool operator==(const DuplicateKey &lhs, const DuplicateKey &rhs)
+{
+    return lhs.size == rhs.size && lhs.crc == rhs.crc && lhs.attributes == rhs.attributes;
+}
+
+inline uint qHash(const DuplicateKey &key, uint seed = 0)
+{
+    return ::qHash(key.size, seed) ^ key.crc ^ (key.attributes << 7);
+}
+
+// Smaller items are always written, linking them saves too little.
+static const quint64 scMinDuplicateSize = 4096;
+
+/*
+    Returns the deduplication key of the item \a index in \a key. Returns \c false if the item
+    has no CRC or is too small to be deduplicated.
+*/
+static bool getDuplicateKey(IInArchive *archive, UInt32 index, DuplicateKey *key)
+{
+    const NCOM::CPropVariant crc = readProperty(archive, index, kpidCRC);
+    if (crc.vt != VT_UI4)
+        return false;
+    key->size = getUInt64Property(archive, index, kpidSize, 0);
+    key->crc = crc.ulVal;
+    key->attributes = getUInt32Property(archive, index, kpidAttrib, 0);
+    return key->size >= scMinDuplicateSize;
+}
+
+/*
+    The files written by all extractions of this process that deduplicate, by the key of their
+    archive item. The content of a candidate is compared before it is used, so entries for files
+    that were changed or removed since do no harm.
+*/
+class DuplicateIndex
+{
+    Q_DISABLE_COPY(DuplicateIndex)
+
+public:
+    static DuplicateIndex &instance()
+    {
+        static DuplicateIndex index;
+        return index;
+    }
+
+    QString find(const DuplicateKey &key) const
+    {
+        QMutexLocker _(&m_mutex);
+        return m_files.value(key);
+    }
+
+    void insert(const DuplicateKey &key, const QString &fileName)
+    {
+        QMutexLocker _(&m_mutex);
+        m_files.insert(key, fileName);
+    }
+
+private:
+    DuplicateIndex() = default;
+
+    mutable QMutex m_mutex;
+    QHash<DuplicateKey, QString> m_files;
+};
+
+/*
+    Creates \a fileName as a reflink of \a original, so that both share their data until one of
+    them is written. Returns \c false if the file system does not support reflinks. A hard link
+    is never created, as writing to one file would change the other one as well.
+*/
+static bool cloneFile(const QString &original, const QString &fileName)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    const int source = ::open(QFile::encodeName(original).constData(), O_RDONLY | O_CLOEXEC);
+    if (source >= 0) {
+        const int target = ::open(QFile::encodeName(fileName).constData(),
+            O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        bool cloned = false;
+        if (target >= 0) {
+            cloned = ::ioctl(target, FICLONE, source) == 0;
+            ::close(target);
+            if (!cloned)
+                ::unlink(QFile::encodeName(fileName).constData());
+        }
+        ::close(source);
+        if (cloned)
+            return true;
+    }
+#else
+    Q_UNUSED(original)
+    Q_UNUSED(fileName)
+#endif
+    return false;
+}
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+/*
+    Returns the file system \a path is located on, or the one of its closest existing parent
+    directory if \a path does not exist yet.
+*/
+static dev_t fileSystemOf(const QString &path)
+{
+    QString existing = path;
+    struct stat st;
+    while (::stat(QFile::encodeName(existing).constData(), &st) != 0) {
+        const QString parent = QFileInfo(existing).path();
+        if (parent == existing)
+            return 0;
+        existing = parent;
+    }
+    return st.st_dev;
+}
+#endif
+
+/*
+    Returns \c true if files extracted to \a directory can be created as reflinks of \a original.
+    Whether the file system of \a directory supports reflinks is probed only once for each
+    directory, by cloning a temporary file. Without reflinks, deduplicating a file would read
+    back and compare the original before copying it, which is more work than writing the file.
+*/
+static bool supportsReflinks(const QString &directory, const QString &original = QString())
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    static QMutex mutex;
+    static QHash<QString, dev_t> fileSystems; // by directory, 0 if there are no reflinks
+
+    QMutexLocker locker(&mutex);
+    if (!fileSystems.contains(directory)) {
+        QString existing = directory;
+        while (!QFileInfo(existing).isDir() && QFileInfo(existing).path() != existing)
+            existing = QFileInfo(existing).path();
+        QTemporaryFile source(existing + QLatin1String("/.reflink-XXXXXX"));
+        QTemporaryFile target(existing + QLatin1String("/.reflink-XXXXXX"));
+        const bool supported = source.open() && target.open() && source.write("reflink") == 7
+            && source.flush() && ::ioctl(target.handle(), FICLONE, source.handle()) == 0;
+        fileSystems.insert(directory, supported ? fileSystemOf(existing) : 0);
+    }
+    const dev_t fileSystem = fileSystems.value(directory);
+    locker.unlock();
+
+    if (fileSystem == 0)
+        return false;
+    return original.isEmpty() || fileSystemOf(original) == fileSystem;
+#else
+    Q_UNUSED(directory)
+    Q_UNUSED(original)
+    return false;
+#endif
+}
+
+/*
+    An extracted file that is expected to equal an already extracted file. The decoded data is
+    compared with the original instead of being written. Once the data differs, the file is
+    written as usual, starting with the part that matched.
+*/
+class DuplicateFile
+{
+    Q_DISABLE_COPY(DuplicateFile)
+
+public:
+    DuplicateFile(const QString &original, const QString &fileName, quint64 size)
+        : m_original(original)
+        , m_fileName(fileName)
+        , m_size(size)
+    {}
+
+    bool open()
     {
-        LIB7Z_ASSERTS(m_device, Writable)
+        return m_original.open(QIODevice::ReadOnly) && quint64(m_original.size()) == m_size;
+    }
+
+    QString fileName() const {
+        return m_fileName;
     }
 
     QString errorString() const {
-        return m_errorString;
+        return m_file ? m_file->errorString() : QString();
+    }
+
+    bool write(const char *data, qint64 size)
+    {
+        if (!m_file) {
+            m_buffer.resize(int(size));
+            if (m_original.read(m_buffer.data(), size) == size
+                    && memcmp(m_buffer.constData(), data, size_t(size)) == 0) {
+                m_matched += size;
+                return true;
+            }
+            if (!file())
+                return false;
+        }
+        return m_file->write(data, size);
+    }
+
+    /*
+        Returns \c true if all data equals the original, so that the file can be created from it.
+    */
+    bool isDuplicate() const
+    {
+        return !m_file && quint64(m_matched) == m_size;
+    }
+
+    /*
+        Creates the file as a reflink of the original. It is copied if cloning fails nevertheless,
+        for example because the quota is exceeded. Sets the last error on failure.
+    */
+    bool link()
+    {
+        m_original.close();
+        if (QFileInfo::exists(m_fileName))
+            QFile::remove(m_fileName);  // replaced like a written file, which is truncated
+        if (cloneFile(m_original.fileName(), m_fileName) || QFile::copy(m_original.fileName(),
+                m_fileName)) {
+            return true;
+        }
+        setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+            "Cannot create file \"%1\" from \"%2\".").arg(QDir::toNativeSeparators(m_fileName),
+            QDir::toNativeSeparators(m_original.fileName())));
+        return false;
+    }
+
+    /*
+        Returns the file the data is written to, it is created with the matched part of the
+        original if needed. Sets the last error and returns a null pointer on failure.
+    */
+    std::shared_ptr<BufferedFile> file()
+    {
+        if (m_file)
+            return m_file;
+
+        const std::shared_ptr<BufferedFile> file = openExtractedFile(m_fileName, m_size);
+        if (!file)
+            return file;
+        qint64 remaining = m_matched;
+        if (!m_original.seek(0))
+            remaining = -1;
+        while (remaining > 0) {
+            m_buffer.resize(int(qMin<qint64>(remaining, scWriteBufferSize)));
+            if (m_original.read(m_buffer.data(), m_buffer.size()) != m_buffer.size()
+                    || !file->write(m_buffer.constData(), m_buffer.size())) {
+                break;
+            }
+            remaining -= m_buffer.size();
+        }
+        m_original.close();
+        if (remaining != 0) {
+            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(m_fileName),
+                file->errorString().isEmpty() ? m_original.errorString() : file->errorString()));
+            return std::shared_ptr<BufferedFile>();
+        }
+        m_file = file;
+        return m_file;
     }
 
+private:
+    QFile m_original;
+    const QString m_fileName;
+    const quint64 m_size;
+    qint64 m_matched = 0;
+    QByteArray m_buffer;
+    std::shared_ptr<BufferedFile> m_file;
+};
+
+class DuplicateFileOutStream : public ISequentialOutStream, public CMyUnknownImp
+{
+    Q_DISABLE_COPY(DuplicateFileOutStream)
+
+public:
+    MY_UNKNOWN_IMP
+
+    explicit DuplicateFileOutStream(const std::shared_ptr<DuplicateFile> &file)
+        : ISequentialOutStream()
+        , m_file(file)
+    {}
+
     STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
     {
         if (processedSize)
             *processedSize = 0;
 
-        const qint64 written = m_device->write(reinterpret_cast<const char*>(data), size);
-        if (written == -1) {
-            m_errorString = m_device->errorString();
+        if (!m_file->write(reinterpret_cast<const char*>(data), size)) {
+            if (!m_file->errorString().isEmpty()) {
+                setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                    "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(m_file
+                    ->fileName()), m_file->errorString()));
+            }
             return E_FAIL;
         }
 
         if (processedSize)
-            *processedSize = written;
-        m_errorString.clear();
+            *processedSize = size;
+        return S_OK;
+    }
+
+private:
+    std::shared_ptr<DuplicateFile> m_file;
+};
+
+/*
+    Collects the content of a symlink item, the link target, in memory.
+*/
+class SymlinkTargetOutStream : public ISequentialOutStream, public CMyUnknownImp
+{
+    Q_DISABLE_COPY(SymlinkTargetOutStream)
+
+public:
+    MY_UNKNOWN_IMP
+
+    explicit SymlinkTargetOutStream(const std::shared_ptr<QByteArray> &target)
+        : ISequentialOutStream()
+        , m_target(target)
+    {}
+
+    STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+    {
+        m_target->append(reinterpret_cast<const char*>(data), int(size));
+        if (processedSize)
+            *processedSize = size;
         return S_OK;
     }
 
 private:
+    std::shared_ptr<QByteArray> m_target;
+};
+
+/*
+    The output side of one extraction: the directories known to exist, the files being written,
+    and the files being closed in the background. Only the background jobs run concurrently to
+    the extraction, they touch nothing but their own file.
+*/
+class ExtractSink
+{
+    Q_DISABLE_COPY(ExtractSink)
+
+public:
+    ExtractSink()
+        : m_closeInBackground(QThread::idealThreadCount() > 1)
+        , m_pendingFiles(scMaxPendingFiles)
+    {
+        m_closer.setMaxThreadCount(qBound(2, QThread::idealThreadCount() / 2, 8));
+    }
+
+    ~ExtractSink()
+    {
+        m_closer.waitForDone();
+    }
+
+    /*
+        Closes \a file in the background and calls \a finish afterwards, to apply the file
+        attributes. Blocks while too many files are waiting to be closed.
+    */
+    void closeLater(const std::shared_ptr<BufferedFile> &file, const std::function<void()> &finish)
+    {
+        // With a single core, handing the file to another thread costs more than closing it.
+        if (!m_closeInBackground) {
+            close(file, finish);
+            return;
+        }
+        m_pendingFiles.acquire();
+        QtConcurrent::run(&m_closer, [this, file, finish]() {
+            close(file, finish);
+            m_pendingFiles.release();
+        });
+    }
+
+    /*
+        Waits until all files are closed. Returns the error of the first file that could not be
+        written, or an empty string.
+    */
+    QString waitForFiles()
+    {
+        m_closer.waitForDone();
+        QMutexLocker _(&m_mutex);
+        return m_errorString;
+    }
+
+    QSet<QString> directories;
+    QHash<UInt32, std::shared_ptr<BufferedFile>> openFiles;
+    QHash<UInt32, std::shared_ptr<QByteArray>> symlinkTargets;
+    QHash<UInt32, std::shared_ptr<DuplicateFile>> duplicates;
+
+private:
+    void close(const std::shared_ptr<BufferedFile> &file, const std::function<void()> &finish)
+    {
+        if (file->close()) {
+            finish();
+            return;
+        }
+        QMutexLocker _(&m_mutex);
+        if (m_errorString.isEmpty()) {
+            m_errorString = QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(file->fileName()),
+                file->errorString());
+        }
+    }
+
+private:
+    const bool m_closeInBackground;
+    QThreadPool m_closer;
+    QSemaphore m_pendingFiles;
+    QMutex m_mutex;
     QString m_errorString;
-    std::unique_ptr<QIODevice> m_device;
 };
 
 class QIODeviceInStream : public IInStream, public CMyUnknownImp
@@ -554,83 +1122,147 @@ private:
     QPointer<QIODevice> m_device;
 };
 
-bool operator==(const File &lhs, const File &rhs)
+/*
+    Writes the archive created by the update engine straight into a file device. Positions are
+    relative to the device position at construction, so an archive can be appended to data
+    already written to the device.
+*/
+class QIODeviceOutStream : public IOutStream, public CMyUnknownImp
 {
-    return lhs.path == rhs.path
-        && lhs.utcTime == rhs.utcTime
-        && lhs.isDirectory == rhs.isDirectory
-        && lhs.compressedSize == rhs.compressedSize
-        && lhs.uncompressedSize == rhs.uncompressedSize
-        && (lhs.permissions == rhs.permissions
-        || lhs.permissions == static_cast<QFile::Permissions>(-1)
+    Q_DISABLE_COPY(QIODeviceOutStream)
+
+public:
+    MY_UNKNOWN_IMP
+
+    explicit QIODeviceOutStream(QFileDevice *device)
+        : IOutStream()
+        , CMyUnknownImp()
+        , m_device(device)
+        , m_offset(device->pos())
+    {
+        LIB7Z_ASSERTS(device, Writable)
+    }
+
+    qint64 offset() const { return m_offset; }
+    qint64 size() const { return m_size; }
+
+    STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+    {
+        if (processedSize)
+            *processedSize = 0;
+        if (m_device.isNull())
+            return E_FAIL;
+
+        // a short write is repeated, the callers do not expect the rest to be dropped
+        const char *buffer = static_cast<const char *>(data);
+        qint64 written = 0;
+        while (written < qint64(size)) {
+            const qint64 count = m_device->write(buffer + written, size - written);
+            if (count <= 0)
+                return E_FAIL;
+            written += count;
+            if (processedSize)
+                *processedSize = UInt32(written);
+        }
+        m_size = qMax(m_size, m_device->pos() - m_offset);
+        return S_OK;
+    }
+
+    STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition)
+    {
+        if (m_device.isNull())
+            return E_FAIL;
+
+        qint64 np = 0;
+        switch (seekOrigin) {
+            case STREAM_SEEK_SET:
+                np = offset;
+                break;
+            case STREAM_SEEK_CUR:
+                np = m_device->pos() - m_offset + offset;
+                break;
+            case STREAM_SEEK_END:
+                np = m_size + offset;
+                break;
+            default:
+                return STG_E_INVALIDFUNCTION;
+        }
+        if (np < 0)
+            return HRESULT_WIN32_ERROR_NEGATIVE_SEEK;
+
+        const bool ok = m_device->seek(m_offset + np);
+        if (newPosition)
+            *newPosition = np;
+        return ok ? S_OK : E_FAIL;
+    }
+
+    STDMETHOD(SetSize)(UInt64 newSize)
+    {
+        if (m_device.isNull())
+            return E_FAIL;
+        // the device is only grown, data after the stream's range belongs to someone else
+        const qint64 end = m_offset + qint64(newSize);
+        if (end > m_device->size() && !m_device->resize(end))
+            return E_FAIL;
+        m_size = newSize;
+        return S_OK;
+    }
+
+private:
+    QPointer<QFileDevice> m_device;
+    const qint64 m_offset;
+    qint64 m_size = 0;
+};
+
+bool operator==(const File &lhs, const File &rhs)
+{
+    return lhs.path == rhs.path
+        && lhs.utcTime == rhs.utcTime
+        && lhs.isDirectory == rhs.isDirectory
+        && lhs.compressedSize == rhs.compressedSize
+        && lhs.uncompressedSize == rhs.uncompressedSize
+        && (lhs.permissions == rhs.permissions
+        || lhs.permissions == static_cast<QFile::Permissions>(-1)
         || rhs.permissions == static_cast<QFile::Permissions>(-1));
 }
 
-/*!
-   Returns a list of files belonging to an \a archive.
+/*
+    Opens \a archive into \a archiveLink, using the shared codec registry.
+
+    \note Throws SevenZipException if the codecs cannot be loaded.
 */
-QVector<File> listArchive(QFileDevice *archive)
+static HRESULT openArchiveLink(QFileDevice *archive, CArchiveLink *archiveLink)
 {
-    LIB7Z_ASSERTS(archive, Readable)
+    COpenOptions op;
+    op.codecs = codecs();
 
-    const qint64 initialPos = archive->pos();
-    try {
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
+    CObjectVector<COpenType> types;
+    op.types = &types;  // Empty, because we use a stream.
 
-        COpenOptions op;
-        op.codecs = &codecs;
+    CIntVector excluded;
+    op.excludedFormats = &excluded;
 
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
+    const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
+    op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
 
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
+    CObjectVector<CProperty> properties;
+    op.props = &properties;
 
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
+    return archiveLink->Open2(op, nullptr);
+}
 
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
+/*!
+   Returns a list of files belonging to an \a archive.
 
-        CArchiveLink archiveLink;
-        if (archiveLink.Open2(op, nullptr) != S_OK) {
-            throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Cannot open archive \"%1\".").arg(archive->fileName()));
-        }
+   \sa ArchiveHandle::files()
+*/
+QVector<File> listArchive(QFileDevice *archive)
+{
+    LIB7Z_ASSERTS(archive, Readable)
 
-        QVector<File> flat;
-        for (unsigned i = 0; i < archiveLink.Arcs.Size(); ++i) {
-            IInArchive *const arch = archiveLink.Arcs[i].Archive;
-            UInt32 numItems = 0;
-            if (arch->GetNumberOfItems(&numItems) != S_OK) {
-                throw SevenZipException(QCoreApplication::translate("Lib7z",
-                    "Cannot retrieve number of items in archive."));
-            }
-            flat.reserve(flat.size() + numItems);
-            for (uint item = 0; item < numItems; ++item) {
-                UString s;
-                if (archiveLink.Arcs[i].GetItemPath(item, s) != S_OK) {
-                    throw SevenZipException(QCoreApplication::translate("Lib7z",
-                        "Cannot retrieve path of archive item \"%1\".").arg(item));
-                }
-                File f;
-                f.archiveIndex.setX(i);
-                f.archiveIndex.setY(item);
-                f.path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
-                Archive_IsItem_Folder(arch, item, f.isDirectory);
-                f.permissions = getPermissions(arch, item, nullptr);
-                getDateTimeProperty(arch, item, kpidMTime, &(f.utcTime));
-                f.uncompressedSize = getUInt64Property(arch, item, kpidSize, 0);
-                f.compressedSize = getUInt64Property(arch, item, kpidPackSize, 0);
-                flat.append(f);
-            }
-        }
-        return flat;
-    } catch (const char *err) {
-        archive->seek(initialPos);
-        throw SevenZipException(err);
+    const qint64 initialPos = archive->pos();
+    try {
+        return ArchiveHandle(archive).files();
     } catch (const SevenZipException &e) {
         archive->seek(initialPos);
         throw e; // re-throw unmodified
@@ -682,6 +1314,8 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
 
     Q_ASSERT(arc);
     currentIndex = index;
+    if (!sink)
+        sink = std::make_shared<ExtractSink>();
 
     UString s;
     if (arc->GetItemPath(index, s) != S_OK) {
@@ -692,12 +1326,14 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
 
     const QFileInfo fi(QString::fromLatin1("%1/%2").arg(targetDir, UString2QString(s)));
 
-    DirectoryGuard guard(fi.absolutePath());
+    // each directory is created, and reported, only once per archive
+    const QString parentDir = fi.absolutePath();
+    DirectoryGuard guard(sink->directories.contains(parentDir) ? QString() : parentDir);
     const QStringList directories = guard.tryCreate();
 
     bool isDir = false;
     Archive_IsItem_Folder(arc->Archive, index, isDir);
-    if (isDir)
+    if (isDir && !sink->directories.contains(fi.absoluteFilePath()))
         QDir(fi.absolutePath()).mkdir(fi.fileName());
 
     // this makes sure that all directories created get removed as well
@@ -709,6 +1345,25 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
 
     setCurrentFile(fi.absoluteFilePath());
 
+#ifndef Q_OS_WIN
+    if (!isDir && isSymlink(arc->Archive, index)) {
+        // the link target is the content of the item, the link is created once it is complete
+        if ((fi.isSymLink() || fi.exists()) && !QFile::remove(fi.absoluteFilePath())) {
+            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot remove already existing file %1.").arg(fi.absoluteFilePath()));
+            return E_FAIL;
+        }
+        const std::shared_ptr<QByteArray> target = std::make_shared<QByteArray>();
+        sink->symlinkTargets.insert(index, target);
+        CMyComPtr<ISequentialOutStream> stream = new SymlinkTargetOutStream(target);
+        *outStream = stream.Detach();
+
+        guard.release();
+        sink->directories.insert(parentDir);
+        return S_OK;
+    }
+#endif
+
     if (!isDir) {
 #ifndef Q_OS_WIN
         // do not follow symlinks, so we need to remove an existing one
@@ -718,19 +1373,39 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
             return E_FAIL;
         }
 #endif
-        std::unique_ptr<QFile> file(new QFile(fi.absoluteFilePath()));
-        if (!file->open(QIODevice::WriteOnly)) {
-            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                                                     "Cannot open file \"%1\" for writing: %2").arg(
-                             QDir::toNativeSeparators(fi.absoluteFilePath()), file->errorString()));
-            return E_FAIL;
+        // an item equal to a file extracted before is compared instead of written, if it can be
+        // created as a reflink of that file
+        DuplicateKey key;
+        const QString original = deduplicate && supportsReflinks(targetDir)
+            && getDuplicateKey(arc->Archive, index, &key)
+            ? DuplicateIndex::instance().find(key) : QString();
+        std::shared_ptr<DuplicateFile> duplicate;
+        if (!original.isEmpty() && original != fi.absoluteFilePath()
+                && supportsReflinks(targetDir, original)) {
+            duplicate = std::make_shared<DuplicateFile>(original, fi.absoluteFilePath(), key.size);
+            if (!duplicate->open())
+                duplicate.reset();
+        }
+
+        CMyComPtr<ISequentialOutStream> stream;
+        if (duplicate) {
+            sink->duplicates.insert(index, duplicate);
+            stream = new DuplicateFileOutStream(duplicate);
+        } else {
+            const std::shared_ptr<BufferedFile> bufferedFile = openExtractedFile(fi
+                .absoluteFilePath(), getUInt64Property(arc->Archive, index, kpidSize, 0));
+            if (!bufferedFile)
+                return E_FAIL;
+            sink->openFiles.insert(index, bufferedFile);
+            stream = new BufferedFileOutStream(bufferedFile);
         }
-        CMyComPtr<ISequentialOutStream> stream =
-            new QIODeviceSequentialOutStream(std::move(file));
         *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
     }
 
     guard.release();
+    sink->directories.insert(parentDir);
+    if (isDir)
+        sink->directories.insert(fi.absoluteFilePath());
     return S_OK;
 }
 
@@ -760,12 +1435,27 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
     const QString absFilePath = QFileInfo(QString::fromLatin1("%1/%2").arg(targetDir,
         UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/')))).absoluteFilePath();
 
+    // the file written for this item, if any, is still open
+    std::shared_ptr<BufferedFile> file = sink ? sink->openFiles.take(currentIndex)
+        : std::shared_ptr<BufferedFile>();
+
+    // an item that equals a file extracted before is created from that file
+    const std::shared_ptr<DuplicateFile> duplicate = sink ? sink->duplicates.take(currentIndex)
+        : std::shared_ptr<DuplicateFile>();
+    if (duplicate) {
+        if (duplicate->isDuplicate()) {
+            if (!duplicate->link())
+                return E_FAIL;
+        } else if (!(file = duplicate->file())) {
+            return E_FAIL;
+        }
+    }
+
     // do we have a symlink?
-    const quint32 attributes = getUInt32Property(arc->Archive, currentIndex, kpidAttrib, 0);
-    struct stat stat_info;
-    stat_info.st_mode = attributes >> 16;
-    if (S_ISLNK(stat_info.st_mode)) {
+    if (isSymlink(arc->Archive, currentIndex)) {
 #ifdef Q_OS_WIN
+        if (file)
+            file->close();
         qFatal(QString::fromLatin1("Creating a link from archive is not implemented for "
             "windows. Link filename: %1").arg(absFilePath).toLatin1());
         // TODO
@@ -774,24 +1464,15 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
         //    return S_FALSE;
         //}
 #else
-        QFileInfo symlinkPlaceHolderFileInfo(absFilePath);
-        if (symlinkPlaceHolderFileInfo.isSymLink()) {
+        // the link target was collected by GetStream()
+        const std::shared_ptr<QByteArray> symlinkTarget = sink
+            ? sink->symlinkTargets.take(currentIndex) : std::shared_ptr<QByteArray>();
+        if (!symlinkTarget) {
             setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                "Cannot create symlink at \"%1\". Another one is already existing.")
-                .arg(absFilePath));
+                "Cannot read symlink target for \"%1\".").arg(absFilePath));
             return E_FAIL;
         }
-        QFile symlinkPlaceHolderFile(absFilePath);
-        if (!symlinkPlaceHolderFile.open(QIODevice::ReadOnly)) {
-            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                "Cannot read symlink target from file \"%1\".").arg(absFilePath));
-            return E_FAIL;
-        }
-
-        const QByteArray symlinkTarget = symlinkPlaceHolderFile.readAll();
-        symlinkPlaceHolderFile.close();
-        symlinkPlaceHolderFile.remove();
-        QFile targetFile(QString::fromLatin1(symlinkTarget));
+        QFile targetFile(QFile::decodeName(*symlinkTarget));
         if (!targetFile.link(absFilePath)) {
             setLastError(QCoreApplication::translate("ExtractCallbackImpl",
                 "Cannot create symlink at %1: %2").arg(absFilePath,
@@ -802,38 +1483,80 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
 #endif
     }
 
-    try {   // Note: This part might also fail while running a elevated installation.
-        if (!absFilePath.isEmpty()) {
-            // This might fail for archives without all properties, we can only be sure
-            // about modification time, as it's always stored by default in 7z archives.
-            // Also note that we restore modification time on Unix only, as access time
-            // and change time are supposed to be set to the time of installation.
-            FILETIME mTime;
-            const UString fileName = QString2UString(absFilePath);
-            if (getFileTimeFromProperty(arc->Archive, currentIndex, kpidMTime, &mTime)) {
-                NWindows::NFile::NIO::COutFile file;
-                if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
-                    file.SetTime(&mTime, &mTime, &mTime);
-            }
+    // This might fail for archives without all properties, we can only be sure
+    // about modification time, as it's always stored by default in 7z archives.
+    // Also note that we restore modification time on Unix only, as access time
+    // and change time are supposed to be set to the time of installation.
+    FILETIME mTime;
+    const bool hasMTime = getFileTimeFromProperty(arc->Archive, currentIndex, kpidMTime, &mTime);
 #ifdef Q_OS_WIN
-            FILETIME cTime, aTime;
-            if (getFileTimeFromProperty(arc->Archive, currentIndex, kpidCTime, &cTime)
-                && getFileTimeFromProperty(arc->Archive, currentIndex, kpidATime, &aTime)) {
+    FILETIME cTime, aTime;
+    const bool hasCATime = getFileTimeFromProperty(arc->Archive, currentIndex, kpidCTime, &cTime)
+        && getFileTimeFromProperty(arc->Archive, currentIndex, kpidATime, &aTime);
+#endif
+    bool hasPerm = false;
+    const QFile::Permissions permissions = getPermissions(arc->Archive, currentIndex, &hasPerm);
+
+    const auto applyAttributes = [=]() {
+        try {   // Note: This part might also fail while running a elevated installation.
+            if (!absFilePath.isEmpty()) {
+                const UString fileName = QString2UString(absFilePath);
+                if (hasMTime) {
+                    NWindows::NFile::NIO::COutFile file;
+                    if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
+                        file.SetTime(&mTime, &mTime, &mTime);
+                }
+#ifdef Q_OS_WIN
+                if (hasCATime) {
                     NWindows::NFile::NIO::COutFile file;
                     if (file.Open(fileName, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
                         file.SetTime(&cTime, &aTime, &mTime);
-            }
+                }
 #endif
-        }
-    } catch (...) {}
+            }
+        } catch (...) {}
+
+        if (hasPerm)
+            QFile::setPermissions(absFilePath, permissions);
+    };
+
+    // written files can be used to deduplicate the items extracted later
+    DuplicateKey key;
+    if (file && deduplicate && supportsReflinks(targetDir)
+            && getDuplicateKey(arc->Archive, currentIndex, &key)) {
+        const auto finish = [=]() {
+            applyAttributes();
+            DuplicateIndex::instance().insert(key, absFilePath);
+        };
+        sink->closeLater(file, finish);
+        return S_OK;
+    }
 
-    bool hasPerm = false;
-    const QFile::Permissions permissions = getPermissions(arc->Archive, currentIndex, &hasPerm);
-    if (hasPerm)
-        QFile::setPermissions(absFilePath, permissions);
+    // the attributes can only be applied once the file is closed
+    if (file)
+        sink->closeLater(file, applyAttributes);
+    else
+        applyAttributes();
     return S_OK;
 }
 
+/*!
+    \internal
+
+    Waits for the extracted files that are still being written and closed in the background.
+*/
+HRESULT ExtractCallback::waitForFiles()
+{
+    if (!sink)
+        return S_OK;
+
+    const QString errorString = sink->waitForFiles();
+    if (errorString.isEmpty())
+        return S_OK;
+    setLastError(errorString);
+    return E_FAIL;
+}
+
 /*!
     \enum Lib7z::TmpFile
 
@@ -884,6 +1607,14 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
     Sets the target directory to \a dir.
 */
 
+/*!
+    \fn void Lib7z::ExtractCallback::setDeduplicateFiles(bool enable)
+
+    Sets whether files that equal a file extracted before by this process are created as reflinks
+    of that file to \a enable. This only takes effect if the file system of the target directory
+    supports reflinks, files are written as usual otherwise. Disabled by default.
+*/
+
 /*!
     \fn void Lib7z::ExtractCallback::setCurrentFile(const QString &filename)
 
@@ -1028,31 +1759,169 @@ static QString createTmp7z()
     return file.fileName();
 }
 
+/*!
+    Returns \c true if archives can be created and extracted with \a method; otherwise
+    returns \c false. Zstandard is available only if the framework is built with \c IFW_ZSTD.
+*/
+bool isSupportedMethod(Method method)
+{
+#ifdef IFW_ZSTD
+    Q_UNUSED(method)
+    return true;
+#else
+    return method != Method::Zstd;
+#endif
+}
+
+/*
+    Runs the 7z update engine to create \a archive from \a sources. If \a stream is given, the
+    archive is written to it and \a archive is only used to name the archive in messages.
+    Returns the file name the engine used for the archive.
+*/
+static QString updateArchive(const QString &archive, const QStringList &sources, Compression level,
+    Method method, UpdateCallback *callback, IOutStream *stream)
+{
+    if (!isSupportedMethod(method)) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Zstandard compression is not supported by this build."));
+    }
+
+    CArcCmdLineOptions options;
+    try {
+        UStringVector commandStrings;
+        commandStrings.Add(L"a"); // mode: add
+        commandStrings.Add(L"-t7z"); // type: 7z
+        commandStrings.Add(L"-mtm=on"); // time: modeifier|creation|access
+        commandStrings.Add(L"-mtc=on");
+        commandStrings.Add(L"-mta=on");
+        commandStrings.Add(L"-mmt=on"); // threads: multi-threaded
+#ifdef Q_OS_WIN
+        commandStrings.Add(L"-sccUTF-8"); // files: case-sensitive|UTF8
+#endif
+        commandStrings.Add(QString2UString(QString::fromLatin1("-mx=%1").arg(int(level)))); // compression: level
+        if (method == Method::Zstd)
+            commandStrings.Add(L"-m0=ZSTD"); // compression: method
+        commandStrings.Add(QString2UString(QDir::toNativeSeparators(archive)));
+        foreach (const QString &source, sources)
+            commandStrings.Add(QString2UString(source));
+
+        CArcCmdLineParser parser;
+        parser.Parse1(commandStrings, options);
+        parser.Parse2(options);
+    } catch (const CArcCmdLineException &e) {
+        throw SevenZipException(UString2QString(e));
+    }
+
+    CCodecs *const codecs = Lib7z::codecs();
+    CObjectVector<COpenType> types;
+    if (!ParseOpenTypes(*codecs, options.ArcType, types))
+        throw SevenZipException(QCoreApplication::translate("Lib7z", "Unsupported archive type."));
+
+    options.UpdateOptions.OutStream = stream;
+
+    CUpdateErrorInfo errorInfo;
+    CMyComPtr<UpdateCallback> comCallback = callback == 0 ? new UpdateCallback : callback;
+    const HRESULT res = UpdateArchive(codecs, types, options.ArchiveName, options.Censor,
+        options.UpdateOptions, errorInfo, nullptr, comCallback, true);
+
+    const QString archiveName = UString2QString(options.ArchiveName);
+    if (res != S_OK || (!stream && !QFileInfo::exists(archiveName))) {
+        QString errorMsg;
+        if (res == S_OK) {
+            errorMsg = QCoreApplication::translate("Lib7z", "Cannot create archive \"%1\"")
+                .arg(QDir::toNativeSeparators(archiveName));
+        } else {
+            errorMsg = QCoreApplication::translate("Lib7z", "Cannot create archive \"%1\": %2")
+                .arg(QDir::toNativeSeparators(archiveName), errorMessageFrom7zResult(res));
+        }
+        throw SevenZipException(errorMsg);
+    }
+    return archiveName;
+}
+
+/*
+    Adds the \a size bytes of \a archive starting at \a offset to \a hash. A write-only device
+    is read through a second handle to the same file.
+*/
+static void hashArchive(QFileDevice *archive, qint64 offset, qint64 size, QCryptographicHash *hash)
+{
+    QFile reopened;
+    QFileDevice *device = archive;
+    if (!archive->isReadable()) {
+        if (!archive->flush() || archive->fileName().isEmpty()) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot read back "
+                "archive to calculate its hash."));
+        }
+        reopened.setFileName(archive->fileName());
+        QInstaller::openForRead(&reopened);
+        device = &reopened;
+    }
+
+    const qint64 end = archive->pos();
+    if (!device->seek(offset)) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot read back "
+            "archive to calculate its hash: %1").arg(device->errorString()));
+    }
+    QByteArray buffer(scWriteBufferSize, Qt::Uninitialized);
+    while (size > 0) {
+        const qint64 read = device->read(buffer.data(), qMin<qint64>(size, buffer.size()));
+        if (read <= 0) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot read back "
+                "archive to calculate its hash: %1").arg(device->errorString()));
+        }
+        hash->addData(buffer.constData(), read);
+        size -= read;
+    }
+    if (device == archive)
+        archive->seek(end);
+}
+
 /*!
     Creates an archive using the given file device \a archive. \a sources can contain one or
     more files, one or more directories or a combination of files and folders. Also, \c * wildcard
     is supported. The value of \a level specifies the compression ratio, the default is set
     to \c 5 (Normal compression). The \a callback can be used to get information about the archive
-    creation process. If no \a callback is given, an empty implementation is used.
+    creation process. If no \a callback is given, an empty implementation is used. The data is
+    compressed with \a method.
+
+    The archive is written directly to \a archive, starting at its current position. If \a hash
+    is given, the bytes of the finished archive are added to it. The 7z format rewrites its start
+    header once all data is written, so the hash is taken by reading the archive back, which is
+    usually served from the file system cache. For a write-only device, the file is reopened by
+    name for reading.
 
     \note Throws SevenZipException on error.
     \note Filenames are stored case-sensitive with UTF-8 encoding.
     \note The ownership of \a callback is transferred to the function and gets delete on exit.
 */
 void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sources,
-    Compression level, UpdateCallback *callback)
+    Compression level, Method method, UpdateCallback *callback, QCryptographicHash *hash)
 {
     LIB7Z_ASSERTS(archive, Writable)
 
-    const QString tmpArchive = createTmp7z();
-    Lib7z::createArchive(tmpArchive, sources, TmpFile::No, level, callback);
-
     try {
-        QFile source(tmpArchive);
-        QInstaller::openForRead(&source);
-        QInstaller::blockingCopy(&source, archive, source.size());
-    } catch (const QInstaller::Error &error) {
-        throw SevenZipException(error.message());
+        QIODeviceOutStream *streamSpec = new QIODeviceOutStream(archive);
+        CMyComPtr<IOutStream> stream = streamSpec;
+        const QString name = archive->fileName().isEmpty() ? QLatin1String("archive.7z")
+            : archive->fileName();
+        updateArchive(name, sources, level, method, callback, stream);
+
+        // leave the device positioned behind the archive, as a plain copy would
+        if (!archive->seek(streamSpec->offset() + streamSpec->size())) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot create "
+                "archive \"%1\": %2").arg(QDir::toNativeSeparators(name), archive->errorString()));
+        }
+        if (hash)
+            hashArchive(archive, streamSpec->offset(), streamSpec->size(), hash);
+    } catch (const char *err) {
+        throw SevenZipException(err);
+    } catch (SevenZipException &e) {
+        throw e; // re-throw unmodified
+    } catch (const QInstaller::Error &err) {
+        throw SevenZipException(err.message());
+    } catch (...) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Unknown exception caught (%1)").arg(QString::fromLatin1(Q_FUNC_INFO)));
     }
 }
 
@@ -1062,7 +1931,8 @@ void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sou
     is supported. To be able to use the function during an elevated installation, set \a mode to
     \c TmpFile::Yes. The value of \a level specifies the compression ratio, the default is set
     to \c 5 (Normal compression). The \a callback can be used to get information about the archive
-    creation process. If no \a callback is given, an empty implementation is used.
+    creation process. If no \a callback is given, an empty implementation is used. The data is
+    compressed with \a method.
 
     \note Throws SevenZipException on error.
     \note If \a archive exists, it will be overwritten.
@@ -1070,62 +1940,14 @@ void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sou
     \note The ownership of \a callback is transferred to the function and gets delete on exit.
 */
 void createArchive(const QString &archive, const QStringList &sources, TmpFile mode,
-    Compression level, UpdateCallback *callback)
+    Compression level, Method method, UpdateCallback *callback)
 {
     try {
         QString target = archive;
         if (mode == TmpFile::Yes)
             target = createTmp7z();
 
-        CArcCmdLineOptions options;
-        try {
-            UStringVector commandStrings;
-            commandStrings.Add(L"a"); // mode: add
-            commandStrings.Add(L"-t7z"); // type: 7z
-            commandStrings.Add(L"-mtm=on"); // time: modeifier|creation|access
-            commandStrings.Add(L"-mtc=on");
-            commandStrings.Add(L"-mta=on");
-            commandStrings.Add(L"-mmt=on"); // threads: multi-threaded
-#ifdef Q_OS_WIN
-            commandStrings.Add(L"-sccUTF-8"); // files: case-sensitive|UTF8
-#endif
-            commandStrings.Add(QString2UString(QString::fromLatin1("-mx=%1").arg(int(level)))); // compression: level
-            commandStrings.Add(QString2UString(QDir::toNativeSeparators(target)));
-            foreach (const QString &source, sources)
-                commandStrings.Add(QString2UString(source));
-
-            CArcCmdLineParser parser;
-            parser.Parse1(commandStrings, options);
-            parser.Parse2(options);
-        } catch (const CArcCmdLineException &e) {
-            throw SevenZipException(UString2QString(e));
-        }
-
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        CObjectVector<COpenType> types;
-        if (!ParseOpenTypes(codecs, options.ArcType, types))
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Unsupported archive type."));
-
-        CUpdateErrorInfo errorInfo;
-        CMyComPtr<UpdateCallback> comCallback = callback == 0 ? new UpdateCallback : callback;
-        const HRESULT res = UpdateArchive(&codecs, types, options.ArchiveName, options.Censor,
-            options.UpdateOptions, errorInfo, nullptr, comCallback, true);
-
-        const QFile tempFile(UString2QString(options.ArchiveName));
-        if (res != S_OK || !tempFile.exists()) {
-            QString errorMsg;
-            if (res == S_OK) {
-                errorMsg = QCoreApplication::translate("Lib7z", "Cannot create archive \"%1\"")
-                    .arg(QDir::toNativeSeparators(tempFile.fileName()));
-            } else {
-                errorMsg = QCoreApplication::translate("Lib7z", "Cannot create archive \"%1\": %2")
-                    .arg(QDir::toNativeSeparators(tempFile.fileName()), errorMessageFrom7zResult(res));
-            }
-            throw SevenZipException(errorMsg);
-        }
+        target = updateArchive(target, sources, level, method, callback, nullptr);
 
         if (mode == TmpFile::Yes) {
             QFile org(archive);
@@ -1135,7 +1957,7 @@ void createArchive(const QString &archive, const QStringList &sources, TmpFile m
                                                 org.errorString()));
             }
 
-            QFile arc(UString2QString(options.ArchiveName));
+            QFile arc(target);
             if(!arc.rename(archive)) {
                 throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot rename "
                     "temporary archive \"%1\" to \"%2\": %3").arg(
@@ -1156,17 +1978,320 @@ void createArchive(const QString &archive, const QStringList &sources, TmpFile m
     }
 }
 
+/*
+    State shared by the threads that decode the folders of one 7z archive.
+*/
+struct FolderExtraction
+{
+    ExtractCallback *callback = nullptr;
+    QMutex mutex;
+    QVector<UInt64> completed;  // one entry per thread
+    std::atomic<bool> failed { false };
+};
+
+/*
+    Passes the calls of one decoding thread on to the ExtractCallback of the caller. The calls
+    are serialized, so the callback does not need to be thread-safe. Only decoding and writing
+    the file contents run in parallel.
+*/
+class FolderExtractCallback : public IArchiveExtractCallback, public CMyUnknownImp
+{
+    Q_DISABLE_COPY(FolderExtractCallback)
+
+public:
+    MY_UNKNOWN_IMP
+
+    FolderExtractCallback(FolderExtraction *extraction, int slot, CArc *arc)
+        : m_extraction(extraction)
+        , m_slot(slot)
+        , m_arc(arc)
+    {}
+
+    STDMETHOD(SetTotal)(UInt64 /*total*/)
+    {
+        return S_OK;    // the total of all threads has been set up front
+    }
+
+    STDMETHOD(SetCompleted)(const UInt64 *completed)
+    {
+        if (m_extraction->failed)
+            return E_ABORT;
+        if (!completed)
+            return S_OK;
+
+        QMutexLocker _(&m_extraction->mutex);
+        m_extraction->completed[m_slot] = *completed;
+        const UInt64 sum = std::accumulate(m_extraction->completed.constBegin(),
+            m_extraction->completed.constEnd(), UInt64(0));
+        return m_extraction->callback->SetCompleted(&sum);
+    }
+
+    STDMETHOD(GetStream)(UInt32 index, ISequentialOutStream **outStream, Int32 askExtractMode)
+    {
+        *outStream = nullptr;
+        if (m_extraction->failed)
+            return E_ABORT;
+
+        QMutexLocker _(&m_extraction->mutex);
+        m_index = index;
+        m_extraction->callback->arc = m_arc;
+        return m_extraction->callback->GetStream(index, outStream, askExtractMode);
+    }
+
+    STDMETHOD(PrepareOperation)(Int32 askExtractMode)
+    {
+        QMutexLocker _(&m_extraction->mutex);
+        return m_extraction->callback->PrepareOperation(askExtractMode);
+    }
+
+    STDMETHOD(SetOperationResult)(Int32 resultEOperationResult)
+    {
+        QMutexLocker _(&m_extraction->mutex);
+        m_extraction->callback->arc = m_arc;
+        m_extraction->callback->currentIndex = m_index;
+        return m_extraction->callback->SetOperationResult(resultEOperationResult);
+    }
+
+private:
+    FolderExtraction *m_extraction;
+    int m_slot;
+    CArc *m_arc;
+    UInt32 m_index = 0;
+};
+
+/*
+    Extracts the items \a indices, sorted in ascending order, of the archive \a fileName. The
+    archive is opened again, so that each thread has its own decoder. Returns an error message
+    on failure.
+*/
+static QString extractFolders(const QString &fileName, const QVector<UInt32> &indices,
+    FolderExtraction *extraction, int slot)
+{
+    try {
+        QFile archive(fileName);
+        if (!archive.open(QIODevice::ReadOnly)) {
+            return QCoreApplication::translate("Lib7z", "Cannot open archive \"%1\" for "
+                "reading: %2").arg(fileName, archive.errorString());
+        }
+
+        CArchiveLink archiveLink;
+        if (openArchiveLink(&archive, &archiveLink) != S_OK)
+            return QCoreApplication::translate("Lib7z", "Cannot open archive \"%1\".").arg(fileName);
+
+        CMyComPtr<FolderExtractCallback> callback = new FolderExtractCallback(extraction, slot,
+            &archiveLink.Arcs[0]);
+        setLastError(QString());    // the pool thread may have run another extraction before
+        const LONG result = archiveLink.Arcs[0].Archive->Extract(indices.constData(),
+            static_cast<UInt32>(indices.size()), false, callback);
+        if (result != S_OK)
+            return errorMessageFrom7zResult(result);
+        return QString();
+    } catch (const SevenZipException &e) {
+        return e.message();
+    } catch (...) {
+        return QCoreApplication::translate("Lib7z", "Unknown exception caught (%1).")
+            .arg(QString::fromLatin1(Q_FUNC_INFO));
+    }
+}
+
+/*
+    Extracts the 7z archive \a arc, opened from \a archive, by decoding its folders on up to
+    \a threads threads. Returns \c false without extracting anything if the archive has less
+    than two folders.
+
+    \note Throws SevenZipException on error.
+*/
+static bool extractFoldersConcurrently(QFileDevice *archive, CArc *arc, ExtractCallback *callback,
+    int threads)
+{
+    IInArchive *const arch = arc->Archive;
+    UInt32 numItems = 0;
+    if (arch->GetNumberOfItems(&numItems) != S_OK) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Cannot retrieve number of items in archive."));
+    }
+
+    // items that are not stored in a folder, like directories, are extracted last
+    QMap<UInt32, QVector<UInt32>> folders;
+    QMap<UInt32, UInt64> folderSizes;
+    QVector<UInt32> otherItems;
+    UInt64 total = 0;
+    for (UInt32 item = 0; item < numItems; ++item) {
+        const UInt64 size = getUInt64Property(arch, item, kpidSize, 0);
+        total += size;
+        const NCOM::CPropVariant block = readProperty(arch, item, kpidBlock);
+        if (block.vt == VT_UI4) {
+            folders[block.ulVal].append(item);
+            folderSizes[block.ulVal] += size;
+        } else {
+            otherItems.append(item);
+        }
+    }
+    if (folders.count() < 2)
+        return false;
+
+    // hand out the largest folders first, each to the thread with the least work so far
+    threads = qMin(threads, folders.count());
+    QList<UInt32> order = folders.keys();
+    std::stable_sort(order.begin(), order.end(), [&folderSizes](UInt32 lhs, UInt32 rhs) {
+        return folderSizes.value(lhs) > folderSizes.value(rhs);
+    });
+    QVector<QVector<UInt32>> groups(threads);
+    QVector<UInt64> groupSizes(threads, 0);
+    foreach (const UInt32 folder, order) {
+        const int group = int(std::min_element(groupSizes.constBegin(), groupSizes.constEnd())
+            - groupSizes.constBegin());
+        groups[group] += folders.value(folder);
+        groupSizes[group] += folderSizes.value(folder);
+    }
+
+    FolderExtraction extraction;
+    extraction.callback = callback;
+    extraction.completed.fill(0, threads + 1);
+    callback->SetTotal(total);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    QVector<QFuture<QString>> futures;
+    for (int i = 0; i < threads; ++i) {
+        std::sort(groups[i].begin(), groups[i].end());
+        const QVector<UInt32> indices = groups.at(i);
+        const QString fileName = archive->fileName();
+        futures.append(QtConcurrent::run(&pool, [fileName, indices, &extraction, i]() {
+            const QString error = extractFolders(fileName, indices, &extraction, i);
+            if (!error.isEmpty())
+                extraction.failed = true;
+            return error;
+        }));
+    }
+
+    QString error;
+    foreach (const QFuture<QString> &future, futures) {
+        if (error.isEmpty())
+            error = future.result();
+        else
+            future.waitForFinished();
+    }
+    if (!error.isEmpty())
+        throw SevenZipException(error);
+
+    if (!otherItems.isEmpty()) {
+        CMyComPtr<FolderExtractCallback> otherCallback = new FolderExtractCallback(&extraction,
+            threads, arc);
+        const LONG result = arch->Extract(otherItems.constData(),
+            static_cast<UInt32>(otherItems.size()), false, otherCallback);
+        if (result != S_OK)
+            throw SevenZipException(errorMessageFrom7zResult(result));
+    }
+    return true;
+}
+
 /*!
-    Extracts the given \a archive content into target directory \a directory using the provided
-    extract callback \a callback. The output filenames are deduced from the \a archive content.
+    \inmodule Lib7z
+    \class Lib7z::ArchiveHandle
+    \brief Provides access to an opened archive.
+
+    The archive headers are parsed once, when the handle is created. The handle can then be
+    used to list and to extract the archive without opening it again. The archive device needs
+    to stay open as long as the handle exists.
+*/
+
+class ArchiveHandle::Private
+{
+public:
+    QFileDevice *archive = nullptr;
+    CArchiveLink archiveLink;
+};
+
+/*!
+    Opens \a archive and parses its headers.
 
     \note Throws SevenZipException on error.
-    \note The ownership of \a callback is not transferred to the function.
 */
-void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallback *callback)
+ArchiveHandle::ArchiveHandle(QFileDevice *archive)
+    : d(new Private)
 {
     LIB7Z_ASSERTS(archive, Readable)
 
+    d->archive = archive;
+    HRESULT result = E_FAIL;
+    try {
+        result = openArchiveLink(archive, &d->archiveLink);
+    } catch (const char *err) {
+        throw SevenZipException(err);
+    }
+    if (result != S_OK) {
+        throw SevenZipException(QCoreApplication::translate("Lib7z",
+            "Cannot open archive \"%1\".").arg(archive->fileName()));
+    }
+}
+
+/*!
+    Closes the archive. The archive device is not closed.
+*/
+ArchiveHandle::~ArchiveHandle()
+{
+    delete d;
+}
+
+/*!
+    Returns the files and directories contained in the archive.
+
+    \note Throws SevenZipException on error.
+*/
+QVector<File> ArchiveHandle::files() const
+{
+    try {
+        QVector<File> flat;
+        for (unsigned i = 0; i < d->archiveLink.Arcs.Size(); ++i) {
+            IInArchive *const arch = d->archiveLink.Arcs[i].Archive;
+            UInt32 numItems = 0;
+            if (arch->GetNumberOfItems(&numItems) != S_OK) {
+                throw SevenZipException(QCoreApplication::translate("Lib7z",
+                    "Cannot retrieve number of items in archive."));
+            }
+            flat.reserve(flat.size() + numItems);
+            for (uint item = 0; item < numItems; ++item) {
+                UString s;
+                if (d->archiveLink.Arcs[i].GetItemPath(item, s) != S_OK) {
+                    throw SevenZipException(QCoreApplication::translate("Lib7z",
+                        "Cannot retrieve path of archive item \"%1\".").arg(item));
+                }
+                File f;
+                f.archiveIndex.setX(i);
+                f.archiveIndex.setY(item);
+                f.path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
+                Archive_IsItem_Folder(arch, item, f.isDirectory);
+                f.permissions = getPermissions(arch, item, nullptr);
+                getDateTimeProperty(arch, item, kpidMTime, &(f.utcTime));
+                f.uncompressedSize = getUInt64Property(arch, item, kpidSize, 0);
+                f.compressedSize = getUInt64Property(arch, item, kpidPackSize, 0);
+                flat.append(f);
+            }
+        }
+        return flat;
+    } catch (const char *err) {
+        throw SevenZipException(err);
+    }
+}
+
+/*!
+    Extracts the archive content into target directory \a directory using the provided
+    extract callback \a callback. The output filenames are deduced from the archive content.
+
+    The folders of a 7z archive are independent of each other. If \a threads is not \c 1, they
+    are decoded in parallel on up to \a threads threads, or one per processor core if \a threads
+    is \c 0. Each thread opens the archive again, so this requires the archive to be a file that
+    can be opened by its file name. The calls to \a callback are serialized.
+
+    \note Throws SevenZipException on error.
+    \note The ownership of \a callback is not transferred to the function.
+*/
+void ArchiveHandle::extract(const QString &directory, ExtractCallback *callback, int threads)
+{
+    QFileDevice *const archive = d->archive;
+    CArchiveLink &archiveLink = d->archiveLink;
+
     // Guard a given object against unwanted delete.
     CMyComPtr<ExtractCallback> externCallback = callback;
 
@@ -1176,37 +2301,19 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
         localCallback = callback;
     }
 
+    setLastError(QString());
     DirectoryGuard outDir(QFileInfo(directory).absolutePath());
     try {
         outDir.tryCreate();
 
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
-
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
-
-        CArchiveLink archiveLink;
-        if (archiveLink.Open2(op, nullptr) != S_OK) {
-            throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Cannot open archive \"%1\".").arg(archive->fileName()));
-        }
-
         callback->setTarget(directory);
-        for (unsigned a = 0; a < archiveLink.Arcs.Size(); ++a) {
+        if (threads <= 0)
+            threads = qMax(1, QThread::idealThreadCount());
+        const bool concurrent = threads > 1 && archiveLink.Arcs.Size() == 1
+            && !archive->fileName().isEmpty()
+            && extractFoldersConcurrently(archive, &archiveLink.Arcs[0], callback, threads);
+
+        for (unsigned a = 0; !concurrent && a < archiveLink.Arcs.Size(); ++a) {
             callback->setArchive(&archiveLink.Arcs[a]);
             IInArchive *const arch = archiveLink.Arcs[a].Archive;
 
@@ -1214,10 +2321,14 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
             if (result != S_OK)
                 throw SevenZipException(errorMessageFrom7zResult(result));
         }
+        if (callback->waitForFiles() != S_OK)
+            throw SevenZipException(lastError());
     } catch (const SevenZipException &e) {
+        callback->waitForFiles();
         externCallback.Detach();
         throw e; // re-throw unmodified
     } catch (...) {
+        callback->waitForFiles();
         externCallback.Detach();
         throw SevenZipException(QCoreApplication::translate("Lib7z",
             "Unknown exception caught (%1).").arg(QString::fromLatin1(Q_FUNC_INFO)));
@@ -1226,6 +2337,20 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
     externCallback.Detach();
 }
 
+/*!
+    Extracts the given \a archive content into target directory \a directory using the provided
+    extract callback \a callback, decoding on up to \a threads threads.
+
+    \note Throws SevenZipException on error.
+    \note The ownership of \a callback is not transferred to the function.
+    \sa ArchiveHandle::extract()
+*/
+void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallback *callback,
+    int threads)
+{
+    ArchiveHandle(archive).extract(directory, callback, threads);
+}
+
 /*!
     Returns \c true if the given \a archive is supported; otherwise returns \c false.
 
@@ -1237,27 +2362,8 @@ bool isSupportedArchive(QFileDevice *archive)
 
     const qint64 initialPos = archive->pos();
     try {
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
-
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
-
         CArchiveLink archiveLink;
-        const HRESULT result = archiveLink.Open2(op, nullptr);
+        const HRESULT result = openArchiveLink(archive, &archiveLink);
 
         archive->seek(initialPos);
         return result == S_OK;
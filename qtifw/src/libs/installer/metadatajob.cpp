@@ -28,6 +28,8 @@
 #include "metadatajob.h"
 
 #include "metadatajob_p.h"
+#include "errors.h"
+#include "mirrorselector.h"
 #include "packagemanagercore.h"
 #include "packagemanagerproxyfactory.h"
 #include "productkeycheck.h"
@@ -37,12 +39,17 @@
 #include "testrepository.h"
 #include "globals.h"
 
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QSettings>
 #include <QTemporaryDir>
-#include <QtMath>
-#include <QRandomGenerator>
 
 const QStringList metaElements = {QLatin1String("Script"), QLatin1String("Licenses"), QLatin1String("UserInterfaces"), QLatin1String("Translations")};
 
+// Cached meta directories not used for this many days are removed.
+static const int scMetaCacheMaxAge = 30;
+
 namespace QInstaller {
 
 /*!
@@ -95,16 +102,8 @@ MetadataJob::MetadataJob(QObject *parent)
     : Job(parent)
     , m_core(nullptr)
     , m_downloadType(DownloadType::All)
-    , m_downloadableChunkSize(1000)
-    , m_taskNumber(0)
-{
-    QByteArray downloadableChunkSize = qgetenv("IFW_METADATA_SIZE");
-    if (!downloadableChunkSize.isEmpty()) {
-        int chunkSize = QString::fromLocal8Bit(downloadableChunkSize).toInt();
-        if (chunkSize > 0)
-            m_downloadableChunkSize = chunkSize;
-    }
-
+    , m_mirrorSelector(nullptr)
+{
     setCapabilities(Cancelable);
     connect(&m_xmlTask, &QFutureWatcherBase::finished, this, &MetadataJob::xmlTaskFinished);
     connect(&m_metadataTask, &QFutureWatcherBase::finished, this, &MetadataJob::metadataTaskFinished);
@@ -145,6 +144,20 @@ Repository MetadataJob::repositoryForDirectory(const QString &directory) const
         return m_metaFromArchive.value(directory).repository;
 }
 
+/*!
+    Sets the directory used to keep fetched repository metadata between runs to \a directory.
+    Updates.xml files are stored together with their HTTP validators, so that later fetches
+    can be made conditional. Extracted meta archives are stored keyed by their SHA1 checksum
+    and reused instead of downloading and extracting them again. An empty \a directory
+    disables the cache.
+*/
+void MetadataJob::setCacheDirectory(const QString &directory)
+{
+    m_cacheDirectory = directory;
+    if (!m_cacheDirectory.isEmpty())
+        pruneMetaCache();
+}
+
 // -- private slots
 
 void MetadataJob::doStart()
@@ -162,6 +175,9 @@ void MetadataJob::doStart()
         if (onlineInstaller || m_core->isMaintainer()) {
             QList<FileTaskItem> items;
             QSet<Repository> repositories = getRepositories();
+            if (probeMirrors(repositories))
+                return; // continues in mirrorProbeFinished()
+
             foreach (const Repository &repo, repositories) {
                 if (repo.isEnabled() &&
                         productKeyCheck->isValidRepository(repo)) {
@@ -170,14 +186,29 @@ void MetadataJob::doStart()
                     authenticator.setPassword(repo.password());
 
                     if (!repo.isCompressed()) {
-                        QString url = repo.url().toString() + QLatin1String("/Updates.xml?");
+                        QString url = repositoryUrl(repo) + QLatin1String("/Updates.xml");
                         if (!m_core->value(scUrlQueryString).isEmpty())
-                            url += m_core->value(scUrlQueryString) + QLatin1Char('&');
+                            url += QLatin1Char('?') + m_core->value(scUrlQueryString);
+
+                        // Make proxies revalidate instead of appending a random string to the
+                        // URL, and ask the server to skip the body if our cached copy is current.
+                        QVariantMap headers;
+                        headers.insert(QLatin1String("Cache-Control"), QLatin1String("no-cache"));
+                        const QString cacheDir = repositoryCacheDirectory(url);
+                        if (!cacheDir.isEmpty() && QFileInfo::exists(cacheDir + QLatin1String("/Updates.xml"))) {
+                            const QSettings state(cacheDir + QLatin1String("/state.ini"), QSettings::IniFormat);
+                            const QString eTag = state.value(QLatin1String("ETag")).toString();
+                            const QString lastModified = state.value(QLatin1String("LastModified")).toString();
+                            if (!eTag.isEmpty())
+                                headers.insert(QLatin1String("If-None-Match"), eTag);
+                            if (!lastModified.isEmpty())
+                                headers.insert(QLatin1String("If-Modified-Since"), lastModified);
+                        }
 
-                        // also append a random string to avoid proxy caches
-                        FileTaskItem item(url.append(QString::number(QRandomGenerator::global()->generate())));
+                        FileTaskItem item(url);
                         item.insert(TaskRole::UserRole, QVariant::fromValue(repo));
                         item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+                        item.insert(TaskRole::RequestHeaders, headers);
                         items.append(item);
 
                         // NEXTGIS: Add release message fetch
@@ -246,6 +277,12 @@ void MetadataJob::startXMLTask(const QList<FileTaskItem> &items)
     m_xmlTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, xmlTask));
 }
 
+void MetadataJob::mirrorProbeFinished()
+{
+    disconnect(m_mirrorSelector, &MirrorSelector::finished, this, &MetadataJob::mirrorProbeFinished);
+    doStart();
+}
+
 void MetadataJob::doCancel()
 {
     reset();
@@ -441,8 +478,14 @@ void MetadataJob::unzipTaskFinished()
     QFutureWatcher<void> *watcher = static_cast<QFutureWatcher<void> *>(sender());
     try {
         watcher->waitForFinished();    // trigger possible exceptions
+
+        UnzipArchiveTask *task = qobject_cast<UnzipArchiveTask *>(m_unzipTasks.value(watcher));
+        if (task && m_metaCacheEntries.contains(task->target()))
+            storeCachedMeta(task->target());
     } catch (const UnzipArchiveException &e) {
         emitFinishedWithError(QInstaller::ExtractionError, e.message());
+    } catch (const QInstaller::Error &e) {
+        emitFinishedWithError(QInstaller::ExtractionError, e.message());
     } catch (const QUnhandledException &e) {
         emitFinishedWithError(QInstaller::DownloadError, QLatin1String(e.what()));
     } catch (...) {
@@ -492,8 +535,20 @@ void MetadataJob::metadataTaskFinished()
                             throw QInstaller::TaskException(mismatchMessage);
                         }
                     }
-                    UnzipArchiveTask *task = new UnzipArchiveTask(result.target(),
-                        item.value(TaskRole::UserRole).toString());
+                    // Extract into the meta cache first if possible, the contents are copied to
+                    // the metadata directory once the extraction is done.
+                    QString target = item.value(TaskRole::UserRole).toString();
+                    const QString sha1 = QString::fromLatin1(item.value(TaskRole::Checksum).toByteArray());
+                    if (!result.checksumMismatch() && !sha1.isEmpty() && !metaCacheDirectory(sha1).isEmpty()
+                            && !m_core->isOfflineGenerator()) {
+                        QTemporaryDir extractDir(metaCacheDirectory(sha1) + QLatin1String(".tmp-XXXXXX"));
+                        if (extractDir.isValid()) {
+                            extractDir.setAutoRemove(false);
+                            m_metaCacheEntries.insert(extractDir.path(), qMakePair(sha1, target));
+                            target = extractDir.path();
+                        }
+                    }
+                    UnzipArchiveTask *task = new UnzipArchiveTask(result.target(), target);
 
                     QFutureWatcher<void> *watcher = new QFutureWatcher<void>();
                     m_unzipTasks.insert(watcher, qobject_cast<QObject*> (task));
@@ -521,30 +576,26 @@ void MetadataJob::metadataTaskFinished()
 
 bool MetadataJob::fetchMetaDataPackages()
 {
-    //Download files in chunks. QtConcurrent will choke if too many task is given to it
-    int chunkSize = qMin(m_packages.length(), m_downloadableChunkSize);
-    QList<FileTaskItem> tempPackages = m_packages.mid(0, chunkSize);
-    m_packages = m_packages.mid(chunkSize, m_packages.length());
-    if (tempPackages.length() > 0) {
-        m_taskNumber++;
-        setProcessedAmount(0);
-        DownloadFileTask *const metadataTask = new DownloadFileTask(tempPackages);
-        metadataTask->setProxyFactory(m_core->proxyFactory());
-        m_metadataTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, metadataTask));
-        setProgressTotalAmount(100);
-        QString metaInformation;
-        if (m_totalTaskCount > 1)
-            metaInformation = tr("Retrieving meta information from remote repository... %1/%2 ").arg(m_taskNumber).arg(m_totalTaskCount);
-        else
-            metaInformation = tr("Retrieving meta information from remote repository... ");
-        emit infoMessage(this, metaInformation);
-        return true;
-    }
-    return false;
+    // All packages go into one task, the downloader limits the number of requests in flight.
+    if (m_packages.isEmpty())
+        return false;
+
+    setProcessedAmount(0);
+    DownloadFileTask *const metadataTask = new DownloadFileTask(m_packages);
+    metadataTask->setProxyFactory(m_core->proxyFactory());
+    m_packages.clear();
+    m_metadataTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, metadataTask));
+    setProgressTotalAmount(100);
+    emit infoMessage(this, tr("Retrieving meta information from remote repository... "));
+    return true;
 }
 
 void MetadataJob::reset()
 {
+    if (m_mirrorSelector && m_mirrorSelector->isProbing()) {
+        disconnect(m_mirrorSelector, &MirrorSelector::finished, this, &MetadataJob::mirrorProbeFinished);
+        m_mirrorSelector->cancel();
+    }
     m_packages.clear();
     m_metaFromDefaultRepositories.clear();
     m_metaFromArchive.clear();
@@ -560,7 +611,10 @@ void MetadataJob::reset()
     } catch (...) {}
     m_tempDirDeleter.releaseAndDeleteAll();
     m_metadataResult.clear();
-    m_taskNumber = 0;
+
+    foreach (const QString &extractDir, m_metaCacheEntries.keys())
+        QInstaller::removeDirectory(extractDir, true);
+    m_metaCacheEntries.clear();
 }
 
 void MetadataJob::resetCompressedFetch()
@@ -594,9 +648,20 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         if (error() != Job::NoError)
             return XmlDownloadFailure;
 
+        // On 304 Not Modified nothing was downloaded, use the cached Updates.xml instead.
+        QString source = result.target();
+        if (result.notModified()) {
+            const Repository repository = result.taskItem().value(TaskRole::UserRole).value<Repository>();
+            const QString cacheDir = repositoryCacheDirectory(result.taskItem().source());
+            if (!cacheDir.isEmpty())
+                source = cacheDir + QLatin1String("/Updates.xml");
+            qCDebug(QInstaller::lcInstallerInstallLog) << "Updates.xml of repository"
+                << repository.displayname() << "not modified, using cached copy.";
+        }
+
         //If repository is not found, target might be empty. Do not continue parsing the
         //repository and do not prevent further repositories usage.
-        if (result.target().isEmpty()) {
+        if (source.isEmpty()) {
             continue;
         }
         Metadata metadata;
@@ -610,8 +675,16 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         metadata.directory = tmp.path();
         m_tempDirDeleter.add(metadata.directory);
 
-        QFile file(result.target());
-        if (!file.rename(metadata.directory + QLatin1String("/Updates.xml"))) {
+        QFile file(source);
+        const QString updatesXml = metadata.directory + QLatin1String("/Updates.xml");
+        if (result.notModified()) {
+            if (!file.copy(updatesXml)) {
+                qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot copy cached Updates.xml:"
+                    << file.errorString();
+                return XmlDownloadFailure;
+            }
+            file.setFileName(updatesXml);
+        } else if (!file.rename(updatesXml)) {
             qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot rename target to Updates.xml:"
                 << file.errorString();
             return XmlDownloadFailure;
@@ -654,6 +727,9 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         }
         // End NextGIS
 
+        if (!result.notModified())
+            storeUpdatesXml(result, updatesXml);
+
         const QDomNode checksum = root.firstChildElement(QLatin1String("Checksum"));
         if (!checksum.isNull())
             testCheckSum = (checksum.toElement().text().toLower() == scTrue);
@@ -665,7 +741,7 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         QDomElement metadataNameElement = root.firstChildElement(QLatin1String("MetadataName"));
         QDomNodeList children = root.childNodes();
         if (!sha1.isNull() && !metadataNameElement.isNull()) {
-           const QString repoUrl = metadata.repository.url().toString();
+           const QString repoUrl = repositoryUrl(metadata.repository);
            const QString metadataName = metadataNameElement.toElement().text();
            addFileTaskItem(QString::fromLatin1("%1/%2").arg(repoUrl, metadataName),
                metadata.directory + QString::fromLatin1("/%1").arg(metadataName),
@@ -685,7 +761,7 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
                     // checksum element for the meta-archive, we will fetch it, so that the temporary
                     // location contents match the remote repository.
                     if (metaFound || (m_core->isOfflineGenerator() && !packageHash.isEmpty())) {
-                        const QString repoUrl = metadata.repository.url().toString();
+                        const QString repoUrl = repositoryUrl(metadata.repository);
                         addFileTaskItem(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName, packageVersion),
                             metadata.directory + QString::fromLatin1("/%1-%2-meta.7z").arg(packageName, packageVersion),
                             metadata, packageHash, packageName);
@@ -736,10 +812,6 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
             }
         }
     }
-    double taskCount = m_packages.length()/static_cast<double>(m_downloadableChunkSize);
-    m_totalTaskCount = qCeil(taskCount);
-    m_taskNumber = 0;
-
     return XmlDownloadSuccess;
 }
 
@@ -777,6 +849,10 @@ QSet<Repository> MetadataJob::getRepositories()
 void MetadataJob::addFileTaskItem(const QString &source, const QString &target, const Metadata &metadata,
                                   const QString &sha1, const QString &packageName)
 {
+    // The offline generator needs the meta archives themselves, not their contents.
+    if (!m_core->isOfflineGenerator() && restoreCachedMeta(sha1, metadata.directory))
+        return;
+
     FileTaskItem item(source, target);
     QAuthenticator authenticator;
     authenticator.setUser(metadata.repository.username());
@@ -906,4 +982,157 @@ MetadataJob::Status MetadataJob::setAdditionalRepositories(QHash<QString, QPair<
     }
     return status;
 }
+
+/*!
+    \internal
+
+    Starts probing the mirrors of those \a repositories that declare mirrors and were not
+    probed before. Returns \c true if probing was started.
+*/
+bool MetadataJob::probeMirrors(const QSet<Repository> &repositories)
+{
+    if (!m_mirrorSelector)
+        return false;
+
+    QList<Repository> unprobed;
+    foreach (const Repository &repository, repositories) {
+        if (repository.isEnabled() && !repository.isCompressed() && !repository.mirrors().isEmpty()
+                && !m_mirrorSelector->isProbed(repository.url())) {
+            unprobed.append(repository);
+        }
+    }
+    if (unprobed.isEmpty())
+        return false;
+
+    emit infoMessage(this, tr("Checking repository mirrors..."));
+    connect(m_mirrorSelector, &MirrorSelector::finished, this, &MetadataJob::mirrorProbeFinished);
+    m_mirrorSelector->probe(unprobed, m_core->proxyFactory());
+    return true;
+}
+
+/*!
+    \internal
+
+    Returns the URL to fetch the metadata of \a repository from, which is the fastest of its
+    mirrors if it declares any.
+*/
+QString MetadataJob::repositoryUrl(const Repository &repository) const
+{
+    if (!m_mirrorSelector)
+        return repository.url().toString();
+    return m_mirrorSelector->preferredUrl(repository.url()).toString();
+}
+
+/*!
+    \internal
+
+    Returns the directory to cache the Updates.xml fetched from \a url in. The validators
+    stored with it are only valid for the server that returned them, so the directory is
+    keyed by the URL actually fetched, which is a mirror of the repository if one was chosen.
+*/
+QString MetadataJob::repositoryCacheDirectory(const QString &url) const
+{
+    if (m_cacheDirectory.isEmpty())
+        return QString();
+    const QByteArray hash = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1);
+    return m_cacheDirectory + QLatin1String("/repositories/") + QString::fromLatin1(hash.toHex());
+}
+
+QString MetadataJob::metaCacheDirectory(const QString &sha1) const
+{
+    static const QRegularExpression validSha1(QLatin1String("^[0-9a-f]{40}$"));
+    if (m_cacheDirectory.isEmpty() || !validSha1.match(sha1.toLower()).hasMatch())
+        return QString();
+    return m_cacheDirectory + QLatin1String("/meta/") + sha1.toLower();
+}
+
+void MetadataJob::storeUpdatesXml(const FileTaskResult &result, const QString &updatesXml)
+{
+    const QString eTag = result.value(TaskRole::ETag).toString();
+    const QString lastModified = result.value(TaskRole::LastModified).toString();
+    if (eTag.isEmpty() && lastModified.isEmpty())
+        return; // nothing to revalidate against
+
+    const QString url = result.taskItem().source();
+    const QString cacheDir = repositoryCacheDirectory(url);
+    if (cacheDir.isEmpty() || !QDir().mkpath(cacheDir))
+        return;
+
+    // Copy next to the final name first, so an interrupted copy never replaces a valid file.
+    const QString cached = cacheDir + QLatin1String("/Updates.xml");
+    QFile::remove(cached + QLatin1String(".tmp"));
+    if (!QFile::copy(updatesXml, cached + QLatin1String(".tmp"))) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot store Updates.xml in cache" << cacheDir;
+        return;
+    }
+    QFile::remove(cached);
+    if (!QFile::rename(cached + QLatin1String(".tmp"), cached))
+        return;
+
+    QSettings state(cacheDir + QLatin1String("/state.ini"), QSettings::IniFormat);
+    state.setValue(QLatin1String("Url"), url);
+    state.setValue(QLatin1String("ETag"), eTag);
+    state.setValue(QLatin1String("LastModified"), lastModified);
+}
+
+bool MetadataJob::restoreCachedMeta(const QString &sha1, const QString &directory)
+{
+    const QString cached = metaCacheDirectory(sha1);
+    if (cached.isEmpty() || !QFileInfo(cached).isDir())
+        return false;
+
+    try {
+        copyDirectoryContents(cached, directory);
+    } catch (const QInstaller::Error &e) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot use cached meta data" << cached
+            << ":" << e.message();
+        return false;
+    }
+
+    // Mark the entry as recently used.
+    QFile stamp(cached + QLatin1String(".stamp"));
+    if (stamp.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        stamp.close();
+    return true;
+}
+
+void MetadataJob::storeCachedMeta(const QString &extractedDirectory)
+{
+    const QPair<QString, QString> entry = m_metaCacheEntries.take(extractedDirectory);
+    const QString cached = metaCacheDirectory(entry.first);
+
+    // Another installer instance might have stored the same archive meanwhile.
+    QString source = extractedDirectory;
+    if (QFileInfo(cached).isDir() || QDir().rename(extractedDirectory, cached))
+        source = cached;
+
+    copyDirectoryContents(source, entry.second);
+    if (source != extractedDirectory)
+        QInstaller::removeDirectory(extractedDirectory, true);
+
+    QFile stamp(cached + QLatin1String(".stamp"));
+    if (stamp.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        stamp.close();
+}
+
+void MetadataJob::pruneMetaCache()
+{
+    const QDir metaDir(m_cacheDirectory + QLatin1String("/meta"));
+    if (!metaDir.exists())
+        return;
+
+    const QDateTime now = QDateTime::currentDateTime();
+    const QFileInfoList entries = metaDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    foreach (const QFileInfo &entry, entries) {
+        const QFileInfo stamp(entry.absoluteFilePath() + QLatin1String(".stamp"));
+        const QDateTime lastUsed = stamp.exists() ? stamp.lastModified() : entry.lastModified();
+        // Leftover extraction directories are only kept for a day.
+        const bool temporary = entry.fileName().contains(QLatin1String(".tmp-"));
+        if (lastUsed.daysTo(now) < (temporary ? 1 : scMetaCacheMaxAge))
+            continue;
+        QInstaller::removeDirectory(entry.absoluteFilePath(), true);
+        QFile::remove(stamp.absoluteFilePath());
+    }
+}
+
 }   // namespace QInstaller
@@ -41,6 +41,7 @@ class QDomNode;
 
 namespace QInstaller {
 
+class MirrorSelector;
 class PackageManagerCore;
 
 struct Metadata
@@ -83,6 +84,12 @@ public:
     void addDownloadType(DownloadType downloadType) { m_downloadType = downloadType;}
     QStringList shaMismatchPackages() const { return m_shaMissmatchPackages; }
 
+    QString cacheDirectory() const { return m_cacheDirectory; }
+    void setCacheDirectory(const QString &directory);
+
+    MirrorSelector *mirrorSelector() const { return m_mirrorSelector; }
+    void setMirrorSelector(MirrorSelector *selector) { m_mirrorSelector = selector; }
+
     // NEXTGIS: Release message
     QString m_releaseMessage;
 
@@ -97,6 +104,7 @@ private slots:
     void setProgressTotalAmount(int maximum);
     void unzipRepositoryTaskFinished();
     void startXMLTask(const QList<FileTaskItem> &items);
+    void mirrorProbeFinished();
 
 private:
     bool fetchMetaDataPackages();
@@ -114,6 +122,15 @@ private:
     MetadataJob::Status setAdditionalRepositories(QHash<QString, QPair<Repository, Repository> > repositoryUpdates,
                             const FileTaskResult &result, const Metadata& metadata);
 
+    bool probeMirrors(const QSet<Repository> &repositories);
+    QString repositoryUrl(const Repository &repository) const;
+    QString repositoryCacheDirectory(const QString &url) const;
+    QString metaCacheDirectory(const QString &sha1) const;
+    void storeUpdatesXml(const FileTaskResult &result, const QString &updatesXml);
+    bool restoreCachedMeta(const QString &sha1, const QString &directory);
+    void storeCachedMeta(const QString &extractedDirectory);
+    void pruneMetaCache();
+
 private:
     PackageManagerCore *m_core;
 
@@ -126,13 +143,15 @@ private:
     DownloadType m_downloadType;
     QList<FileTaskItem> m_unzipRepositoryitems;
     QList<FileTaskResult> m_metadataResult;
-    int m_downloadableChunkSize;
-    int m_taskNumber;
-    int m_totalTaskCount;
     QStringList m_shaMissmatchPackages;
     QHash<QString, ArchiveMetadata> m_fetchedArchive;
     QHash<QString, Metadata> m_metaFromDefaultRepositories;
     QHash<QString, Metadata> m_metaFromArchive; //for faster lookups.
+
+    QString m_cacheDirectory;
+    MirrorSelector *m_mirrorSelector;
+    // temporary extraction directory -> (meta archive sha1, metadata directory)
+    QHash<QString, QPair<QString, QString> > m_metaCacheEntries;
 };
 
 }   // namespace QInstaller
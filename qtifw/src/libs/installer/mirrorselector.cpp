@@ -0,0 +1,327 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "mirrorselector.h"
+
+#include "fileutils.h"
+#include "globals.h"
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include <algorithm>
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::MirrorSelector
+    \internal
+    \brief The MirrorSelector class ranks the mirrors of repositories by their response time.
+
+    A repository can declare mirrors that provide the same content as its URL. The selector
+    requests Updates.xml from the repository URL and all its mirrors in parallel, measures the
+    latency until the first response byte and the throughput of the transfer, and ranks the
+    mirrors by the estimated time to download a megabyte. URLs below the repository URL can
+    then be rewritten to any of the ranked mirrors, the fastest one first.
+*/
+
+/*!
+    \fn void QInstaller::MirrorSelector::finished()
+
+    Emitted when all mirrors passed to probe() have answered or the timeout has expired.
+*/
+
+static const qint64 scReferenceSize = 1024 * 1024;
+
+static QString withoutTrailingSlash(const QString &url)
+{
+    QString result = url;
+    while (result.endsWith(QLatin1Char('/')))
+        result.chop(1);
+    return result;
+}
+
+static qint64 estimatedTime(const MirrorSelector::Measurement &measurement)
+{
+    const qint64 transfer = measurement.throughput > 0
+        ? scReferenceSize * 1000 / measurement.throughput : 0;
+    return measurement.latency + transfer;
+}
+
+/*!
+    Creates a mirror selector with the parent \a parent.
+*/
+MirrorSelector::MirrorSelector(QObject *parent)
+    : QObject(parent)
+    , m_timeout(10000)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &MirrorSelector::onTimeout);
+    connect(&m_nam, &QNetworkAccessManager::finished, this, &MirrorSelector::onFinished);
+}
+
+/*!
+    Destroys the mirror selector and aborts running probes.
+*/
+MirrorSelector::~MirrorSelector()
+{
+    cancel();
+}
+
+/*!
+    Sets the time after which mirrors that did not answer are considered unreachable to
+    \a milliseconds.
+*/
+void MirrorSelector::setTimeout(int milliseconds)
+{
+    m_timeout = qMax(0, milliseconds);
+}
+
+/*!
+    Probes the URL and mirrors of each of the \a repositories in parallel, using the proxies
+    returned by \a proxyFactory. The selector takes ownership of \a proxyFactory. Emits
+    finished() once all probes are done.
+*/
+void MirrorSelector::probe(const QList<Repository> &repositories, QNetworkProxyFactory *proxyFactory)
+{
+    m_nam.setProxyFactory(proxyFactory);
+
+    foreach (const Repository &repository, repositories) {
+        const QString key = repository.url().toString();
+        const QList<QUrl> urls = QList<QUrl>() << repository.url() << repository.mirrors();
+
+        QList<Measurement> measurements;
+        for (int i = 0; i < urls.count(); ++i) {
+            Measurement measurement;
+            measurement.url = urls.at(i);
+            measurements.append(measurement);
+
+            QNetworkRequest request(QUrl(withoutTrailingSlash(urls.at(i).toString())
+                + QLatin1String("/Updates.xml")));
+            request.setRawHeader("Cache-Control", "no-cache");
+            QNetworkReply *const reply = m_nam.get(request);
+            connect(reply, &QNetworkReply::metaDataChanged, this, &MirrorSelector::onMetaDataChanged);
+
+            Probe probe;
+            probe.repository = key;
+            probe.index = i;
+            probe.timer.start();
+            m_probes.insert(reply, probe);
+        }
+        m_measurements.insert(key, measurements);
+        m_probedRepositories.append(key);
+    }
+
+    if (m_probes.isEmpty())
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    else
+        m_timer.start(m_timeout);
+}
+
+/*!
+    Aborts running probes without emitting finished(). Repositories whose probes did not
+    finish are probed again the next time.
+*/
+void MirrorSelector::cancel()
+{
+    m_timer.stop();
+    m_probedRepositories.clear();
+    const QHash<QNetworkReply *, Probe> probes = m_probes;
+    m_probes.clear();
+    for (auto it = probes.constBegin(); it != probes.constEnd(); ++it) {
+        m_measurements.remove(it.value().repository);
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+}
+
+/*!
+    Returns \c true if the mirrors of the repository with the URL \a repositoryUrl have been
+    probed.
+*/
+bool MirrorSelector::isProbed(const QUrl &repositoryUrl) const
+{
+    return m_measurements.contains(repositoryUrl.toString());
+}
+
+/*!
+    Returns the measurements for the URL and mirrors of the repository with the URL
+    \a repositoryUrl, the fastest mirror first.
+*/
+QList<MirrorSelector::Measurement> MirrorSelector::measurements(const QUrl &repositoryUrl) const
+{
+    return m_measurements.value(repositoryUrl.toString());
+}
+
+/*!
+    Returns the URL of the fastest mirror of the repository with the URL \a repositoryUrl, or
+    \a repositoryUrl itself if the repository has not been probed.
+*/
+QUrl MirrorSelector::preferredUrl(const QUrl &repositoryUrl) const
+{
+    const QList<Measurement> measurements = m_measurements.value(repositoryUrl.toString());
+    return measurements.isEmpty() ? repositoryUrl : measurements.first().url;
+}
+
+/*!
+    Returns the number of mirrors \a url can be downloaded from, including the repository URL
+    itself.
+*/
+int MirrorSelector::mirrorCount(const QString &url) const
+{
+    const QString repository = repositoryOf(url);
+    return repository.isEmpty() ? 1 : m_measurements.value(repository).count();
+}
+
+/*!
+    Returns \a url, which points below a probed repository URL, rewritten to the mirror with
+    the rank \a index. Returns an empty string if there is no such mirror. A \a url outside of
+    probed repositories is returned unchanged for \a index \c 0.
+*/
+QString MirrorSelector::mirrorUrl(const QString &url, int index) const
+{
+    const QString repository = repositoryOf(url);
+    if (repository.isEmpty())
+        return index == 0 ? url : QString();
+
+    const QList<Measurement> measurements = m_measurements.value(repository);
+    if (index < 0 || index >= measurements.count())
+        return QString();
+    return withoutTrailingSlash(measurements.at(index).url.toString())
+        + url.mid(withoutTrailingSlash(repository).length());
+}
+
+/*!
+    Returns the throughput in bytes per second measured for the mirror with the rank \a index
+    of the repository containing \a url, or \c -1 if it is unknown.
+*/
+qint64 MirrorSelector::throughput(const QString &url, int index) const
+{
+    const QList<Measurement> measurements = m_measurements.value(repositoryOf(url));
+    if (index < 0 || index >= measurements.count())
+        return -1;
+    return measurements.at(index).throughput;
+}
+
+
+// -- private slots
+
+void MirrorSelector::onMetaDataChanged()
+{
+    QNetworkReply *const reply = qobject_cast<QNetworkReply *>(sender());
+    const auto it = m_probes.constFind(reply);
+    if (it == m_probes.constEnd())
+        return;
+
+    Measurement &measurement = m_measurements[it->repository][it->index];
+    if (measurement.latency < 0)
+        measurement.latency = it->timer.elapsed();
+}
+
+void MirrorSelector::onFinished(QNetworkReply *reply)
+{
+    if (!m_probes.contains(reply))
+        return;
+
+    const Probe probe = m_probes.take(reply);
+    Measurement &measurement = m_measurements[probe.repository][probe.index];
+    const qint64 elapsed = probe.timer.elapsed();
+    if (measurement.latency < 0)
+        measurement.latency = elapsed;
+
+    if (reply->error() == QNetworkReply::NoError) {
+        const qint64 bytes = reply->readAll().size();
+        measurement.reachable = true;
+        measurement.throughput = bytes * 1000 / qMax<qint64>(1, elapsed - measurement.latency);
+    }
+    reply->deleteLater();
+
+    if (m_probes.isEmpty())
+        finishProbing();
+}
+
+void MirrorSelector::onTimeout()
+{
+    const QList<QNetworkReply *> replies = m_probes.keys();
+    m_probes.clear();
+    foreach (QNetworkReply *reply, replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    finishProbing();
+}
+
+
+// -- private
+
+QString MirrorSelector::repositoryOf(const QString &url) const
+{
+    for (auto it = m_measurements.constBegin(); it != m_measurements.constEnd(); ++it) {
+        const QString base = withoutTrailingSlash(it.key());
+        if (url == base || url.startsWith(base + QLatin1Char('/')))
+            return it.key();
+    }
+    return QString();
+}
+
+void MirrorSelector::finishProbing()
+{
+    m_timer.stop();
+
+    foreach (const QString &repository, m_probedRepositories) {
+        QList<Measurement> &measurements = m_measurements[repository];
+        std::stable_sort(measurements.begin(), measurements.end(),
+            [](const Measurement &lhs, const Measurement &rhs) {
+                if (lhs.reachable != rhs.reachable)
+                    return lhs.reachable;
+                return lhs.reachable && estimatedTime(lhs) < estimatedTime(rhs);
+            });
+
+        foreach (const Measurement &measurement, measurements) {
+            if (measurement.reachable) {
+                qCDebug(QInstaller::lcInstallerInstallLog).noquote() << "Mirror"
+                    << measurement.url.toString() << "of repository" << repository << "- latency"
+                    << measurement.latency << "ms, throughput"
+                    << humanReadableSize(measurement.throughput) + QLatin1String("/s");
+            } else {
+                qCDebug(QInstaller::lcInstallerInstallLog).noquote() << "Mirror"
+                    << measurement.url.toString() << "of repository" << repository << "is unreachable.";
+            }
+        }
+        qCDebug(QInstaller::lcInstallerInstallLog).noquote() << "Using mirror"
+            << measurements.first().url.toString() << "for repository" << repository;
+    }
+    m_probedRepositories.clear();
+    emit finished();
+}
+
+} // namespace QInstaller
@@ -0,0 +1,113 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef MIRRORSELECTOR_H
+#define MIRRORSELECTOR_H
+
+#include "installer_global.h"
+#include "repository.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QNetworkProxyFactory;
+class QNetworkReply;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT MirrorSelector : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(MirrorSelector)
+
+public:
+    struct Measurement
+    {
+        Measurement() : reachable(false), latency(-1), throughput(-1) {}
+
+        QUrl url;
+        bool reachable;
+        qint64 latency;     // milliseconds until the first response byte
+        qint64 throughput;  // bytes per second
+    };
+
+    explicit MirrorSelector(QObject *parent = nullptr);
+    ~MirrorSelector();
+
+    int timeout() const { return m_timeout; }
+    void setTimeout(int milliseconds);
+
+    void probe(const QList<Repository> &repositories, QNetworkProxyFactory *proxyFactory);
+    void cancel();
+    bool isProbing() const { return !m_probes.isEmpty(); }
+    bool isProbed(const QUrl &repositoryUrl) const;
+
+    QList<Measurement> measurements(const QUrl &repositoryUrl) const;
+    QUrl preferredUrl(const QUrl &repositoryUrl) const;
+    int mirrorCount(const QString &url) const;
+    QString mirrorUrl(const QString &url, int index) const;
+    qint64 throughput(const QString &url, int index) const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void onMetaDataChanged();
+    void onFinished(QNetworkReply *reply);
+    void onTimeout();
+
+private:
+    struct Probe
+    {
+        QString repository;
+        int index;
+        QElapsedTimer timer;
+    };
+
+    QString repositoryOf(const QString &url) const;
+    void finishProbing();
+
+private:
+    int m_timeout;
+    QTimer m_timer;
+    QNetworkAccessManager m_nam;
+    QHash<QNetworkReply *, Probe> m_probes;
+    QHash<QString, QList<Measurement> > m_measurements;
+    QStringList m_probedRepositories;   // repositories of the running probe
+};
+
+} // namespace QInstaller
+
+#endif // MIRRORSELECTOR_H
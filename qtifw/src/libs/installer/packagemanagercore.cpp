@@ -762,49 +762,14 @@ int PackageManagerCore::downloadNeededArchives(double partProgressSize)
 {
     Q_ASSERT(partProgressSize >= 0 && partProgressSize <= 1);
 
-    QList<QPair<QString, QString> > archivesToDownload;
-    QList<Component*> neededComponents = orderedComponentsToInstall();
-    foreach (Component *component, neededComponents) {
-        // collect all archives to be downloaded
-        const QStringList toDownload = component->downloadableArchives();
-        foreach (const QString &versionFreeString, toDownload) {
-            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
-                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
-                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
-        }
-    }
-
-    if (archivesToDownload.isEmpty())
+    QScopedPointer<DownloadArchivesJob> archivesJob(d->createDownloadArchivesJob(
+        orderedComponentsToInstall(), partProgressSize));
+    if (!archivesJob)
         return 0;
 
-    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
-
-    DownloadArchivesJob archivesJob(this);
-    archivesJob.setAutoDelete(false);
-    archivesJob.setArchivesToDownload(archivesToDownload);
-    connect(this, &PackageManagerCore::installationInterrupted, &archivesJob, &Job::cancel);
-    connect(&archivesJob, &DownloadArchivesJob::outputTextChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
-    connect(&archivesJob, &DownloadArchivesJob::downloadStatusChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
-
-    ProgressCoordinator::instance()->registerPartProgress(&archivesJob,
-        SIGNAL(progressChanged(double)), partProgressSize);
-
-    archivesJob.start();
-    archivesJob.waitForFinished();
-
-    if (archivesJob.error() == Job::Canceled)
-        interrupt();
-    else if (archivesJob.error() != Job::NoError)
-        throw Error(archivesJob.errorString());
-
-    if (d->statusCanceledOrFailed())
-        throw Error(tr("Installation canceled by user."));
-
-    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
-
-    return archivesJob.numberOfDownloads();
+    archivesJob->start();
+    d->waitForDownloadArchivesJob(archivesJob.data());
+    return archivesJob->numberOfDownloads();
 }
 
 /*!
@@ -1826,6 +1791,7 @@ ScriptEngine *PackageManagerCore::controlScriptEngine() const
 void PackageManagerCore::appendRootComponent(Component *component)
 {
     d->m_rootComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1866,26 +1832,10 @@ void PackageManagerCore::appendRootComponent(Component *component)
 */
 QList<Component *> PackageManagerCore::components(ComponentTypes mask) const
 {
-    QList<Component *> components;
-
-    const bool updater = isUpdater();
-    if (mask.testFlag(ComponentType::Root))
-        components += updater ? d->m_updaterComponents : d->m_rootComponents;
-    if (mask.testFlag(ComponentType::Replacements))
-        components += updater ? d->m_updaterDependencyReplacements : d->m_rootDependencyReplacements;
-
-    if (!updater) {
-        if (mask.testFlag(ComponentType::Descendants)) {
-            foreach (QInstaller::Component *component, d->m_rootComponents)
-                components += component->descendantComponents();
-        }
-    } else {
-        if (mask.testFlag(ComponentType::Dependencies))
-            components.append(d->m_updaterComponentsDeps);
-        // No descendants here, updates are always a flat list and cannot have children!
-    }
-
-    return components;
+    // the most common list is kept up to date instead of being collected on every call
+    if (mask == ComponentTypes(ComponentType::AllNoReplacements))
+        return d->indexedComponents();
+    return d->components(mask);
 }
 
 // NEXTGIS: Release message
@@ -1902,6 +1852,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 {
     component->setUpdateAvailable(true);
     d->m_updaterComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1913,7 +1864,25 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 */
 Component *PackageManagerCore::componentByName(const QString &name) const
 {
-    return componentByName(name, components(ComponentType::AllNoReplacements));
+    if (name.isEmpty())
+        return nullptr;
+
+    QString fixedVersion;
+    QString fixedName;
+
+    parseNameAndVersion(name, &fixedName, &fixedVersion);
+
+    // the index holds the first component of each name, which is the one to return unless it
+    // does not match the version, then another component with the same name might
+    Component *component = d->componentsByName().value(fixedName);
+    if (!component || componentMatches(component, fixedName, fixedVersion))
+        return component;
+
+    foreach (Component *candidate, d->indexedComponents()) {
+        if (candidate != component && componentMatches(candidate, fixedName, fixedVersion))
+            return candidate;
+    }
+    return nullptr;
 }
 
 /*!
@@ -3770,6 +3739,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
         if (updateComponentData(data, component.data())) {
             // Keep a reference so we can resolve dependencies during update.
             d->m_updaterComponentsDeps.append(component.take());
+            d->invalidateComponentIndex();
 
 //            const QString isNew = update->data(scNewComponent).toString();
 //            if (isNew.toLower() != scTrue)
@@ -3815,6 +3785,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
 
             // this is not a dependency, it is a real update
             components.insert(name, d->m_updaterComponentsDeps.takeLast());
+            d->invalidateComponentIndex();
         } else {
             return false;
         }
@@ -3825,6 +3796,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
         QInstaller::Component *component = new QInstaller::Component(this);
         component->loadDataFromPackage(installedPackages.value(key));
         d->m_updaterComponentsDeps.append(component);
+        d->invalidateComponentIndex();
         // Keep a list of local components that should be replaced
         if (replaceMes.contains(component->name()))
             localReplaceMes.insert(component->name(), component);
@@ -3885,6 +3857,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
 
             std::sort(d->m_updaterComponents.begin(), d->m_updaterComponents.end(),
                 Component::SortingPriorityGreaterThan());
+            d->invalidateComponentIndex();
         } else {
             // we have no updates, no need to store possible dependencies
             d->clearUpdaterComponentLists();
@@ -3909,6 +3882,14 @@ void PackageManagerCore::restoreCheckState()
     d->restoreCheckState();
 }
 
+/*
+    Called by components when they are added to or removed from a parent component, or renamed.
+*/
+void PackageManagerCore::invalidateComponentIndex()
+{
+    d->invalidateComponentIndex();
+}
+
 void PackageManagerCore::updateDisplayVersions(const QString &displayKey)
 {
     QHash<QString, QInstaller::Component *> componentsHash;
@@ -432,6 +432,10 @@ private:
     // remove once we deprecate isSelected, setSelected etc...
     friend class ComponentSelectionPage;
     void restoreCheckState();
+
+private:
+    friend class Component;
+    void invalidateComponentIndex();
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(PackageManagerCore::ComponentTypes)
 
@@ -47,6 +47,11 @@
 #include "installercalculator.h"
 #include "uninstallercalculator.h"
 #include "componentchecker.h"
+#include "archivecache.h"
+#include "downloadarchivesjob.h"
+#include "extractarchiveoperation.h"
+#include "lib7z_facade.h"
+#include "lib7z_list.h"
 #include "globals.h"
 #include "binarycreator.h"
 #include "loggingutils.h"
@@ -62,10 +67,13 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
+#include <QtCore/QEventLoop>
+#include <QtCore/QStandardPaths>
 #include <QtCore/QUuid>
 #include <QtCore/QFuture>
 #include <QtCore/QFutureWatcher>
 #include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
 
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -451,6 +459,7 @@ bool PackageManagerCorePrivate::buildComponentTree(QHash<QString, Component*> &c
         }
 
         std::sort(m_rootComponents.begin(), m_rootComponents.end(), Component::SortingPriorityGreaterThan());
+        invalidateComponentIndex();
 
         storeCheckState();
 
@@ -514,8 +523,89 @@ ScriptEngine *PackageManagerCorePrivate::controlScriptEngine() const
     return m_controlScriptEngine;
 }
 
+/*
+    Returns the components selected by \a mask, see PackageManagerCore::components().
+*/
+QList<Component *> PackageManagerCorePrivate::components(PackageManagerCore::ComponentTypes mask) const
+{
+    QList<Component *> components;
+
+    const bool updater = isUpdater();
+    if (mask.testFlag(PackageManagerCore::ComponentType::Root))
+        components += updater ? m_updaterComponents : m_rootComponents;
+    if (mask.testFlag(PackageManagerCore::ComponentType::Replacements))
+        components += updater ? m_updaterDependencyReplacements : m_rootDependencyReplacements;
+
+    if (!updater) {
+        if (mask.testFlag(PackageManagerCore::ComponentType::Descendants)) {
+            foreach (QInstaller::Component *component, m_rootComponents)
+                components += component->descendantComponents();
+        }
+    } else {
+        if (mask.testFlag(PackageManagerCore::ComponentType::Dependencies))
+            components.append(m_updaterComponentsDeps);
+        // No descendants here, updates are always a flat list and cannot have children!
+    }
+
+    return components;
+}
+
+/*
+    Marks the component index out of date. Needs to be called whenever a component is added to,
+    moved in, or removed from the component lists, or a component is renamed.
+*/
+void PackageManagerCorePrivate::invalidateComponentIndex()
+{
+    QMutexLocker _(&m_componentIndexMutex);
+    m_componentIndexValid = false;
+}
+
+/*
+    Returns all components without replacements, in the order of
+    PackageManagerCore::components(). The list is only collected again after a change.
+*/
+QList<Component *> PackageManagerCorePrivate::indexedComponents()
+{
+    QMutexLocker _(&m_componentIndexMutex);
+    updateComponentIndex();
+    return m_indexedComponents;
+}
+
+/*
+    Returns the first component of each name in indexedComponents().
+*/
+QHash<QString, Component *> PackageManagerCorePrivate::componentsByName()
+{
+    QMutexLocker _(&m_componentIndexMutex);
+    updateComponentIndex();
+    return m_componentsByName;
+}
+
+/*
+    Collects the component index again if it is out of date. Must be called with the index
+    mutex locked.
+*/
+void PackageManagerCorePrivate::updateComponentIndex()
+{
+    const bool updater = isUpdater();
+    if (m_componentIndexValid && m_componentIndexUpdater == updater)
+        return;
+
+    m_indexedComponents = components(PackageManagerCore::ComponentType::AllNoReplacements);
+    m_componentsByName.clear();
+    m_componentsByName.reserve(m_indexedComponents.count());
+    foreach (Component *component, m_indexedComponents) {
+        const QString name = component->name();
+        if (!name.isEmpty() && !m_componentsByName.contains(name))
+            m_componentsByName.insert(name, component);
+    }
+    m_componentIndexUpdater = updater;
+    m_componentIndexValid = true;
+}
+
 void PackageManagerCorePrivate::clearAllComponentLists()
 {
+    invalidateComponentIndex();
     QList<QInstaller::Component*> toDelete;
 
     toDelete << m_rootComponents;
@@ -535,6 +625,7 @@ void PackageManagerCorePrivate::clearAllComponentLists()
 
 void PackageManagerCorePrivate::clearUpdaterComponentLists()
 {
+    invalidateComponentIndex();
     QSet<Component*> usedComponents =
         QSet<Component*>::fromList(m_updaterComponents + m_updaterComponentsDeps);
 
@@ -675,6 +766,9 @@ void PackageManagerCorePrivate::initialize(const QHash<QString, QString> &params
     m_metadataJob.disconnect();
     m_metadataJob.setAutoDelete(false);
     m_metadataJob.setPackageManagerCore(m_core);
+    m_metadataJob.setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QLatin1String("/metadata"));
+    m_metadataJob.setMirrorSelector(&m_mirrorSelector);
     connect(&m_metadataJob, &Job::infoMessage, this, &PackageManagerCorePrivate::infoMessage);
     connect(&m_metadataJob, &Job::progress, this, &PackageManagerCorePrivate::infoProgress);
     connect(&m_metadataJob, &Job::totalProgress, this, &PackageManagerCorePrivate::totalProgress);
@@ -821,6 +915,8 @@ static QSet<Repository> readRepositories(QXmlStreamReader &reader, bool isDefaul
             while (reader.readNextStartElement()) {
                 if (reader.name() == QLatin1String("Host"))
                     repo.setUrl(reader.readElementText());
+                else if (reader.name() == QLatin1String("Mirror"))
+                    repo.setMirrors(repo.mirrors() << QUrl(reader.readElementText()));
                 else if (reader.name() == QLatin1String("Username"))
                     repo.setUsername(reader.readElementText());
                 else if (reader.name() == QLatin1String("Password"))
@@ -902,6 +998,8 @@ void PackageManagerCorePrivate::writeMaintenanceConfigFiles()
             foreach (const Repository &repo, m_data.settings().userRepositories()) {
                 writer.writeStartElement(QLatin1String("Repository"));
                     writer.writeTextElement(QLatin1String("Host"), repo.url().toString());
+                    foreach (const QUrl &mirror, repo.mirrors())
+                        writer.writeTextElement(QLatin1String("Mirror"), mirror.toString());
                     writer.writeTextElement(QLatin1String("Username"), repo.username());
                     writer.writeTextElement(QLatin1String("Password"), repo.password());
                     writer.writeTextElement(QLatin1String("Enabled"), QString::number(repo.isEnabled()));
@@ -1662,10 +1760,20 @@ bool PackageManagerCorePrivate::runInstaller()
 
         const double downloadPartProgressSize = double(1) / double(3);
         double componentsInstallPartProgressSize = double(2) / double(3);
-        const int downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+
+        // in pipelined mode the components get installed while later archives are downloading
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        int downloadedArchivesCount = 0;
+        if (m_data.settings().pipelinedInstallation()) {
+            archivesJob.reset(createDownloadArchivesJob(componentsToInstall, downloadPartProgressSize));
+            if (archivesJob)
+                archivesJob->start();
+        } else {
+            downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
 
         // if there was no download we have the whole progress for installing components
-        if (!downloadedArchivesCount)
+        if (!downloadedArchivesCount && !archivesJob)
             componentsInstallPartProgressSize = double(1);
 
         // Force an update on the components xml as the install dir might have changed.
@@ -1682,8 +1790,10 @@ bool PackageManagerCorePrivate::runInstaller()
             + (PackageManagerCore::createLocalRepositoryFromBinary() ? 1 : 0);
         double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        installComponents(componentsToInstall, progressOperationSize, adminRightsGained,
+            archivesJob.data());
+        if (archivesJob)
+            waitForDownloadArchivesJob(archivesJob.data());
 
         if (m_core->isOfflineOnly() && PackageManagerCore::createLocalRepositoryFromBinary()) {
             emit m_core->titleMessageChanged(tr("Creating local repository"));
@@ -1894,10 +2004,24 @@ bool PackageManagerCorePrivate::runPackageUpdater()
 
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Preparing the installation..."));
 
-        // following, we download the needed archives
-        m_core->downloadNeededArchives(downloadPartProgressSize);
+        // following, we download the needed archives, in pipelined mode while installing the
+        // components already downloaded
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        if (m_data.settings().pipelinedInstallation()) {
+            archivesJob.reset(createDownloadArchivesJob(componentsToInstall, downloadPartProgressSize));
+            if (archivesJob)
+                archivesJob->start();
+        } else {
+            m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
 
         if (undoOperations.count() > 0) {
+            // The undone operations are deleted and cannot be rolled back. Do not remove the
+            // installed versions before all archives are available, a failing or canceled
+            // download would leave neither the old nor the new version installed.
+            if (archivesJob)
+                waitForDownloadArchivesJob(archivesJob.data());
+
             ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Removing deselected components..."));
             runUndoOperations(undoOperations, undoOperationProgressSize, adminRightsGained, true);
         }
@@ -1906,8 +2030,10 @@ bool PackageManagerCorePrivate::runPackageUpdater()
         const double progressOperationCount = countProgressOperations(componentsToInstall);
         const double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        installComponents(componentsToInstall, progressOperationSize, adminRightsGained,
+            archivesJob.data());
+        if (archivesJob)
+            waitForDownloadArchivesJob(archivesJob.data());
 
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
@@ -2150,8 +2276,293 @@ bool PackageManagerCorePrivate::runOfflineGenerator()
     return success;
 }
 
-void PackageManagerCorePrivate::installComponent(Component *component, double progressOperationSize,
-    bool adminRightsGained)
+/*!
+    Creates a job that downloads the archives of \a components, in the order of \a components.
+    The download progress takes \a partProgressSize of the overall progress. Returns \c nullptr
+    if none of the components has archives to download.
+*/
+DownloadArchivesJob *PackageManagerCorePrivate::createDownloadArchivesJob(
+    const QList<Component *> &components, double partProgressSize)
+{
+    QList<QPair<QString, QString> > archivesToDownload;
+    foreach (Component *component, components) {
+        // collect all archives to be downloaded
+        const QStringList toDownload = component->downloadableArchives();
+        foreach (const QString &versionFreeString, toDownload) {
+            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
+                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
+                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
+        }
+    }
+
+    if (archivesToDownload.isEmpty())
+        return nullptr;
+
+    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
+
+    DownloadArchivesJob *archivesJob = new DownloadArchivesJob(m_core);
+    archivesJob->setAutoDelete(false);
+    archivesJob->setArchivesToDownload(archivesToDownload);
+    archivesJob->setMaxConcurrentDownloads(m_data.settings().maxConcurrentDownloads());
+    archivesJob->setMaxSegmentsPerDownload(m_data.settings().maxSegmentsPerDownload());
+    archivesJob->setResumeDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QLatin1String("/downloads"));
+    archivesJob->setMirrorSelector(&m_mirrorSelector);
+
+    // the archive cache is opt-in, the directory can be given in config.xml or on the command line
+    QScopedPointer<ArchiveCache> archiveCache(new ArchiveCache(m_core->value(scArchiveCacheDirectory),
+        m_core->value(scArchiveCacheSize, QLatin1String("4096")).toLongLong() * 1024 * 1024));
+    if (archiveCache->isValid())
+        archivesJob->setArchiveCache(archiveCache.take());
+
+    connect(m_core, &PackageManagerCore::installationInterrupted, archivesJob, &Job::cancel);
+    connect(archivesJob, &DownloadArchivesJob::outputTextChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
+    connect(archivesJob, &DownloadArchivesJob::downloadStatusChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
+
+    ProgressCoordinator::instance()->registerPartProgress(archivesJob,
+        SIGNAL(progressChanged(double)), partProgressSize);
+    return archivesJob;
+}
+
+/*!
+    Waits until the started archives \a job has finished. Throws an error if downloading failed
+    or the installation has been canceled.
+*/
+void PackageManagerCorePrivate::waitForDownloadArchivesJob(DownloadArchivesJob *job)
+{
+    if (!job->isFinished())
+        job->waitForFinished();
+
+    if (job->error() == Job::Canceled)
+        m_core->interrupt();
+    else if (job->error() != Job::NoError)
+        throw Error(job->errorString());
+
+    if (statusCanceledOrFailed())
+        throw Error(tr("Installation canceled by user."));
+
+    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
+}
+
+/*!
+    Waits until the archives \a job has registered all archives of \a component, so that the
+    component can be installed while the remaining archives are still downloading. Throws an
+    error if downloading failed or the installation has been canceled.
+*/
+void PackageManagerCorePrivate::waitForComponentArchives(DownloadArchivesJob *job,
+    Component *component)
+{
+    QStringList archives;
+    foreach (const QString &versionFreeString, component->downloadableArchives()) {
+        archives.append(QString::fromLatin1("installer://%1/%2").arg(component->name(),
+            versionFreeString));
+    }
+
+    const auto archivesRegistered = [job, archives]() {
+        foreach (const QString &archive, archives) {
+            if (!job->isArchiveRegistered(archive))
+                return false;
+        }
+        return true;
+    };
+
+    if (!archivesRegistered() && !job->isFinished()) {
+        QEventLoop loop;
+        connect(job, &DownloadArchivesJob::archiveRegistered, &loop, [&loop, &archivesRegistered]() {
+            if (archivesRegistered())
+                loop.quit();
+        });
+        connect(job, &Job::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    if (job->isFinished() && job->error() != Job::NoError)
+        waitForDownloadArchivesJob(job);
+}
+
+/*
+    Spins an event loop until \a future has finished, so the user interface stays responsive
+    while the pool works.
+*/
+template <typename T>
+static void waitForFuture(const QFuture<T> &future)
+{
+    if (future.isFinished())
+        return;
+    QFutureWatcher<T> futureWatcher;
+    QEventLoop loop;
+    QObject::connect(&futureWatcher, &QFutureWatcher<T>::finished, &loop, &QEventLoop::quit,
+        Qt::QueuedConnection);
+    futureWatcher.setFuture(future);
+    if (!future.isFinished())
+        loop.exec();
+}
+
+/*
+    Returns the paths of the files and directories the extract \a operation will create, or an
+    empty list if the archive cannot be listed. Paths are compared case-insensitively on file
+    systems that usually are. The operation keeps the archive open for the extraction.
+
+    Opening the archive parses its headers, which can take long for solid archives, so this
+    runs in the extraction pool and not on the thread that drives the installation.
+*/
+static QPair<QSet<QString>, QSet<QString>> extractTargets(Operation *operation)
+{
+    QPair<QSet<QString>, QSet<QString>> targets;
+    const QStringList args = operation->arguments();
+    ExtractArchiveOperation *const extract = dynamic_cast<ExtractArchiveOperation *>(operation);
+    if (!extract || args.count() != 2)
+        return targets;
+
+    try {
+        const QString targetDir = QDir::cleanPath(args.at(1)) + QLatin1Char('/');
+        foreach (const Lib7z::File &file, extract->archiveContents()) {
+            QString path = QDir::cleanPath(targetDir + file.path);
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+            path = path.toLower();
+#endif
+            (file.isDirectory ? targets.second : targets.first).insert(path);
+        }
+    } catch (const Lib7z::SevenZipException &e) {
+        qCWarning(QInstaller::lcInstallerInstallLog) << "Cannot list archive" << args.at(0)
+            << "for concurrent extraction:" << e.message();
+        return QPair<QSet<QString>, QSet<QString>>();
+    }
+    return targets;
+}
+
+/*
+    Installs \a components in the given order. Consecutive \c Extract operations, of one or
+    several components, are run concurrently as long as their archives do not contain the same
+    files and MaxConcurrentExtractions allows it. Any other operation waits for the running
+    extractions. The performed operations are recorded in the original order, so they can be
+    rolled back the same way as after a sequential installation.
+*/
+void PackageManagerCorePrivate::installComponents(const QList<Component *> &components,
+    double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob)
+{
+    const int maxExtractions = m_data.settings().maxConcurrentExtractions();
+    if (maxExtractions <= 1) {
+        foreach (Component *component, components) {
+            if (archivesJob)
+                waitForComponentArchives(archivesJob, component);
+            installComponent(component, progressOperationSize, adminRightsGained);
+        }
+        return;
+    }
+
+    struct Extraction {
+        Component *component;
+        Operation *operation;
+        QFuture<bool> future;
+    };
+    QList<Extraction> extractions;
+    QSet<QString> extractedFiles;
+    QSet<QString> extractedDirectories;
+    // components whose operations were all started, in installation order
+    QList<QPair<Component *, bool>> pendingComponents;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxExtractions);
+
+    // Waits for the running extractions and records them in the original order. Throws if one
+    // of them failed and the user did not choose to ignore it.
+    auto waitForExtractions = [&](bool askOnError) {
+        foreach (const Extraction &extraction, extractions)
+            waitForFuture(extraction.future);
+
+        bool success = true;
+        QString errorString;
+        foreach (const Extraction &extraction, extractions) {
+            // after a failure that was not ignored, the remaining extractions are only recorded
+            if (!completeInstallOperation(extraction.component, extraction.operation,
+                    extraction.future.result(), askOnError && success) && success) {
+                success = false;
+                errorString = extraction.operation->errorString();
+            }
+        }
+        extractions.clear();
+        extractedFiles.clear();
+        extractedDirectories.clear();
+        if (!success)
+            throw Error(errorString);
+
+        for (int i = 0; i < pendingComponents.count(); ++i)
+            finishComponentInstallation(pendingComponents.at(i).first, pendingComponents.at(i).second);
+        pendingComponents.clear();
+    };
+
+    try {
+        foreach (Component *component, components) {
+            if (archivesJob)
+                waitForComponentArchives(archivesJob, component);
+            const bool showDetailsLog = beginComponentInstallation(component);
+
+            foreach (Operation *operation, component->operations()) {
+                if (statusCanceledOrFailed())
+                    throw Error(tr("Installation canceled by user"));
+
+                const bool needsAdmin = !adminRightsGained
+                    && operation->value(QLatin1String("admin")).toBool();
+                QPair<QSet<QString>, QSet<QString>> targets;
+                if (operation->name() == QLatin1String("Extract") && !needsAdmin) {
+                    // queued behind waiting extractions; it is only needed once a thread is free
+                    const QFuture<QPair<QSet<QString>, QSet<QString>>> listing
+                        = QtConcurrent::run(&pool, extractTargets, operation);
+                    waitForFuture(listing);
+                    targets = listing.result();
+                }
+
+                // MinimumProgress does nothing, it must not separate the extractions of components
+                if (targets.first.isEmpty() && targets.second.isEmpty()
+                        && operation->name() != QLatin1String("MinimumProgress")) {
+                    waitForExtractions(true);
+                    performInstallOperation(component, operation, progressOperationSize,
+                        adminRightsGained);
+                    continue;
+                }
+
+                if (targets.first.intersects(extractedFiles)
+                        || targets.first.intersects(extractedDirectories)
+                        || targets.second.intersects(extractedFiles)) {
+                    waitForExtractions(true);
+                }
+                extractedFiles.unite(targets.first);
+                extractedDirectories.unite(targets.second);
+
+                connectOperationToInstaller(operation, progressOperationSize);
+                connectOperationCallMethodRequest(operation);
+                extractions.append({ component, operation, QtConcurrent::run(&pool, [operation]() {
+                    runOperation(operation, Operation::Backup);
+                    return runOperation(operation, Operation::Perform);
+                }) });
+            }
+
+            pendingComponents.append(qMakePair(component, showDetailsLog));
+            if (extractions.isEmpty())
+                waitForExtractions(true);
+        }
+        waitForExtractions(true);
+    } catch (...) {
+        // make sure everything that was extracted gets rolled back
+        pendingComponents.clear();
+        if (!extractions.isEmpty()) {
+            try {
+                waitForExtractions(false);
+            } catch (const Error &) {
+            }
+        }
+        throw;
+    }
+}
+
+/*
+    Emits the label for installing \a component. Returns whether the component does something
+    worth logging.
+*/
+bool PackageManagerCorePrivate::beginComponentInstallation(Component *component)
 {
     const OperationList operations = component->operations();
     if (!component->operationsCreatedSuccessfully())
@@ -2159,69 +2570,101 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
 
     const int opCount = operations.count();
     // show only components which do something, MinimumProgress is only for progress calculation safeness
-    bool showDetailsLog = false;
     if (opCount > 1 || (opCount == 1 && operations.at(0)->name() != QLatin1String("MinimumProgress"))) {
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nInstalling component %1")
             .arg(component->displayName()));
-        showDetailsLog = true;
+        return true;
     }
+    return false;
+}
 
-    foreach (Operation *operation, operations) {
+void PackageManagerCorePrivate::installComponent(Component *component, double progressOperationSize,
+    bool adminRightsGained)
+{
+    const bool showDetailsLog = beginComponentInstallation(component);
+    foreach (Operation *operation, component->operations()) {
         if (statusCanceledOrFailed())
             throw Error(tr("Installation canceled by user"));
 
-        // maybe this operations wants us to be admin...
-        bool becameAdmin = false;
-        if (!adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
-            becameAdmin = m_core->gainAdminRights();
-            qCDebug(QInstaller::lcInstallerInstallLog) << operation->name() << "as admin:" << becameAdmin;
-        }
+        performInstallOperation(component, operation, progressOperationSize, adminRightsGained);
+    }
+    finishComponentInstallation(component, showDetailsLog);
+}
 
-        connectOperationToInstaller(operation, progressOperationSize);
-        connectOperationCallMethodRequest(operation);
+void PackageManagerCorePrivate::performInstallOperation(Component *component, Operation *operation,
+    double progressOperationSize, bool adminRightsGained)
+{
+    // maybe this operations wants us to be admin...
+    bool becameAdmin = false;
+    if (!adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
+        becameAdmin = m_core->gainAdminRights();
+        qCDebug(QInstaller::lcInstallerInstallLog) << operation->name() << "as admin:" << becameAdmin;
+    }
 
-        // allow the operation to backup stuff before performing the operation
-        performOperationThreaded(operation, Operation::Backup);
+    connectOperationToInstaller(operation, progressOperationSize);
+    connectOperationCallMethodRequest(operation);
 
-        bool ignoreError = false;
-        bool ok = performOperationThreaded(operation);
-        while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
-            qCDebug(QInstaller::lcInstallerInstallLog) << QString::fromLatin1("Operation \"%1\" with arguments "
-                "\"%2\" failed: %3").arg(operation->name(), operation->arguments()
-                .join(QLatin1String("; ")), operation->errorString());
-            const QMessageBox::StandardButton button =
-                MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
-                QLatin1String("installationErrorWithCancel"), tr("Installer Error"),
-                tr("Error during installation process (%1):\n%2").arg(component->name(),
-                operation->errorString()),
-                QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Cancel);
+    // allow the operation to backup stuff before performing the operation
+    performOperationThreaded(operation, Operation::Backup);
 
-            if (button == QMessageBox::Retry)
-                ok = performOperationThreaded(operation);
-            else if (button == QMessageBox::Ignore)
-                ignoreError = true;
-            else if (button == QMessageBox::Cancel)
-                m_core->interrupt();
-        }
+    const bool ok = completeInstallOperation(component, operation, performOperationThreaded(operation));
 
-        if (ok || operation->error() > Operation::InvalidArguments) {
-            // Remember that the operation was performed, that allows us to undo it if a following operation
-            // fails or if this operation failed but still needs an undo call to cleanup.
-            addPerformed(operation);
-        }
+    if (becameAdmin)
+        m_core->dropAdminRights();
 
-        if (becameAdmin)
-            m_core->dropAdminRights();
+    if (!ok)
+        throw Error(operation->errorString());
+}
+
+/*
+    Handles the result \a ok of performing \a operation of \a component. On failure, the user
+    can retry the operation or ignore the error, unless \a askOnError is \c false. Records the
+    operation as performed if needed. Returns whether the installation can continue.
+*/
+bool PackageManagerCorePrivate::completeInstallOperation(Component *component, Operation *operation,
+    bool ok, bool askOnError)
+{
+    bool ignoreError = false;
+    while (askOnError && !ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
+        qCDebug(QInstaller::lcInstallerInstallLog) << QString::fromLatin1("Operation \"%1\" with arguments "
+            "\"%2\" failed: %3").arg(operation->name(), operation->arguments()
+            .join(QLatin1String("; ")), operation->errorString());
+        const QMessageBox::StandardButton button =
+            MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
+            QLatin1String("installationErrorWithCancel"), tr("Installer Error"),
+            tr("Error during installation process (%1):\n%2").arg(component->name(),
+            operation->errorString()),
+            QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Cancel);
 
-        if (!ok && !ignoreError)
-            throw Error(operation->errorString());
+        if (button == QMessageBox::Retry)
+            ok = performOperationThreaded(operation);
+        else if (button == QMessageBox::Ignore)
+            ignoreError = true;
+        else if (button == QMessageBox::Cancel)
+            m_core->interrupt();
+    }
 
-        if (((component->value(scEssential, scFalse) == scTrue) || (component->value(scForcedUpdate, scFalse) == scTrue))
-             && !m_core->isCommandLineInstance()) {
-            m_needsHardRestart = true;
-        }
+    if (ok || operation->error() > Operation::InvalidArguments) {
+        // Remember that the operation was performed, that allows us to undo it if a following operation
+        // fails or if this operation failed but still needs an undo call to cleanup.
+        addPerformed(operation);
     }
 
+    if (!ok && !ignoreError)
+        return false;
+
+    if (((component->value(scEssential, scFalse) == scTrue) || (component->value(scForcedUpdate, scFalse) == scTrue))
+         && !m_core->isCommandLineInstance()) {
+        m_needsHardRestart = true;
+    }
+    return true;
+}
+
+/*
+    Registers \a component as installed once all its operations were performed.
+*/
+void PackageManagerCorePrivate::finishComponentInstallation(Component *component, bool showDetailsLog)
+{
     registerPathsForUninstallation(component->pathsForUninstallation(), component->name());
 
     if (!component->stopProcessForUpdateRequests().isEmpty()) {
@@ -2756,8 +3199,13 @@ OperationList PackageManagerCorePrivate::sortOperationsBasedOnComponentDependenc
 
     const QStringList resolvedComponents = componentGraph.sort();
     if (componentGraph.hasCycle()) {
-        throw Error(tr("Dependency cycle between components \"%1\" and \"%2\" detected.")
-            .arg(componentGraph.cycle().first, componentGraph.cycle().second));
+        QStringList errors;
+        typedef QPair<QString, QString> Cycle;
+        foreach (const Cycle &cycle, componentGraph.cycles()) {
+            errors.append(tr("Dependency cycle between components \"%1\" and \"%2\" detected.")
+                .arg(cycle.first, cycle.second));
+        }
+        throw Error(errors.join(QLatin1Char('\n')));
     }
     foreach (const QString &componentName, resolvedComponents)
         sortedOperations.append(componentOperationHash.value(componentName));
@@ -30,6 +30,7 @@
 #define PACKAGEMANAGERCORE_P_H
 
 #include "metadatajob.h"
+#include "mirrorselector.h"
 #include "packagemanagercore.h"
 #include "packagemanagercoredata.h"
 #include "packagemanagerproxyfactory.h"
@@ -39,6 +40,7 @@
 #include "sysinfo.h"
 #include "updatefinder.h"
 
+#include <QMutex>
 #include <QObject>
 
 class Job;
@@ -53,6 +55,7 @@ namespace QInstaller {
 
 struct BinaryLayout;
 class Component;
+class DownloadArchivesJob;
 class ScriptEngine;
 class ComponentModel;
 class TempDirDeleter;
@@ -109,6 +112,11 @@ public:
 
     void clearAllComponentLists();
     void clearUpdaterComponentLists();
+
+    QList<Component *> components(PackageManagerCore::ComponentTypes mask) const;
+    void invalidateComponentIndex();
+    QList<Component *> indexedComponents();
+    QHash<QString, Component *> componentsByName();
     QList<Component*> &replacementDependencyComponents();
     QHash<QString, QPair<Component*, Component*> > &componentsToReplace();
 
@@ -159,8 +167,21 @@ public:
         m_performedOperationsCurrentSession.clear();
     }
 
+    void installComponents(const QList<Component *> &components, double progressOperationSize,
+        bool adminRightsGained, DownloadArchivesJob *archivesJob);
     void installComponent(Component *component, double progressOperationSize,
         bool adminRightsGained = false);
+    bool beginComponentInstallation(Component *component);
+    void performInstallOperation(Component *component, Operation *operation,
+        double progressOperationSize, bool adminRightsGained);
+    void finishComponentInstallation(Component *component, bool showDetailsLog);
+    bool completeInstallOperation(Component *component, Operation *operation, bool ok,
+        bool askOnError = true);
+
+    DownloadArchivesJob *createDownloadArchivesJob(const QList<Component *> &components,
+        double partProgressSize);
+    void waitForDownloadArchivesJob(DownloadArchivesJob *job);
+    void waitForComponentArchives(DownloadArchivesJob *job, Component *component);
 
     bool runningProcessesFound();
     void setComponentSelection(const QString &id, Qt::CheckState state);
@@ -205,6 +226,14 @@ public:
     QList<QInstaller::Component*> m_updaterComponentsDeps;
     QList<QInstaller::Component*> m_updaterDependencyReplacements;
 
+    // components(AllNoReplacements) and the first of them per name, rebuilt once out of date;
+    // guarded by the mutex, as components are also looked up from worker threads
+    QMutex m_componentIndexMutex;
+    bool m_componentIndexValid = false;
+    bool m_componentIndexUpdater = false;
+    QList<QInstaller::Component*> m_indexedComponents;
+    QHash<QString, QInstaller::Component*> m_componentsByName;
+
     //NEXTGIS: Release message
     QString m_releaseMessage;
     // End NextGIS
@@ -258,9 +287,11 @@ private:
     bool acceptLicenseAgreements() const;
     bool askUserAcceptLicense(const QString &name, const QString &content) const;
     bool askUserConfirmCommand() const;
+    void updateComponentIndex();
 
 private:
     PackageManagerCore *m_core;
+    MirrorSelector m_mirrorSelector;
     MetadataJob m_metadataJob;
 
     bool m_updates;
@@ -64,6 +64,7 @@ Repository::Repository(const Repository &other)
     , m_displayname(other.m_displayname)
     , m_compressed(other.m_compressed)
     , m_categoryname(other.m_categoryname)
+    , m_mirrors(other.m_mirrors)
 {
     registerMetaType();
 }
@@ -141,6 +142,27 @@ void Repository::setUrl(const QUrl &url)
     m_url = url;
 }
 
+/*!
+    Returns the URLs of mirrors that provide the same content as the repository URL. The
+    installer probes the repository URL and its mirrors and downloads from the fastest one,
+    falling back to the others on errors.
+
+    \sa url()
+*/
+QList<QUrl> Repository::mirrors() const
+{
+    return m_mirrors;
+}
+
+/*!
+    Sets the URLs of mirrors that provide the same content as the repository URL to
+    \a mirrors.
+*/
+void Repository::setMirrors(const QList<QUrl> &mirrors)
+{
+    m_mirrors = mirrors;
+}
+
 /*!
     Returns whether the repository is enabled and used during information retrieval.
 */
@@ -265,6 +287,7 @@ const Repository &Repository::operator=(const Repository &other)
     m_displayname = other.m_displayname;
     m_compressed = other.m_compressed;
     m_categoryname = other.m_categoryname;
+    m_mirrors = other.m_mirrors;
 
     return *this;
 }
@@ -281,12 +304,16 @@ void Repository::registerMetaType()
 QDataStream &operator>>(QDataStream &istream, Repository &repository)
 {
     QByteArray url, username, password, displayname, compressed;
+    QList<QByteArray> mirrors;
     istream >> url >> repository.m_default >> repository.m_enabled >> username >> password
-            >> displayname >> repository.m_categoryname;
+            >> displayname >> repository.m_categoryname >> mirrors;
     repository.setUrl(QUrl::fromEncoded(QByteArray::fromBase64(url)));
     repository.setUsername(QString::fromUtf8(QByteArray::fromBase64(username)));
     repository.setPassword(QString::fromUtf8(QByteArray::fromBase64(password)));
     repository.setDisplayName(QString::fromUtf8(QByteArray::fromBase64(displayname)));
+    repository.m_mirrors.clear();
+    foreach (const QByteArray &mirror, mirrors)
+        repository.m_mirrors.append(QUrl::fromEncoded(QByteArray::fromBase64(mirror)));
     return istream;
 }
 
@@ -295,9 +322,13 @@ QDataStream &operator>>(QDataStream &istream, Repository &repository)
 */
 QDataStream &operator<<(QDataStream &ostream, const Repository &repository)
 {
+    QList<QByteArray> mirrors;
+    foreach (const QUrl &mirror, repository.m_mirrors)
+        mirrors.append(mirror.toEncoded().toBase64());
     return ostream << repository.m_url.toEncoded().toBase64() << repository.m_default << repository.m_enabled
         << repository.m_username.toUtf8().toBase64() << repository.m_password.toUtf8().toBase64()
-        << repository.m_displayname.toUtf8().toBase64() << repository.m_categoryname.toUtf8().toBase64();
+        << repository.m_displayname.toUtf8().toBase64() << repository.m_categoryname.toUtf8().toBase64()
+        << mirrors;
 }
 
 }
@@ -31,6 +31,7 @@
 
 #include "installer_global.h"
 
+#include <QtCore/QList>
 #include <QtCore/QMetaType>
 #include <QtCore/QUrl>
 
@@ -52,6 +53,9 @@ public:
     QUrl url() const;
     void setUrl(const QUrl &url);
 
+    QList<QUrl> mirrors() const;
+    void setMirrors(const QList<QUrl> &mirrors);
+
     bool isEnabled() const;
     void setEnabled(bool enabled);
 
@@ -86,6 +90,7 @@ private:
     QString m_displayname;
     QString m_categoryname;
     bool m_compressed;
+    QList<QUrl> m_mirrors;
 };
 
 inline uint qHash(const Repository &repository)
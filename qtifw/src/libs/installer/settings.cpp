@@ -36,6 +36,7 @@
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QStringList>
+#include <QtCore/QThread>
 #include <QtGui/QFontMetrics>
 #include <QtWidgets/QApplication>
 
@@ -159,6 +160,8 @@ static QSet<Repository> readRepositories(QXmlStreamReader &reader, bool isDefaul
             while (reader.readNextStartElement()) {
                 if (reader.name() == QLatin1String("Url")) {
                     repo.setUrl(reader.readElementText());
+                } else if (reader.name() == QLatin1String("Mirror")) {
+                    repo.setMirrors(repo.mirrors() << QUrl(reader.readElementText()));
                 } else if (reader.name() == QLatin1String("Username")) {
                     repo.setUsername(reader.readElementText());
                 } else if (reader.name() == QLatin1String("Password")) {
@@ -304,7 +307,10 @@ Settings Settings::fromFileAndPrefix(const QString &path, const QString &prefix,
                 << scRepositorySettingsPageVisible << scTargetConfigurationFile
                 << scRemoteRepositories << scTranslations << scUrlQueryString << QLatin1String(scControlScript)
                 << scCreateLocalRepository << scInstallActionColumnVisible << scSupportsModify << scAllowUnstableComponents
-                << scSaveDefaultRepositories << scRepositoryCategories;
+                << scSaveDefaultRepositories << scRepositoryCategories << scMaxConcurrentDownloads
+                << scMaxSegmentsPerDownload << scArchiveCacheDirectory << scArchiveCacheSize
+                << scPipelinedInstallation << scMaxConcurrentExtractions << scArchiveDecoderThreads
+                << scDeduplicateFiles;
 
     Settings s;
     s.d->m_data.insert(scPrefix, prefix);
@@ -936,3 +942,58 @@ void Settings::setRepositoryCategoryDisplayName(const QString& name)
 {
     d->m_data.insert(scRepositoryCategoryDisplayName, name);
 }
+
+int Settings::maxConcurrentDownloads() const
+{
+    bool ok = false;
+    const int count = d->m_data.value(scMaxConcurrentDownloads).toInt(&ok);
+    return (ok && count > 0) ? count : 1;
+}
+
+bool Settings::pipelinedInstallation() const
+{
+    return d->m_data.value(scPipelinedInstallation, false).toBool();
+}
+
+int Settings::maxConcurrentExtractions() const
+{
+    bool ok = false;
+    const int count = d->m_data.value(scMaxConcurrentExtractions).toInt(&ok);
+    if (!ok || count < 0)
+        return 1;
+    return count == 0 ? qMax(1, QThread::idealThreadCount()) : count;
+}
+
+void Settings::setMaxConcurrentExtractions(int count)
+{
+    d->m_data.insert(scMaxConcurrentExtractions, count);
+}
+
+int Settings::archiveDecoderThreads() const
+{
+    bool ok = false;
+    const int count = d->m_data.value(scArchiveDecoderThreads).toInt(&ok);
+    return (ok && count >= 0) ? count : 1;
+}
+
+void Settings::setArchiveDecoderThreads(int count)
+{
+    d->m_data.insert(scArchiveDecoderThreads, count);
+}
+
+bool Settings::deduplicateFiles() const
+{
+    return d->m_data.value(scDeduplicateFiles, false).toBool();
+}
+
+void Settings::setDeduplicateFiles(bool deduplicate)
+{
+    d->m_data.insert(scDeduplicateFiles, deduplicate);
+}
+
+int Settings::maxSegmentsPerDownload() const
+{
+    bool ok = false;
+    const int count = d->m_data.value(scMaxSegmentsPerDownload).toInt(&ok);
+    return (ok && count > 0) ? count : 4;
+}
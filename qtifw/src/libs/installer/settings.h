@@ -177,6 +177,19 @@ public:
     QString repositoryCategoryDisplayName() const;
     void setRepositoryCategoryDisplayName(const QString &displayName);
 
+    int maxConcurrentDownloads() const;
+    int maxSegmentsPerDownload() const;
+    bool pipelinedInstallation() const;
+
+    int maxConcurrentExtractions() const;
+    void setMaxConcurrentExtractions(int count);
+
+    int archiveDecoderThreads() const;
+    void setArchiveDecoderThreads(int count);
+
+    bool deduplicateFiles() const;
+    void setDeduplicateFiles(bool deduplicate);
+
 private:
     class Private;
     QSharedDataPointer<Private> d;
@@ -44,7 +44,19 @@ namespace QInstaller {
 
 UninstallerCalculator::UninstallerCalculator(const QList<Component *> &installedComponents)
     : m_installedComponents(installedComponents)
+    , m_dependeesIndexed(false)
 {
+    foreach (Component *component, m_installedComponents) {
+        const QString name = component->name();
+        if (!name.isEmpty() && !m_installedComponentsByName.contains(name))
+            m_installedComponentsByName.insert(name, component);
+
+        const QString replaces = component->value(scReplaces);
+        foreach (const QString &possibleName, replaces.split(QInstaller::commaRegExp(),
+                QString::SkipEmptyParts) << name) {
+            m_installedPossibleNames.insert(possibleName);
+        }
+    }
 }
 
 QSet<Component *> UninstallerCalculator::componentsToUninstall() const
@@ -60,9 +72,8 @@ void UninstallerCalculator::appendComponentToUninstall(Component *component)
     if (!component->isInstalled())
         return;
 
-    PackageManagerCore *core = component->packageManagerCore();
     // remove all already resolved dependees
-    QSet<Component *> dependees = core->dependees(component).toSet()
+    QSet<Component *> dependees = this->dependees(component).toSet()
             .subtract(m_componentsToUninstall);
 
     foreach (Component *dependee, dependees)
@@ -101,18 +112,15 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
                 continue;
             }
 
-            foreach (Component *c, m_installedComponents) {
-                const QString replaces = c->value(scReplaces);
-                const QStringList possibleNames = replaces.split(QInstaller::commaRegExp(),
-                                                                 QString::SkipEmptyParts) << c->name();
-                foreach (const QString &possibleName, possibleNames) {
-
-                    Component *cc = PackageManagerCore::componentByName(possibleName, m_installedComponents);
-                    if (cc && (cc->installAction() != ComponentModelHelper::AutodependUninstallation)) {
-                        autoDependencies.removeAll(possibleName);
+            // Remove the names of installed components, or the ones they replace, that are not
+            // about to be uninstalled as an auto dependency themselves.
+            foreach (const QString &autoDependency, autoDependencies.toSet()) {
+                if (!m_installedPossibleNames.contains(autoDependency))
+                    continue;
 
-                    }
-                }
+                Component *cc = m_installedComponentsByName.value(autoDependency);
+                if (cc && (cc->installAction() != ComponentModelHelper::AutodependUninstallation))
+                    autoDependencies.removeAll(autoDependency);
             }
 
             // A component requested auto uninstallation, keep it to resolve their dependencies as well.
@@ -142,8 +150,7 @@ void UninstallerCalculator::continueAppendComponentsToUninstall()
                 continue;
 
             bool required = false;
-            PackageManagerCore *core = component->packageManagerCore();
-            foreach (Component *dependee, core->dependees(component)) {
+            foreach (Component *dependee, dependees(component)) {
                 if (dependee->isInstalled() && !m_componentsToUninstall.contains(dependee)) {
                     required = true;
                     break;
@@ -158,4 +165,37 @@ void UninstallerCalculator::continueAppendComponentsToUninstall()
         appendComponentsToUninstall(unneededVirtualList);
 }
 
+/*
+    Returns the same components as PackageManagerCore::dependees() for \a component, using an
+    index of the dependencies of all components that is built once per calculation.
+*/
+QList<Component *> UninstallerCalculator::dependees(const Component *component)
+{
+    if (!m_dependeesIndexed) {
+        QString name;
+        QString version;
+        const QList<Component *> availableComponents
+            = component->packageManagerCore()->components(PackageManagerCore::ComponentType::All);
+        foreach (Component *dependee, availableComponents) {
+            foreach (const QString &dependency, dependee->dependencies()) {
+                PackageManagerCore::parseNameAndVersion(dependency, &name, &version);
+                if (!name.isEmpty())
+                    m_dependees[name].append(qMakePair(dependee, version));
+            }
+        }
+        m_dependeesIndexed = true;
+    }
+
+    QList<Component *> result;
+    typedef QPair<Component *, QString> Dependee;
+    foreach (const Dependee &dependee, m_dependees.value(component->name())) {
+        // can be remote or local version
+        if (dependee.second.isEmpty()
+                || PackageManagerCore::versionMatches(component->value(scVersion), dependee.second)) {
+            result.append(dependee.first);
+        }
+    }
+    return result;
+}
+
 } // namespace QInstaller
@@ -32,6 +32,7 @@
 
 #include <QHash>
 #include <QList>
+#include <QPair>
 #include <QSet>
 #include <QString>
 
@@ -52,9 +53,18 @@ private:
 
     void appendComponentToUninstall(Component *component);
     void continueAppendComponentsToUninstall();
+    QList<Component *> dependees(const Component *component);
 
     QList<Component *> m_installedComponents;
     QSet<Component *> m_componentsToUninstall;
+
+    // the first installed component of each name, and all names and replaces of installed ones
+    QHash<QString, Component *> m_installedComponentsByName;
+    QSet<QString> m_installedPossibleNames;
+
+    // dependees with their version requirement by the name they depend on, built on first use
+    bool m_dependeesIndexed;
+    QHash<QString, QList<QPair<Component *, QString> > > m_dependees;
 };
 
 }
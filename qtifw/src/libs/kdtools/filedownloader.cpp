@@ -51,6 +51,22 @@
 #include <QLoggingCategory>
 #include <globals.h>
 #include <QHostInfo>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include <atomic>
+#include <functional>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -60,6 +76,125 @@ static double calcProgress(qint64 done, qint64 total)
     return total ? (double(done) / double(total)) : 0;
 }
 
+// local sources are copied and hashed in large blocks on worker threads
+static const qint64 scLocalCopyBlockSize = 8 * 1024 * 1024;
+static const qint64 scLocalHashBlockSize = 64 * 1024 * 1024;
+
+/*
+    Copies \a source to \a destination, both opened, and stores the number of bytes copied so
+    far in \a copied. On Linux the file is cloned if the file system supports it, otherwise the
+    data is copied by the kernel with copy_file_range() or sendfile(). Whatever could not be
+    copied that way, or everything if the source reports no size like files in /proc do, is
+    read and written in large blocks. Returns \c false and sets \a errorString on failure.
+*/
+static bool copyFileContents(QFile *source, QFile *destination, std::atomic<qint64> *copied,
+    const std::atomic<bool> *canceled, QString *errorString)
+{
+    const qint64 size = source->size();
+    qint64 offset = 0;
+#ifdef Q_OS_LINUX
+    const int in = source->handle();
+    const int out = destination->handle();
+#ifdef FICLONE
+    if (size > 0 && ::ioctl(out, FICLONE, in) == 0) {
+        *copied = size;
+        return true;
+    }
+#endif
+#ifdef SYS_copy_file_range
+    while (offset < size && !*canceled) {
+        loff_t inOffset = offset;
+        loff_t outOffset = offset;
+        const ssize_t count = ::syscall(SYS_copy_file_range, in, &inOffset, out, &outOffset,
+            size_t(qMin(size - offset, scLocalCopyBlockSize)), 0u);
+        if (count <= 0)
+            break;  // not supported for this pair of files, try the next method
+        offset += count;
+        *copied = offset;
+    }
+#endif
+    while (offset < size && !*canceled) {
+        off_t inOffset = offset;
+        if (::lseek(out, offset, SEEK_SET) < 0)
+            break;
+        const ssize_t count = ::sendfile(out, in, &inOffset, size_t(qMin(size - offset,
+            scLocalCopyBlockSize)));
+        if (count <= 0)
+            break;
+        offset += count;
+        *copied = offset;
+    }
+#endif
+    if (*canceled || (size > 0 && offset >= size))
+        return true;
+
+    if (!source->seek(offset) || !destination->seek(offset)) {
+        *errorString = destination->errorString();
+        return false;
+    }
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    while (!*canceled) {
+        const qint64 numRead = source->read(buffer.data(), buffer.size());
+        if (numRead < 0) {
+            *errorString = source->errorString();
+            return false;
+        }
+        if (numRead == 0)
+            break;
+        if (destination->write(buffer.constData(), numRead) != numRead) {
+            *errorString = destination->errorString();
+            return false;
+        }
+        offset += numRead;
+        *copied = offset;
+    }
+    if (!destination->flush()) {
+        *errorString = destination->errorString();
+        return false;
+    }
+    return true;
+}
+
+/*
+    Passes the contents of \a file, which is opened, to \a addData and stores the number of bytes
+    processed so far in \a hashed. The file is mapped into memory in large blocks, files that
+    cannot be mapped, for example compressed resources, or that report no size, are read
+    instead. Returns \c false if the file could not be read completely.
+*/
+static bool hashFileContents(QFile *file, const std::function<void(const char *, int)> &addData,
+    std::atomic<qint64> *hashed, const std::atomic<bool> *canceled)
+{
+    const qint64 size = file->size();
+    qint64 offset = 0;
+    while (offset < size && !*canceled) {
+        const qint64 length = qMin(size - offset, scLocalHashBlockSize);
+        uchar *data = file->map(offset, length);
+        if (!data)
+            break;
+        addData(reinterpret_cast<const char *>(data), int(length));
+        file->unmap(data);
+        offset += length;
+        *hashed = offset;
+    }
+    if (*canceled || (size > 0 && offset >= size))
+        return true;
+
+    if (!file->seek(offset))
+        return false;
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    while (!*canceled) {
+        const qint64 numRead = file->read(buffer.data(), buffer.size());
+        if (numRead < 0)
+            return false;
+        if (numRead == 0)
+            break;
+        addData(buffer.constData(), int(numRead));
+        offset += numRead;
+        *hashed = offset;
+    }
+    return *canceled || offset >= size;
+}
+
 
 // -- KDUpdater::FileDownloader
 
@@ -205,6 +340,8 @@ struct KDUpdater::FileDownloader::Private
         , m_downloadSpeed(0)
         , m_factory(0)
         , m_ignoreSslErrors(false)
+        , m_maxSegments(1)
+        , m_segmentThreshold(32 * 1024 * 1024)
     {
         memset(m_samples, 0, sizeof(m_samples));
     }
@@ -245,6 +382,9 @@ struct KDUpdater::FileDownloader::Private
     QAuthenticator m_authenticator;
     FileDownloaderProxyFactory *m_factory;
     bool m_ignoreSslErrors;
+    QString m_resumeDirectory;
+    int m_maxSegments;
+    qint64 m_segmentThreshold;
 };
 
 /*!
@@ -732,6 +872,63 @@ void KDUpdater::FileDownloader::setIgnoreSslErrors(bool ignore)
     d->m_ignoreSslErrors = ignore;
 }
 
+/*!
+    Returns the directory where partially downloaded files are kept between sessions.
+*/
+QString KDUpdater::FileDownloader::resumeDirectory() const
+{
+    return d->m_resumeDirectory;
+}
+
+/*!
+    Sets the directory where partially downloaded files are kept between sessions to
+    \a directory. If a download is interrupted, for example because the connection dropped or the
+    application was closed, a later download of the same URL continues where the previous one
+    stopped, provided the server still serves the same file. An empty \a directory disables
+    persistent resuming. This might only be of use for HTTP or FTP requests.
+*/
+void KDUpdater::FileDownloader::setResumeDirectory(const QString &directory)
+{
+    d->m_resumeDirectory = directory;
+}
+
+/*!
+    Returns the maximum number of connections used to download a single file.
+*/
+int KDUpdater::FileDownloader::maxSegments() const
+{
+    return d->m_maxSegments;
+}
+
+/*!
+    Sets the maximum number of connections used to download a single file to \a count. Files that
+    are larger than segmentThreshold() are split into \a count byte ranges that are fetched in
+    parallel, if the server announces support for range requests. A value of \c 1 disables
+    segmented downloads. This might only be of use for HTTP requests.
+*/
+void KDUpdater::FileDownloader::setMaxSegments(int count)
+{
+    d->m_maxSegments = qMax(1, count);
+}
+
+/*!
+    Returns the size in bytes from which on a file is downloaded in segments.
+*/
+qint64 KDUpdater::FileDownloader::segmentThreshold() const
+{
+    return d->m_segmentThreshold;
+}
+
+/*!
+    Sets the size in bytes from which on a file is downloaded in segments to \a size.
+
+    \sa setMaxSegments()
+*/
+void KDUpdater::FileDownloader::setSegmentThreshold(qint64 size)
+{
+    d->m_segmentThreshold = size;
+}
+
 // -- KDUpdater::LocalFileDownloader
 
 /*!
@@ -741,10 +938,9 @@ void KDUpdater::FileDownloader::setIgnoreSslErrors(bool ignore)
     file system.
 
     The user of KDUpdater might be simultaneously downloading several files;
-    sometimes in parallel to other file downloaders. If copying a local file takes
-    a long time, it will make the other downloads hang. Therefore, a timer is used
-    and one block of data is copied per unit time, even though QFile::copy() does the
-    task of copying local files from one place to another.
+    sometimes in parallel to other file downloaders. To not block them, the file is
+    copied on a worker thread, by the kernel where possible, while its checksum is
+    computed on a second worker thread. A timer reports the progress.
 */
 
 struct KDUpdater::LocalFileDownloader::Private
@@ -754,6 +950,11 @@ struct KDUpdater::LocalFileDownloader::Private
         , destination(0)
         , downloaded(false)
         , timerId(-1)
+        , size(0)
+        , reported(0)
+        , copied(0)
+        , hashed(0)
+        , canceled(false)
     {}
 
     QFile *source;
@@ -761,6 +962,22 @@ struct KDUpdater::LocalFileDownloader::Private
     QString destFileName;
     bool downloaded;
     int timerId;
+
+    qint64 size;
+    qint64 reported;    // bytes already passed to addSample()
+    QString copyError;
+    QFutureWatcher<bool> copyWatcher;
+    QFutureWatcher<bool> hashWatcher;
+    std::atomic<qint64> copied;
+    std::atomic<qint64> hashed;
+    std::atomic<bool> canceled;
+
+    void waitForWorkers()
+    {
+        canceled = true;
+        copyWatcher.waitForFinished();
+        hashWatcher.waitForFinished();
+    }
 };
 
 /*!
@@ -777,6 +994,7 @@ KDUpdater::LocalFileDownloader::LocalFileDownloader(QObject *parent)
 */
 KDUpdater::LocalFileDownloader::~LocalFileDownloader()
 {
+    d->waitForWorkers();
     if (this->isAutoRemoveDownloadedFile() && !d->destFileName.isEmpty())
         QFile::remove(d->destFileName);
 
@@ -836,12 +1054,81 @@ void KDUpdater::LocalFileDownloader::doDownload()
         return;
     }
 
+    // The checksum is computed from a second handle, so it does not share the read position.
+    QFile *const hashSource = new QFile(localFile);
+    if (!hashSource->open(QFile::ReadOnly)) {
+        setDownloadAborted(tr("Cannot open file \"%1\" for reading: %2").arg(QFileInfo(localFile)
+            .fileName(), hashSource->errorString()));
+        delete hashSource;
+        onError();
+        return;
+    }
+
+    d->size = d->source->size();
+    d->reported = 0;
+    d->copied = 0;
+    d->hashed = 0;
+    d->canceled = false;
+    d->copyError.clear();
+
     runDownloadSpeedTimer();
-    // Start a timer and kickoff the copy process
-    d->timerId = startTimer(0); // as fast as possible
+    // The timer only reports the progress, the work is done by the two workers.
+    d->timerId = startTimer(100);
 
     emit downloadStarted();
     emit downloadProgress(0);
+
+    connect(&d->copyWatcher, &QFutureWatcherBase::finished, this,
+        &LocalFileDownloader::finishDownload, Qt::UniqueConnection);
+    connect(&d->hashWatcher, &QFutureWatcherBase::finished, this,
+        &LocalFileDownloader::finishDownload, Qt::UniqueConnection);
+
+    QFile *const source = d->source;
+    QFile *const destination = d->destination;
+    Private *const p = d;
+    d->copyWatcher.setFuture(QtConcurrent::run([source, destination, p]() {
+        return copyFileContents(source, destination, &p->copied, &p->canceled, &p->copyError);
+    }));
+    d->hashWatcher.setFuture(QtConcurrent::run([this, hashSource, p]() {
+        const bool success = hashFileContents(hashSource, [this](const char *data, int length) {
+            addCheckSumData(data, length);
+        }, &p->hashed, &p->canceled);
+        delete hashSource;
+        return success;
+    }));
+}
+
+/*!
+    \internal
+
+    Completes the download once both the copy and the checksum computation have finished.
+*/
+void KDUpdater::LocalFileDownloader::finishDownload()
+{
+    if (d->timerId < 0 || !d->copyWatcher.isFinished() || !d->hashWatcher.isFinished())
+        return;
+
+    killTimer(d->timerId);
+    d->timerId = -1;
+
+    addSample(d->size - d->reported);
+    d->reported = d->size;
+    if (!d->copyWatcher.result()) {
+        setDownloadAborted(tr("Writing to file \"%1\" failed: %2").arg(
+            QDir::toNativeSeparators(d->destination->fileName()), d->copyError));
+        onError();
+        return;
+    }
+    if (!d->hashWatcher.result()) {
+        setDownloadAborted(tr("Cannot read file \"%1\".").arg(
+            QDir::toNativeSeparators(d->source->fileName())));
+        onError();
+        return;
+    }
+
+    setProgress(d->size, d->size);
+    emit downloadProgress(1);
+    setDownloadCompleted();
 }
 
 /*!
@@ -879,6 +1166,7 @@ void KDUpdater::LocalFileDownloader::cancelDownload()
 
     killTimer(d->timerId);
     d->timerId = -1;
+    d->waitForWorkers();
 
     onError();
     setDownloadCanceled();
@@ -890,41 +1178,13 @@ void KDUpdater::LocalFileDownloader::cancelDownload()
 void KDUpdater::LocalFileDownloader::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == d->timerId) {
-        if (!d->source || !d->destination)
-            return;
-
-        const qint64 blockSize = 32768;
-        QByteArray buffer;
-        buffer.resize(blockSize);
-        const qint64 numRead = d->source->read(buffer.data(), buffer.size());
-        qint64 toWrite = numRead;
-        while (toWrite > 0) {
-            const qint64 numWritten = d->destination->write(buffer.constData() + numRead - toWrite, toWrite);
-            if (numWritten < 0) {
-                killTimer(d->timerId);
-                d->timerId = -1;
-                setDownloadAborted(tr("Writing to file \"%1\" failed: %2").arg(
-                                       QDir::toNativeSeparators(d->destination->fileName()),
-                                       d->destination->errorString()));
-                onError();
-                return;
-            }
-            toWrite -= numWritten;
-        }
-        addSample(numRead);
-        addCheckSumData(buffer.data(), numRead);
-        if (numRead > 0) {
-            setProgress(d->source->pos(), d->source->size());
-            emit downloadProgress(calcProgress(d->source->pos(), d->source->size()));
-            return;
-        }
-
-        d->destination->flush();
-
-        killTimer(d->timerId);
-        d->timerId = -1;
-
-        setDownloadCompleted();
+        // Both the copy and the checksum need to be done, report the slower of the two.
+        const qint64 copied = d->copied;
+        const qint64 done = qMin(copied, qint64(d->hashed));
+        addSample(copied - d->reported);
+        d->reported = copied;
+        setProgress(done, d->size);
+        emit downloadProgress(calcProgress(done, d->size));
     } else if (event->timerId() == downloadSpeedTimerId()) {
         emitDownloadSpeed();
         emitDownloadStatus();
@@ -979,11 +1239,24 @@ struct KDUpdater::ResourceFileDownloader::Private
     Private()
         : timerId(-1)
         , downloaded(false)
+        , hashed(0)
+        , canceled(false)
     {}
 
     int timerId;
     QFile destFile;
     bool downloaded;
+
+    // the checksum is computed on a worker thread, mapping the resource where possible
+    QFutureWatcher<bool> hashWatcher;
+    std::atomic<qint64> hashed;
+    std::atomic<bool> canceled;
+
+    void waitForWorker()
+    {
+        canceled = true;
+        hashWatcher.waitForFinished();
+    }
 };
 
 /*!
@@ -1000,6 +1273,7 @@ KDUpdater::ResourceFileDownloader::ResourceFileDownloader(QObject *parent)
 */
 KDUpdater::ResourceFileDownloader::~ResourceFileDownloader()
 {
+    d->waitForWorker();
     delete d;
 }
 
@@ -1041,8 +1315,53 @@ void KDUpdater::ResourceFileDownloader::doDownload()
     emit downloadStarted();
     emit downloadProgress(0);
 
-    d->destFile.open(QIODevice::ReadOnly);
-    d->timerId = startTimer(0); // start as fast as possible
+    if (!d->destFile.open(QIODevice::ReadOnly)) {
+        emit downloadProgress(1);
+        setDownloadAborted(tr("Cannot read resource file \"%1\": %2").arg(downloadedFileName(),
+            d->destFile.errorString()));
+        onError();
+        return;
+    }
+
+    d->hashed = 0;
+    d->canceled = false;
+    d->timerId = startTimer(100);   // reports the progress only
+
+    connect(&d->hashWatcher, &QFutureWatcherBase::finished, this,
+        &ResourceFileDownloader::finishDownload, Qt::UniqueConnection);
+    QFile *const file = &d->destFile;
+    Private *const p = d;
+    d->hashWatcher.setFuture(QtConcurrent::run([this, file, p]() {
+        return hashFileContents(file, [this](const char *data, int length) {
+            addCheckSumData(data, length);
+        }, &p->hashed, &p->canceled);
+    }));
+}
+
+/*!
+    \internal
+
+    Completes the download once the checksum of the resource has been computed.
+*/
+void KDUpdater::ResourceFileDownloader::finishDownload()
+{
+    if (d->timerId < 0 || !d->hashWatcher.isFinished())
+        return;
+
+    killTimer(d->timerId);
+    d->timerId = -1;
+
+    const qint64 size = d->destFile.size();
+    addSample(size);
+    if (!d->hashWatcher.result()) {
+        setDownloadAborted(tr("Cannot read resource file \"%1\": %2").arg(downloadedFileName(),
+            d->destFile.errorString()));
+        onError();
+        return;
+    }
+    setProgress(size, size);
+    emit downloadProgress(1);
+    setDownloadCompleted();
 }
 
 /*!
@@ -1080,6 +1399,7 @@ void KDUpdater::ResourceFileDownloader::cancelDownload()
 
     killTimer(d->timerId);
     d->timerId = -1;
+    d->waitForWorker();
 
     setDownloadCanceled();
 }
@@ -1090,31 +1410,9 @@ void KDUpdater::ResourceFileDownloader::cancelDownload()
 void KDUpdater::ResourceFileDownloader::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == d->timerId) {
-        if (!d->destFile.isOpen()) {
-            killTimer(d->timerId);
-            emit downloadProgress(1);
-            setDownloadAborted(tr("Cannot read resource file \"%1\": %2").arg(downloadedFileName(),
-                d->destFile.errorString()));
-            onError();
-            return;
-        }
-
-        QByteArray buffer;
-        buffer.resize(32768);
-        const qint64 numRead = d->destFile.read(buffer.data(), buffer.size());
-
-        addSample(numRead);
-        addCheckSumData(buffer.data(), numRead);
-
-        if (numRead > 0) {
-            setProgress(d->destFile.pos(), d->destFile.size());
-            emit downloadProgress(calcProgress(d->destFile.pos(), d->destFile.size()));
-            return;
-        }
-
-        killTimer(d->timerId);
-        d->timerId = -1;
-        setDownloadCompleted();
+        const qint64 hashed = d->hashed;
+        setProgress(hashed, d->destFile.size());
+        emit downloadProgress(calcProgress(hashed, d->destFile.size()));
     } else if (event->timerId() == downloadSpeedTimerId()) {
         emitDownloadSpeed();
         emitDownloadStatus();
@@ -1165,6 +1463,10 @@ struct KDUpdater::HttpDownloader::Private
         , downloaded(false)
         , aborted(false)
         , m_authenticationCount(0)
+        , resumeOffset(0)
+        , rangeChecked(true)
+        , segmentationChecked(true)
+        , hashedBytes(0)
     {}
 
     HttpDownloader *const q;
@@ -1177,8 +1479,70 @@ struct KDUpdater::HttpDownloader::Private
     bool aborted;
     int m_authenticationCount;
 
+    // persistent partial download, moved to destFileName once the download succeeded
+    QString partialFileName;
+    QByteArray eTag;
+    QByteArray lastModified;
+    qint64 resumeOffset;
+    bool rangeChecked;
+    QElapsedTimer stateSaveTimer;
+
+    // segmented download, each segment covers the byte range [begin, end) of the file
+    struct Segment
+    {
+        Segment() : reply(0), begin(0), end(0), pos(0), checked(false) {}
+
+        QNetworkReply *reply;
+        qint64 begin;
+        qint64 end;
+        qint64 pos;
+        bool checked;
+    };
+    QList<Segment> segments;
+    bool segmentationChecked;
+    qint64 hashedBytes;
+
+    QString stateFileName() const
+    {
+        return partialFileName + QLatin1String(".state");
+    }
+
+    // weak entity tags must not be used for range requests
+    QByteArray rangeValidator() const
+    {
+        return (eTag.isEmpty() || eTag.startsWith("W/")) ? lastModified : eTag;
+    }
+
+    bool segmented() const
+    {
+        return !segments.isEmpty();
+    }
+
+    int segmentIndex(QNetworkReply *reply) const
+    {
+        for (int i = 0; i < segments.count(); ++i) {
+            if (segments.at(i).reply == reply)
+                return i;
+        }
+        return -1;
+    }
+
+    void releaseSegmentReply(int index)
+    {
+        QNetworkReply *const reply = segments.at(index).reply;
+        if (!reply)
+            return;
+        QObject::disconnect(reply, 0, q, 0);
+        reply->abort();
+        reply->deleteLater();
+        segments[index].reply = 0;
+    }
+
     void shutDown(bool closeDestination = true)
     {
+        for (int i = 0; i < segments.count(); ++i)
+            releaseSegmentReply(i);
+        segments.clear();
         if (http) {
             disconnect(http, &QNetworkReply::finished, q, &HttpDownloader::httpReqFinished);
             disconnect(http, &QNetworkReply::downloadProgress,
@@ -1288,6 +1652,45 @@ void KDUpdater::HttpDownloader::httpReadyRead()
 {
     if (d->http == 0 || d->destination == 0)
       return;
+
+    // the body of a redirection is of no interest, the redirected request delivers the file
+    if (followRedirects()
+            && d->http->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl().isValid()) {
+        d->http->readAll();
+        return;
+    }
+
+    // the body of an error response is the error page of the server, it must not end up in
+    // the downloaded or partial file
+    if (d->http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400) {
+        d->http->readAll();
+        return;
+    }
+
+    if (!d->rangeChecked) {
+        d->rangeChecked = true;
+        if (d->http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+            // the server ignored the range request or the file changed, start from scratch
+            d->destination->resize(0);
+            d->destination->seek(0);
+            resetCheckSumData();
+            clearBytesDownloadedBeforeResume();
+            d->resumeOffset = 0;
+        }
+    }
+    if (d->http->hasRawHeader("ETag"))
+        d->eTag = d->http->rawHeader("ETag");
+    if (d->http->hasRawHeader("Last-Modified"))
+        d->lastModified = d->http->rawHeader("Last-Modified");
+
+    if (!d->segmentationChecked) {
+        d->segmentationChecked = true;
+        if (startSegmentedDownload()) {
+            readSegment(0);
+            return;
+        }
+    }
+
     static QByteArray buffer(16384, '\0');
     while (d->http->bytesAvailable()) {
         const qint64 read = d->http->read(buffer.data(), buffer.size());
@@ -1322,7 +1725,9 @@ void KDUpdater::HttpDownloader::httpError(QNetworkReply::NetworkError)
 void KDUpdater::HttpDownloader::cancelDownload()
 {
     d->aborted = true;
-    if (d->http) {
+    if (d->segmented()) {
+        failSegmentedDownload(QString());
+    } else if (d->http) {
         d->http->abort();
         httpDone(true);
     }
@@ -1338,6 +1743,13 @@ void KDUpdater::HttpDownloader::httpDone(bool error)
         QString err;
         if (d->http) {
             err = d->http->errorString();
+            // keep what we got so far for the next attempt if the connection broke. If the
+            // server answered with an error status, for example because the file is gone or the
+            // requested range does not make sense for it anymore, the partial file is discarded.
+            if (d->http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() < 400) {
+                savePartialDownloadState();
+                d->partialFileName.clear();
+            }
             d->http->deleteLater();
             d->http = 0;
             onError();
@@ -1364,6 +1776,7 @@ void KDUpdater::HttpDownloader::onError()
     d->destFileName.clear();
     delete d->destination;
     d->destination = 0;
+    removePartialDownload();
     stopDownloadSpeedTimer();
     stopDownloadDeadlineTimer();
 }
@@ -1375,7 +1788,19 @@ void KDUpdater::HttpDownloader::onError()
 void KDUpdater::HttpDownloader::onSuccess()
 {
     d->downloaded = true;
-    if (d->destination) {
+    if (d->destination && !d->partialFileName.isEmpty()) {
+        d->destination->close();
+        QFile::remove(d->stateFileName());
+        QFile::remove(d->destFileName);
+        if (!QFile::rename(d->partialFileName, d->destFileName)) {
+            // the resume directory might be located on another file system
+            if (QFile::copy(d->partialFileName, d->destFileName))
+                QFile::remove(d->partialFileName);
+            else
+                d->destFileName = d->partialFileName;
+        }
+        d->partialFileName.clear();
+    } else if (d->destination) {
         d->destFileName = d->destination->fileName();
         if (QTemporaryFile *file = dynamic_cast<QTemporaryFile *>(d->destination))
             file->setAutoRemove(false);
@@ -1437,12 +1862,12 @@ void KDUpdater::HttpDownloader::httpReadProgress(qint64 done, qint64 total)
         setProgress(done + totalBytesDownloadedBeforeResume(),
                     total + totalBytesDownloadedBeforeResume());
     else
-        setProgress(done, total);
+        setProgress(done + d->resumeOffset, total + d->resumeOffset);
     runDownloadDeadlineTimer();
     if (isDownloadResumed())
         emit downloadProgress(calcProgress(done + totalBytesDownloadedBeforeResume(), total + totalBytesDownloadedBeforeResume()));
     else
-        emit downloadProgress(calcProgress(done, total));
+        emit downloadProgress(calcProgress(done + d->resumeOffset, total + d->resumeOffset));
 }
 
 /*!
@@ -1455,7 +1880,19 @@ void KDUpdater::HttpDownloader::timerEvent(QTimerEvent *event)
         emitDownloadStatus();
         emitDownloadProgress();
         emitEstimatedDownloadTime();
+        if (d->stateSaveTimer.isValid() && d->stateSaveTimer.elapsed() > 1000) {
+            savePartialDownloadState();
+            d->stateSaveTimer.restart();
+        }
     } else if (event->timerId() == downloadDeadlineTimerId()) {
+        if (d->segmented()) {
+            for (int i = 0; i < d->segments.count(); ++i) {
+                if (d->segments.at(i).reply)
+                    requestSegment(i);
+            }
+            runDownloadDeadlineTimer();
+            return;
+        }
         d->shutDown(false);
         resumeDownload();
     }
@@ -1467,18 +1904,27 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
     d->m_authenticationCount = 0;
     d->manager.setProxyFactory(proxyFactory());
     clearBytesDownloadedBeforeResume();
-    d->http = d->manager.get(QNetworkRequest(url));
-    connect(d->http, &QIODevice::readyRead, this, &HttpDownloader::httpReadyRead);
-    connect(d->http, &QNetworkReply::downloadProgress,
-            this, &HttpDownloader::httpReadProgress);
-    connect(d->http, &QNetworkReply::finished, this, &HttpDownloader::httpReqFinished);
-    void (QNetworkReply::*errorSignal)(QNetworkReply::NetworkError) = &QNetworkReply::error;
-    connect(d->http, errorSignal, this, &HttpDownloader::httpError);
+    d->resumeOffset = 0;
+    d->rangeChecked = true;
+    d->segmentationChecked = false;
+    d->partialFileName.clear();
+    d->stateSaveTimer.invalidate();
 
+    QNetworkRequest request(url);
     if (d->destFileName.isEmpty()) {
         QTemporaryFile *file = new QTemporaryFile(this);
         file->open();
         d->destination = file;
+    } else if (!resumeDirectory().isEmpty() && QDir().mkpath(resumeDirectory())) {
+        // name the partial file after the originally requested url, so that it is found again
+        // if the download gets redirected
+        d->partialFileName = QString::fromLatin1("%1/%2.part").arg(resumeDirectory(),
+            QString::fromLatin1(QCryptographicHash::hash(this->url().toString().toUtf8(),
+            QCryptographicHash::Sha1).toHex()));
+        d->destination = new QFile(d->partialFileName, this);
+        if (d->destination->open(QIODevice::ReadWrite))
+            restorePartialDownload(&request);
+        d->stateSaveTimer.start();
     } else {
         d->destination = new QFile(d->destFileName, this);
         d->destination->open(QIODevice::ReadWrite | QIODevice::Truncate);
@@ -1487,9 +1933,319 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
     if (!d->destination->isOpen()) {
         const QString error = d->destination->errorString();
         const QString fileName = d->destination->fileName();
+        d->partialFileName.clear();
         d->shutDown();
         setDownloadAborted(tr("Cannot download %1. Cannot create file \"%2\": %3").arg(
             url.toString(), fileName, error));
+        return;
+    }
+
+    d->http = d->manager.get(request);
+    connect(d->http, &QIODevice::readyRead, this, &HttpDownloader::httpReadyRead);
+    connect(d->http, &QNetworkReply::downloadProgress,
+            this, &HttpDownloader::httpReadProgress);
+    connect(d->http, &QNetworkReply::finished, this, &HttpDownloader::httpReqFinished);
+    void (QNetworkReply::*errorSignal)(QNetworkReply::NetworkError) = &QNetworkReply::error;
+    connect(d->http, errorSignal, this, &HttpDownloader::httpError);
+}
+
+/*!
+    Continues a download that was interrupted in an earlier session. Reads the state stored next
+    to the partial file, truncates the partial file to the last known good size and adds the
+    \c Range and \c If-Range headers to \a request. Since the state of the cryptographic hash
+    cannot be persisted, the hash is seeded again from the data already on disk.
+*/
+void KDUpdater::HttpDownloader::restorePartialDownload(QNetworkRequest *request)
+{
+    QSettings state(d->stateFileName(), QSettings::IniFormat);
+    d->eTag = state.value(QLatin1String("ETag")).toByteArray();
+    d->lastModified = state.value(QLatin1String("LastModified")).toByteArray();
+
+    qint64 offset = 0;
+    if (state.value(QLatin1String("Url")).toString() == url().toString()
+            && !d->rangeValidator().isEmpty()) {
+        offset = qMin(state.value(QLatin1String("Size")).toLongLong(), d->destination->size());
+    }
+    if (offset <= 0 || !d->destination->resize(offset)) {
+        d->destination->resize(0);
+        offset = 0;
+    }
+
+    resetCheckSumData();
+    d->destination->seek(0);
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    while (d->destination->pos() < offset) {
+        const qint64 read = d->destination->read(buffer.data(), buffer.size());
+        if (read <= 0) {
+            // the partial file is not readable anymore, start from scratch
+            d->destination->resize(0);
+            resetCheckSumData();
+            offset = 0;
+            break;
+        }
+        addCheckSumData(buffer.constData(), read);
+    }
+    d->destination->seek(offset);
+
+    if (offset > 0) {
+        qCDebug(QInstaller::lcServer) << "Resuming download of" << url().toString()
+            << "at" << offset << "bytes.";
+        request->setRawHeader("Range", QByteArray("bytes=") + QByteArray::number(offset) + '-');
+        request->setRawHeader("If-Range", d->rangeValidator());
+        updateBytesDownloadedBeforeResume(offset);
+        d->resumeOffset = offset;
+        d->rangeChecked = false;
+    }
+}
+
+/*!
+    Writes the state of the partial download next to the partial file, so that a later session
+    can continue the download. Without a validator from the server it is not possible to know
+    whether the file changed in between, so no state is written in that case.
+*/
+void KDUpdater::HttpDownloader::savePartialDownloadState()
+{
+    if (d->partialFileName.isEmpty() || !d->destination)
+        return;
+
+    if (d->rangeValidator().isEmpty()) {
+        QFile::remove(d->stateFileName());
+        return;
+    }
+
+    d->destination->flush();
+    QSettings state(d->stateFileName(), QSettings::IniFormat);
+    state.setValue(QLatin1String("Url"), url().toString());
+    state.setValue(QLatin1String("ETag"), d->eTag);
+    state.setValue(QLatin1String("LastModified"), d->lastModified);
+    // only the contiguous prefix of a segmented download can be continued
+    state.setValue(QLatin1String("Size"), d->segmented() ? d->hashedBytes : d->destination->size());
+    state.sync();
+}
+
+/*!
+    Removes the partial file of the current download together with its state.
+*/
+void KDUpdater::HttpDownloader::removePartialDownload()
+{
+    if (d->partialFileName.isEmpty())
+        return;
+
+    QFile::remove(d->stateFileName());
+    QFile::remove(d->partialFileName);
+    d->partialFileName.clear();
+}
+
+/*!
+    Splits the running download into byte ranges that are fetched over separate connections, if
+    the file is larger than segmentThreshold() and the server announced support for range requests.
+    The running request continues as the first segment. Returns \c true if the download has been
+    split.
+*/
+bool KDUpdater::HttpDownloader::startSegmentedDownload()
+{
+    if (maxSegments() < 2 || d->resumeOffset > 0 || isDownloadResumed() || d->http->isFinished())
+        return false;
+    if (d->http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return false;
+    if (d->http->rawHeader("Accept-Ranges").trimmed().toLower() != "bytes")
+        return false;
+    // the content length refers to the encoded data otherwise
+    const QByteArray encoding = d->http->rawHeader("Content-Encoding").trimmed().toLower();
+    if (!encoding.isEmpty() && encoding != "identity")
+        return false;
+    // without a validator it cannot be ensured that all segments belong to the same file
+    if (d->rangeValidator().isEmpty())
+        return false;
+
+    const qint64 total = d->http->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (total < segmentThreshold() || total < maxSegments())
+        return false;
+    if (!d->destination->resize(total))
+        return false;
+
+    const int count = maxSegments();
+    for (int i = 0; i < count; ++i) {
+        Private::Segment segment;
+        segment.begin = total * i / count;
+        segment.end = total * (i + 1) / count;
+        segment.pos = segment.begin;
+        d->segments.append(segment);
+    }
+    d->hashedBytes = 0;
+
+    // the running request delivers the first segment and gets aborted once it reached its end
+    disconnect(d->http, 0, this, 0);
+    d->segments[0].reply = d->http;
+    d->segments[0].checked = true;
+    connect(d->http, &QIODevice::readyRead, this, &HttpDownloader::segmentReadyRead);
+    connect(d->http, &QNetworkReply::finished, this, &HttpDownloader::segmentFinished);
+    d->http = 0;
+
+    for (int i = 1; i < count; ++i)
+        requestSegment(i);
+
+    qCDebug(QInstaller::lcServer) << "Downloading" << url().toString() << "in" << count
+        << "segments.";
+    return true;
+}
+
+/*!
+    Requests the missing part of the segment at \a index. A request that is still running for the
+    segment is aborted.
+*/
+void KDUpdater::HttpDownloader::requestSegment(int index)
+{
+    d->releaseSegmentReply(index);
+
+    Private::Segment &segment = d->segments[index];
+    QNetworkRequest request(d->sourceUrl);
+    request.setRawHeader("Range", QByteArray("bytes=") + QByteArray::number(segment.pos) + '-'
+        + QByteArray::number(segment.end - 1));
+    request.setRawHeader("If-Range", d->rangeValidator());
+
+    segment.checked = false;
+    segment.reply = d->manager.get(request);
+    connect(segment.reply, &QIODevice::readyRead, this, &HttpDownloader::segmentReadyRead);
+    connect(segment.reply, &QNetworkReply::finished, this, &HttpDownloader::segmentFinished);
+}
+
+/*!
+    Writes the data received for the segment at \a index to its position in the destination file.
+    Completes the download once all segments have been received.
+*/
+void KDUpdater::HttpDownloader::readSegment(int index)
+{
+    Private::Segment &segment = d->segments[index];
+    QNetworkReply *const reply = segment.reply;
+    if (!reply)
+        return;
+
+    if (!segment.checked) {
+        segment.checked = true;
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const QByteArray contentRange = reply->rawHeader("Content-Range");
+        const bool valid = (status == 206 && contentRange.startsWith(QByteArray("bytes ")
+            + QByteArray::number(segment.pos) + '-')) || (status == 200 && segment.pos == 0);
+        if (!valid) {
+            failSegmentedDownload(tr("Cannot download %1. The server did not respect the "
+                "requested byte range.").arg(url().toString()));
+            return;
+        }
+    }
+
+    static QByteArray buffer(16384, '\0');
+    while (reply->bytesAvailable() && segment.pos < segment.end) {
+        const qint64 read = reply->read(buffer.data(), qMin<qint64>(buffer.size(),
+            segment.end - segment.pos));
+        if (read <= 0)
+            break;
+        if (!d->destination->seek(segment.pos)
+                || d->destination->write(buffer.constData(), read) != read) {
+            failSegmentedDownload(tr("Cannot download %1. Writing to file \"%2\" failed: %3")
+                .arg(url().toString(), d->destination->fileName(), d->destination->errorString()));
+            return;
+        }
+        if (segment.pos == d->hashedBytes) {
+            addCheckSumData(buffer.constData(), read);
+            d->hashedBytes += read;
+        }
+        segment.pos += read;
+        addSample(read);
+    }
+    // the first segment is served by a request for the whole file
+    if (segment.pos == segment.end)
+        d->releaseSegmentReply(index);
+
+    hashSegments();
+
+    qint64 done = 0;
+    foreach (const Private::Segment &each, d->segments)
+        done += each.pos - each.begin;
+    const qint64 total = d->segments.last().end;
+    setProgress(done, total);
+    emit downloadProgress(calcProgress(done, total));
+    runDownloadDeadlineTimer();
+
+    if (d->hashedBytes == total) {
+        d->segments.clear();
+        d->destination->flush();
+        setDownloadCompleted();
+    }
+}
+
+/*!
+    Feeds the data of completed segments to the checksum, in file order. Segments that arrive
+    early are read back from the destination file once all preceding data is available.
+*/
+void KDUpdater::HttpDownloader::hashSegments()
+{
+    static QByteArray buffer(16384, '\0');
+    foreach (const Private::Segment &segment, d->segments) {
+        if (segment.end <= d->hashedBytes)
+            continue;
+        if (segment.pos <= d->hashedBytes)
+            break;
+
+        d->destination->flush();
+        if (!d->destination->seek(d->hashedBytes))
+            return;
+        while (d->hashedBytes < segment.pos) {
+            const qint64 read = d->destination->read(buffer.data(), qMin<qint64>(buffer.size(),
+                segment.pos - d->hashedBytes));
+            if (read <= 0)
+                return;
+            addCheckSumData(buffer.constData(), read);
+            d->hashedBytes += read;
+        }
+        if (segment.pos < segment.end)
+            break;
+    }
+}
+
+/*!
+    Aborts all requests of a segmented download and reports \a error, or the cancellation if the
+    download was canceled. The contiguous data received so far is kept for resuming later.
+*/
+void KDUpdater::HttpDownloader::failSegmentedDownload(const QString &error)
+{
+    for (int i = 0; i < d->segments.count(); ++i)
+        d->releaseSegmentReply(i);
+    savePartialDownloadState();
+    d->segments.clear();
+    d->partialFileName.clear();
+    onError();
+
+    if (d->aborted) {
+        d->aborted = false;
+        setDownloadCanceled();
+    } else {
+        setDownloadAborted(error);
+    }
+}
+
+void KDUpdater::HttpDownloader::segmentReadyRead()
+{
+    const int index = d->segmentIndex(qobject_cast<QNetworkReply *>(sender()));
+    if (index >= 0)
+        readSegment(index);
+}
+
+void KDUpdater::HttpDownloader::segmentFinished()
+{
+    QNetworkReply *const reply = qobject_cast<QNetworkReply *>(sender());
+    const int index = d->segmentIndex(reply);
+    if (index < 0)
+        return;
+
+    if (reply->error() != QNetworkReply::NoError) {
+        failSegmentedDownload(reply->errorString());
+        return;
+    }
+    readSegment(index);
+    if (d->segmentIndex(reply) >= 0) {
+        failSegmentedDownload(tr("Cannot download %1. The connection was closed before all data "
+            "was received.").arg(url().toString()));
     }
 }
 
@@ -87,6 +87,15 @@ public:
     bool ignoreSslErrors();
     void setIgnoreSslErrors(bool ignore);
 
+    QString resumeDirectory() const;
+    void setResumeDirectory(const QString &directory);
+
+    int maxSegments() const;
+    void setMaxSegments(int count);
+
+    qint64 segmentThreshold() const;
+    void setSegmentThreshold(qint64 size);
+
 public Q_SLOTS:
     virtual void cancelDownload();
 
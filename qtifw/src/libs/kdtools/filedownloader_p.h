@@ -63,6 +63,9 @@ protected:
 private Q_SLOTS:
     void doDownload();
 
+private:
+    void finishDownload();
+
 private:
     struct Private;
     Private *d;
@@ -93,6 +96,9 @@ protected:
 private Q_SLOTS:
     void doDownload();
 
+private:
+    void finishDownload();
+
 private:
     struct Private;
     Private *d;
@@ -128,6 +134,8 @@ private Q_SLOTS:
     void httpError(QNetworkReply::NetworkError);
     void httpDone(bool error);
     void httpReqFinished();
+    void segmentReadyRead();
+    void segmentFinished();
     void onAuthenticationRequired(QNetworkReply *reply, QAuthenticator *authenticator);
     void onNetworkAccessibleChanged(QNetworkAccessManager::NetworkAccessibility accessible);
 #ifndef QT_NO_SSL
@@ -136,6 +144,14 @@ private Q_SLOTS:
 private:
     void startDownload(const QUrl &url);
     void resumeDownload();
+    void restorePartialDownload(QNetworkRequest *request);
+    void savePartialDownloadState();
+    void removePartialDownload();
+    bool startSegmentedDownload();
+    void requestSegment(int index);
+    void readSegment(int index);
+    void hashSegments();
+    void failSegmentedDownload(const QString &error);
 
 private:
     struct Private;
@@ -151,9 +151,29 @@ bool UpdatesInfoData::parsePackageUpdateElement(const QDomElement &updateE)
                 info.data[QLatin1String("Description")] = childE.text();
             QString languageAttribute = childE.attribute(QLatin1String("xml:lang"), QLatin1String("en"));
             localizedDescriptions.insert(languageAttribute.toLower(), childE.text());
+        } else if (childE.tagName() == QLatin1String("ArchiveChecksums")) {
+            QHash<QString, QVariant> archiveHash;
+            const QDomNodeList archiveNodes = childE.childNodes();
+            for (int i = 0; i < archiveNodes.count(); ++i) {
+                const QDomElement element = archiveNodes.at(i).toElement();
+                if (element.tagName() != QLatin1String("Archive"))
+                    continue;
+                QVariantMap attributes;
+                attributes.insert(QLatin1String("size"), element.attribute(QLatin1String("size")));
+                attributes.insert(QLatin1String("sha1"), element.attribute(QLatin1String("sha1")));
+                archiveHash.insert(element.attribute(QLatin1String("name")), attributes);
+            }
+            if (!archiveHash.isEmpty())
+                info.data.insert(QLatin1String("ArchiveChecksums"), archiveHash);
         } else if (childE.tagName() == QLatin1String("UpdateFile")) {
             info.data[QLatin1String("CompressedSize")] = childE.attribute(QLatin1String("CompressedSize"));
             info.data[QLatin1String("UncompressedSize")] = childE.attribute(QLatin1String("UncompressedSize"));
+        } else if (childE.tagName() == QLatin1String("Script")) {
+            info.data[childE.tagName()] = childE.text();
+            if (childE.attribute(QLatin1String("postLoad")).compare(QLatin1String("true"),
+                    Qt::CaseInsensitive) == 0) {
+                info.data.insert(QLatin1String("PostLoadScript"), true);
+            }
         } else if (childE.tagName() == QLatin1String("Operations")) {
             const QDomNodeList operationNodes = childE.childNodes();
             QVariant operationListVariant = parseOperations(childE.childNodes());
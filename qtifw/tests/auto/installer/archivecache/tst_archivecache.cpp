@@ -0,0 +1,169 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <archivecache.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_ArchiveCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray createFile(const QString &fileName, const QByteArray &content)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return QByteArray();
+        file.write(content);
+        return QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+    }
+
+    void setLastUsed(const QString &fileName, const QDateTime &time)
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::Append));
+        QVERIFY(file.setFileTime(time, QFileDevice::FileModificationTime));
+    }
+
+private slots:
+    void testInsertAndLookup()
+    {
+        QTemporaryDir dir;
+        ArchiveCache cache(dir.path() + QLatin1String("/cache"));
+        QVERIFY(cache.isValid());
+
+        const QByteArray sha1 = createFile(dir.path() + QLatin1String("/archive.7z"), "content");
+        QVERIFY(cache.lookup(sha1).isEmpty());
+
+        QVERIFY(cache.insert(sha1, dir.path() + QLatin1String("/archive.7z")));
+        const QString cached = cache.lookup(sha1);
+        QVERIFY(!cached.isEmpty());
+
+        QFile file(cached);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), QByteArray("content"));
+    }
+
+    void testFetchSurvivesEviction()
+    {
+        QTemporaryDir dir;
+        const QString cacheDir = dir.path() + QLatin1String("/cache");
+        ArchiveCache cache(cacheDir);
+        const QByteArray sha1 = createFile(dir.path() + QLatin1String("/archive.7z"), "content");
+        const QString target = dir.path() + QLatin1String("/fetched.7z");
+        QVERIFY(!cache.fetch(sha1, target));
+        QVERIFY(!QFile::exists(target));
+
+        QVERIFY(cache.insert(sha1, dir.path() + QLatin1String("/archive.7z")));
+        QVERIFY(cache.fetch(sha1, target));
+
+        // another process evicts the archive while it is used
+        QVERIFY(QFile::remove(cacheDir + QLatin1Char('/') + QString::fromLatin1(sha1)));
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), QByteArray("content"));
+    }
+
+    void testFetchDamagedArchive()
+    {
+        QTemporaryDir dir;
+        ArchiveCache cache(dir.path() + QLatin1String("/cache"));
+        const QByteArray sha1 = createFile(dir.path() + QLatin1String("/archive.7z"), "content");
+        QVERIFY(cache.insert(sha1, dir.path() + QLatin1String("/archive.7z")));
+
+        const QString cached = dir.path() + QLatin1String("/cache/") + QString::fromLatin1(sha1);
+        createFile(cached, "damaged");
+        const QString target = dir.path() + QLatin1String("/fetched.7z");
+        QVERIFY(!cache.fetch(sha1, target));
+        QVERIFY(!QFile::exists(target));
+        QVERIFY(!QFile::exists(cached));
+    }
+
+    void testInvalidChecksum()
+    {
+        QTemporaryDir dir;
+        ArchiveCache cache(dir.path());
+        const QString source = dir.path() + QLatin1String("/archive.7z");
+        createFile(source, "content");
+
+        // checksums are used as file names and must not point elsewhere
+        QVERIFY(!cache.insert("../archive.7z", source));
+        QVERIFY(cache.lookup("../archive.7z").isEmpty());
+    }
+
+    void testDamagedArchive()
+    {
+        QTemporaryDir dir;
+        ArchiveCache cache(dir.path() + QLatin1String("/cache"));
+        const QByteArray sha1 = createFile(dir.path() + QLatin1String("/archive.7z"), "content");
+        QVERIFY(cache.insert(sha1, dir.path() + QLatin1String("/archive.7z")));
+
+        createFile(dir.path() + QLatin1String("/cache/") + QString::fromLatin1(sha1), "damaged");
+        QVERIFY(cache.lookup(sha1).isEmpty());
+        QVERIFY(!QFile::exists(dir.path() + QLatin1String("/cache/") + QString::fromLatin1(sha1)));
+    }
+
+    void testLeastRecentlyUsedEviction()
+    {
+        QTemporaryDir dir;
+        const QString cacheDir = dir.path() + QLatin1String("/cache");
+        ArchiveCache cache(cacheDir, 20);
+
+        const QByteArray first = createFile(dir.path() + QLatin1String("/first"), "0123456789");
+        const QByteArray second = createFile(dir.path() + QLatin1String("/second"), "abcdefghij");
+        const QByteArray third = createFile(dir.path() + QLatin1String("/third"), "ABCDEFGHIJ");
+
+        QVERIFY(cache.insert(first, dir.path() + QLatin1String("/first")));
+        QVERIFY(cache.insert(second, dir.path() + QLatin1String("/second")));
+        setLastUsed(cacheDir + QLatin1Char('/') + QString::fromLatin1(first),
+            QDateTime::currentDateTimeUtc().addSecs(-60));
+        setLastUsed(cacheDir + QLatin1Char('/') + QString::fromLatin1(second),
+            QDateTime::currentDateTimeUtc().addSecs(-120));
+
+        // using the first archive makes the second one the least recently used
+        QVERIFY(!cache.lookup(first).isEmpty());
+        QVERIFY(cache.insert(third, dir.path() + QLatin1String("/third")));
+
+        QVERIFY(!cache.lookup(first).isEmpty());
+        QVERIFY(cache.lookup(second).isEmpty());
+        QVERIFY(!cache.lookup(third).isEmpty());
+    }
+};
+
+QTEST_MAIN(tst_ArchiveCache)
+
+#include "tst_archivecache.moc"
@@ -289,6 +289,35 @@ private slots:
                             << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt" << "installcontentI.txt");
     }
 
+    void testInstallWithConcurrentExtractions()
+    {
+        PackageManagerCore *core = PackageManager::getPackageManagerWithInit
+                (m_installDir, ":///data/installPackagesRepository");
+        core->settings().setMaxConcurrentExtractions(4);
+        QCOMPARE(PackageManagerCore::Success, core->installSelectedComponentsSilently(QStringList()
+                << QLatin1String("componentC")));
+        QCOMPARE(PackageManagerCore::Success, core->status());
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentA", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentB", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentC", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentD", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentE", "1.0.0content.txt");
+        VerifyInstaller::verifyInstallerResources(m_installDir, "componentG", "1.0.0content.txt");
+        VerifyInstaller::verifyFileExistence(m_installDir, QStringList() << "components.xml" << "installcontentC.txt"
+                            << "installcontent.txt" << "installcontentA.txt" << "installcontentB.txt"
+                            << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt" << "installcontentI.txt");
+
+        // the extractions are undone like sequential ones
+        core->commitSessionOperations();
+        core->setPackageManager();
+        QCOMPARE(PackageManagerCore::Success, core->uninstallComponentsSilently(QStringList()
+                << QLatin1String("componentC")));
+        VerifyInstaller::verifyInstallerResourcesDeletion(m_installDir, "componentC");
+        VerifyInstaller::verifyFileExistence(m_installDir, QStringList() << "components.xml"
+                            << "installcontent.txt" << "installcontentA.txt" << "installcontentB.txt"
+                            << "installcontentD.txt"<< "installcontentE.txt" << "installcontentG.txt");
+    }
+
     void testUninstallWithDependencySilently()
     {
         PackageManagerCore *core = PackageManager::getPackageManagerWithInit
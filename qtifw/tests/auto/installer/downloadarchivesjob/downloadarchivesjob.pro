@@ -0,0 +1,9 @@
+include(../../qttest.pri)
+
+QT += network
+
+SOURCES += tst_downloadarchivesjob.cpp
+
+RESOURCES += \
+    settings.qrc \
+    ..\shared\config.qrc
@@ -0,0 +1,173 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "../shared/localhttpserver.h"
+#include "../shared/packagemanager.h"
+
+#include <component.h>
+#include <downloadarchivesjob.h>
+#include <fileutils.h>
+#include <messageboxhandler.h>
+#include <packagemanagercore.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTest>
+#include <QUrl>
+
+using namespace QInstaller;
+
+typedef QList<QPair<QString, QString> > ArchiveList;
+
+class tst_DownloadArchivesJob : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Serves one archive per component of the repository and returns the archives to download.
+    ArchiveList addArchives(LocalHttpServer *server)
+    {
+        ArchiveList archives;
+        foreach (const QString &name, QStringList() << "A" << "B" << "C" << "D") {
+            const Component *component = m_core->componentByName(name);
+            foreach (const QString &archive, component->downloadableArchives()) {
+                const QByteArray path = QString(name + QLatin1Char('/') + archive).toLatin1();
+                server->addFile(path, archiveContent(name));
+                archives.append(qMakePair(QString::fromLatin1("installer://%1/%2").arg(name, archive),
+                    server->url(path)));
+            }
+        }
+        return archives;
+    }
+
+    QByteArray archiveContent(const QString &name) const
+    {
+        return name.toLatin1().repeated(256 * 1024);
+    }
+
+    int requestCount(const LocalHttpServer &server, const QString &url) const
+    {
+        int count = 0;
+        foreach (const LocalHttpServer::Request &request, server.requests())
+            count += (request.path == QUrl(url).path().toLatin1());
+        return count;
+    }
+
+private slots:
+    void init()
+    {
+        m_installDir = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(m_installDir));
+        m_core = PackageManager::getPackageManagerWithInit(m_installDir, ":///data/repository");
+        QVERIFY(m_core->fetchRemotePackagesTree());
+    }
+
+    void cleanup()
+    {
+        delete m_core;
+        QDir dir(m_installDir);
+        QVERIFY(dir.removeRecursively());
+    }
+
+    void downloadConcurrentlyWithRetry()
+    {
+        LocalHttpServer server;
+        QVERIFY(server.start());
+        const ArchiveList archives = addArchives(&server);
+        QCOMPARE(archives.count(), 4);
+
+        // B fails once and is downloaded again after the retry prompt, the others download
+        // next to it
+        const QString failing = archives.at(1).second;
+        server.failNextRequests(QUrl(failing).path().mid(1).toLatin1(), 1);
+        MessageBoxHandler::instance()->setAutomaticAnswer(QLatin1String("archiveDownloadError"),
+            QMessageBox::Retry);
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        job.setMaxConcurrentDownloads(3);
+        job.start();
+        job.waitForFinished();
+
+        QCOMPARE(job.error(), int(Job::NoError));
+        QCOMPARE(job.numberOfDownloads(), archives.count());
+        QCOMPARE(requestCount(server, failing), 2);
+        QVERIFY(server.maxOpenConnections() > 1);
+        QVERIFY(server.maxOpenConnections() <= 3);
+
+        foreach (const ArchiveList::value_type &archive, archives) {
+            QVERIFY(job.isArchiveRegistered(archive.first));
+            const QString name = QFileInfo(QFileInfo(archive.first).path()).fileName();
+            const Component *component = m_core->componentByName(name);
+            QFile file(component->localTempPath() + QLatin1Char('/') + name + QLatin1Char('/')
+                + QFileInfo(archive.first).fileName());
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.readAll(), archiveContent(name));
+        }
+    }
+
+    void cancelAfterFailedDownloads()
+    {
+        LocalHttpServer server;
+        QVERIFY(server.start());
+        const ArchiveList archives = addArchives(&server);
+
+        // B and D fail while other archives are downloaded, the first prompt cancels the job
+        server.failNextRequests(QUrl(archives.at(1).second).path().mid(1).toLatin1(), 10);
+        server.failNextRequests(QUrl(archives.at(3).second).path().mid(1).toLatin1(), 10);
+        MessageBoxHandler::instance()->setAutomaticAnswer(QLatin1String("archiveDownloadError"),
+            QMessageBox::Cancel);
+
+        DownloadArchivesJob job(m_core);
+        job.setAutoDelete(false);
+        job.setArchivesToDownload(archives);
+        job.setMaxConcurrentDownloads(4);
+        job.start();
+        job.waitForFinished();
+
+        QCOMPARE(job.error(), int(Job::Canceled));
+        QVERIFY(job.isFinished());
+        QVERIFY(!job.isArchiveRegistered(archives.at(1).first));
+        QVERIFY(!job.isArchiveRegistered(archives.at(3).first));
+        // nothing is retried after the job got canceled
+        QVERIFY(requestCount(server, archives.at(1).second) <= 1);
+        QVERIFY(requestCount(server, archives.at(3).second) <= 1);
+    }
+
+private:
+    QString m_installDir;
+    PackageManagerCore *m_core;
+};
+
+QTEST_MAIN(tst_DownloadArchivesJob)
+
+#include "tst_downloadarchivesjob.moc"
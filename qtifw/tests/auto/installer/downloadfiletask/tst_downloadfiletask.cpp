@@ -0,0 +1,139 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "../shared/localhttpserver.h"
+
+#include <downloadfiletask.h>
+
+#include <QFile>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_DownloadFileTask : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<FileTaskItem> addFiles(LocalHttpServer &server, const QString &targetDir, int count,
+        int size)
+    {
+        QList<FileTaskItem> items;
+        for (int i = 0; i < count; ++i) {
+            const QByteArray path = "files/" + QByteArray::number(i);
+            server.addFile(path, QByteArray(size, char('a' + i % 26)));
+            items.append(FileTaskItem(server.url(path),
+                targetDir + QLatin1Char('/') + QString::number(i)));
+        }
+        return items;
+    }
+
+    QList<FileTaskResult> runTask(DownloadFileTask &task)
+    {
+        // The task spins its own event loop, so the server keeps working in this thread.
+        QFutureInterface<FileTaskResult> fi;
+        task.doTask(fi);
+        return fi.future().results();
+    }
+
+private slots:
+    void testRequestsPerHost()
+    {
+        LocalHttpServer server;
+        QVERIFY(server.start());
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+
+        const int count = 100;
+        DownloadFileTask task(addFiles(server, targetDir.path(), count, 1024));
+        task.setMaxRequestsPerHost(2);
+
+        QList<int> progress;
+        QFutureInterface<FileTaskResult> fi;
+        QFutureWatcher<FileTaskResult> watcher;
+        connect(&watcher, &QFutureWatcherBase::progressValueChanged, [&progress](int value) {
+            progress.append(value);
+        });
+        watcher.setFuture(fi.future());
+        task.doTask(fi);
+        const QList<FileTaskResult> results = fi.future().results();
+
+        QCOMPARE(results.count(), count);
+        QCOMPARE(server.requests().count(), count);
+        QVERIFY(server.maxOpenConnections() <= 2);
+        foreach (const FileTaskResult &result, results) {
+            QFile file(result.target());
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            QCOMPARE(file.size(), qint64(1024));
+            QVERIFY(!result.checksumMismatch());
+        }
+        foreach (int value, progress)
+            QVERIFY(value >= 0 && value <= 100);
+    }
+
+    void testEmptyTask()
+    {
+        DownloadFileTask task;
+        QVERIFY(runTask(task).isEmpty());
+    }
+
+    void benchmarkManySmallFiles_data()
+    {
+        QTest::addColumn<int>("maxRequestsPerHost");
+        QTest::newRow("1 request per host") << 1;
+        QTest::newRow("default") << int(DownloadFileTask::DefaultMaxRequestsPerHost);
+        QTest::newRow("16 requests per host") << 16;
+    }
+
+    void benchmarkManySmallFiles()
+    {
+        QFETCH(int, maxRequestsPerHost);
+
+        LocalHttpServer server;
+        QVERIFY(server.start());
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+
+        const int count = 2000;
+        const QList<FileTaskItem> items = addFiles(server, targetDir.path(), count, 512);
+
+        QBENCHMARK {
+            DownloadFileTask task(items);
+            task.setMaxRequestsPerHost(maxRequestsPerHost);
+            QCOMPARE(runTask(task).count(), count);
+        }
+    }
+};
+
+QTEST_MAIN(tst_DownloadFileTask)
+
+#include "tst_downloadfiletask.moc"
@@ -30,9 +30,11 @@
 
 #include "init.h"
 #include "extractarchiveoperation.h"
+#include "lib7z_facade.h"
 
 #include <QDir>
 #include <QObject>
+#include <QTemporaryDir>
 #include <QTest>
 
 using namespace KDUpdater;
@@ -88,6 +90,36 @@ private slots:
                                            "Cannot open archive \":///data/invalid.7z\"."));
     }
 
+    void testExtractListedArchive()
+    {
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/valid.7z" << targetDir.path());
+
+        // the archive stays open for the extraction
+        const QVector<Lib7z::File> files = op.archiveContents();
+        QCOMPARE(files.count(), 1);
+        QCOMPARE(files.first().path, QString("valid"));
+        QVERIFY(!files.first().isDirectory);
+
+        QVERIFY(op.performOperation());
+        QCOMPARE(QFileInfo(targetDir.path() + "/valid").size(), qint64(5242880));
+        QVERIFY(op.undoOperation());
+        QVERIFY(!QFileInfo::exists(targetDir.path() + "/valid"));
+    }
+
+    void testListInvalidArchive()
+    {
+        ExtractArchiveOperation op(nullptr);
+        op.setArguments(QStringList() << ":///data/invalid.7z" << QDir::tempPath());
+
+        QVERIFY_EXCEPTION_THROWN(op.archiveContents(), Lib7z::SevenZipException);
+        QVERIFY(!op.performOperation());
+        QCOMPARE(op.errorString(), QString("Error while extracting archive \":///data/invalid.7z\": "
+                                           "Cannot open archive \":///data/invalid.7z\"."));
+    }
+
     void testExtractArchiveFromXML()
     {
         m_testDirectory = QInstaller::generateTemporaryFileName();
@@ -0,0 +1,159 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <filemanifest.h>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QObject>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_filemanifest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip()
+    {
+        const QStringList paths = QStringList() << "/opt/app/bin/tool" << "/opt/app/bin"
+            << "/opt/app/lib/libfoo.so.1" << "/opt/app/bin/other" << "/top" << "relative"
+            << QString::fromUtf8("C:\\Program Files\\\xc3\xa4pp\\file.txt") << QString();
+
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        FileManifestWriter writer(&buffer);
+        for (int i = 0; i < paths.count(); ++i)
+            writer.add(paths.at(i), i % 2 ? i * 1000 : -1, i % 3 ? QByteArray() : QByteArray(20, char(i)));
+        QVERIFY(writer.finish());
+        buffer.close();
+        QVERIFY(buffer.data().startsWith("IFWM"));
+
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        FileManifestReader reader(&buffer);
+        QVERIFY(!reader.isLegacyFormat());
+        for (int i = 0; i < paths.count(); ++i) {
+            QVERIFY(reader.readNext());
+            QCOMPARE(reader.path(), paths.at(i));
+            QCOMPARE(reader.size(), i % 2 ? qint64(i * 1000) : qint64(-1));
+            QCOMPARE(reader.hash(), i % 3 ? QByteArray() : QByteArray(20, char(i)));
+        }
+        QVERIFY(!reader.readNext());
+        QVERIFY(!reader.hasError());
+        QCOMPARE(reader.progress(), 1.0);
+    }
+
+    void testPathReplacement()
+    {
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        FileManifestWriter writer(&buffer);
+        writer.add("@RELOCATABLE_PATH@/dir/file");
+        writer.add("@RELOCATABLE_PATH@/dir");
+        writer.add("@RELOCATABLE_PATH@");
+        writer.add("/elsewhere/file");
+        QVERIFY(writer.finish());
+        buffer.close();
+
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QCOMPARE(FileManifestReader::readAll(&buffer, "@RELOCATABLE_PATH@", "/new/target"),
+            QStringList() << "/new/target/dir/file" << "/new/target/dir" << "/new/target"
+            << "/elsewhere/file");
+    }
+
+    void testLegacyFormat()
+    {
+        const QStringList paths = QStringList() << "@RELOCATABLE_PATH@/a.txt" << "/other/b.txt";
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        QDataStream out(&buffer);
+        out << paths;
+        buffer.close();
+
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        FileManifestReader reader(&buffer);
+        QVERIFY(reader.isLegacyFormat());
+        reader.setPathReplacement("@RELOCATABLE_PATH@", "/target");
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.path(), QString("/target/a.txt"));
+        QCOMPARE(reader.size(), qint64(-1));
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.path(), QString("/other/b.txt"));
+        QVERIFY(!reader.readNext());
+        QVERIFY(!reader.hasError());
+    }
+
+    void testTruncatedManifest()
+    {
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        FileManifestWriter writer(&buffer);
+        writer.add("/dir/first");
+        writer.add("/dir/second");
+        QVERIFY(writer.finish());
+        buffer.close();
+        buffer.buffer().chop(3);
+
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        FileManifestReader reader(&buffer);
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.path(), QString("/dir/first"));
+        QVERIFY(!reader.readNext());
+        QVERIFY(reader.hasError());
+    }
+
+    void testLargeManifest()
+    {
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        FileManifestWriter writer(&buffer);
+        for (int i = 0; i < 100000; ++i)
+            writer.add(QString::fromLatin1("/install/dir%1/file%2.txt").arg(i % 50).arg(i));
+        QVERIFY(writer.finish());
+        buffer.close();
+
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        FileManifestReader reader(&buffer);
+        int count = 0;
+        while (reader.readNext()) {
+            if (reader.path() != QString::fromLatin1("/install/dir%1/file%2.txt").arg(count % 50)
+                    .arg(count)) {
+                QFAIL(qPrintable(reader.path()));
+            }
+            ++count;
+        }
+        QVERIFY(!reader.hasError());
+        QCOMPARE(count, 100000);
+    }
+};
+
+QTEST_MAIN(tst_filemanifest)
+
+#include "tst_filemanifest.moc"
@@ -0,0 +1,139 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <fileremover.h>
+#include <fileutils.h>
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_fileremover : public QObject
+{
+    Q_OBJECT
+
+private:
+    void createFile(const QString &path)
+    {
+        QVERIFY(QDir().mkpath(QFileInfo(path).absolutePath()));
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(file.write("content") > 0);
+    }
+
+private slots:
+    void testRemoveFiles()
+    {
+        QTemporaryDir temp;
+        QVERIFY(temp.isValid());
+        const QString dir = temp.path() + QLatin1String("/dir");
+        createFile(dir + QLatin1String("/a.txt"));
+        createFile(dir + QLatin1String("/keep.txt"));
+        createFile(dir + QLatin1String("/sub/b.txt"));
+        createFile(dir + QLatin1String("/sub/deeper/c.txt"));
+
+        // listed like an uninstall would do it, files before their directories
+        FileRemover remover;
+        remover.removeFiles(QStringList() << dir + QLatin1String("/sub/deeper/c.txt")
+            << dir + QLatin1String("/sub/deeper") << dir + QLatin1String("/sub/b.txt")
+            << dir + QLatin1String("/sub") << QDir::toNativeSeparators(dir + QLatin1String("/a.txt"))
+            << dir << dir + QLatin1String("/missing.txt"));
+        QCOMPARE(remover.removedCount(), 3);
+        QVERIFY(QDir(dir + QLatin1String("/sub")).exists());
+
+        remover.removeDirectories();
+        QVERIFY(!QDir(dir + QLatin1String("/sub")).exists());
+        QVERIFY(QFile::exists(dir + QLatin1String("/keep.txt")));
+        QVERIFY(!QFile::exists(dir + QLatin1String("/a.txt")));
+        QVERIFY(remover.failedFiles().isEmpty());
+        QVERIFY(remover.errors().isEmpty());
+    }
+
+    void testRemoveDirectory()
+    {
+        QTemporaryDir temp;
+        QVERIFY(temp.isValid());
+        const QString dir = temp.path() + QLatin1String("/dir");
+        const QString outside = temp.path() + QLatin1String("/outside");
+        createFile(dir + QLatin1String("/.hidden"));
+        createFile(dir + QLatin1String("/one/two/three/file.txt"));
+        createFile(dir + QLatin1String("/one/other.txt"));
+        QVERIFY(QDir().mkpath(dir + QLatin1String("/empty")));
+        createFile(outside + QLatin1String("/target.txt"));
+#ifndef Q_OS_WIN
+        QVERIFY(QFile::link(outside, dir + QLatin1String("/one/link")));
+#endif
+
+        FileRemover remover;
+        remover.removeDirectory(dir);
+        QVERIFY2(remover.errors().isEmpty(), qPrintable(remover.errors().join(QLatin1Char('\n'))));
+        QVERIFY(!QFileInfo::exists(dir));
+        QVERIFY(QFile::exists(outside + QLatin1String("/target.txt")));
+    }
+
+    void testRemoveDirectoryThreaded()
+    {
+        QTemporaryDir temp;
+        QVERIFY(temp.isValid());
+        const QString dir = temp.path() + QLatin1String("/dir");
+        for (int i = 0; i < 1000; ++i)
+            createFile(dir + QString::fromLatin1("/dir%1/file%2").arg(i % 7).arg(i));
+
+        removeDirectoryThreaded(dir);
+        QVERIFY(!QFileInfo::exists(dir));
+    }
+
+    void testProgress()
+    {
+        QTemporaryDir temp;
+        QVERIFY(temp.isValid());
+        QStringList files;
+        for (int i = 0; i < 2000; ++i) {
+            files.append(temp.path() + QString::fromLatin1("/dir%1/file%2").arg(i % 3).arg(i));
+            createFile(files.last());
+        }
+
+        FileRemover remover;
+        remover.setProgressInterval(1);
+        QSignalSpy spy(&remover, &FileRemover::progressChanged);
+        remover.removeFiles(files);
+        QVERIFY(spy.count() > 0);
+        QCOMPARE(spy.last().at(0).toInt(), 2000);
+        QVERIFY(!spy.last().at(1).toString().isEmpty());
+    }
+};
+
+QTEST_MAIN(tst_fileremover)
+
+#include "tst_fileremover.moc"
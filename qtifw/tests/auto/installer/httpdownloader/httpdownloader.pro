@@ -0,0 +1,5 @@
+include(../../qttest.pri)
+
+QT += network
+
+SOURCES += tst_httpdownloader.cpp
@@ -0,0 +1,264 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "../shared/localhttpserver.h"
+
+#include <filedownloader.h>
+#include <filedownloaderfactory.h>
+
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDUpdater;
+
+class tst_HttpDownloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    FileDownloader *createDownloader(const QString &url, const QString &fileName,
+        const QString &resumeDirectory)
+    {
+        FileDownloader *downloader = FileDownloaderFactory::instance().create(QLatin1String("http"));
+        downloader->setUrl(QUrl(url));
+        downloader->setDownloadedFileName(fileName);
+        downloader->setAutoRemoveDownloadedFile(false);
+        downloader->setResumeDirectory(resumeDirectory);
+        return downloader;
+    }
+
+    QByteArray fileContent(int size)
+    {
+        QByteArray content;
+        content.reserve(size);
+        for (int i = 0; i < size; ++i)
+            content.append(char(i % 251));
+        return content;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_server.start());
+    }
+
+    void init()
+    {
+        m_server.clearRequests();
+        m_server.setAcceptRanges(true);
+        m_server.setDropConnectionAfter(-1);
+        m_server.setErrorBody(QByteArray());
+    }
+
+    void testResumeAfterRestart()
+    {
+        const QByteArray content = fileContent(512 * 1024);
+        m_server.addFile("archive.7z", content);
+
+        QTemporaryDir targetDir;
+        QTemporaryDir resumeDir;
+        const QString target = targetDir.path() + QLatin1String("/archive.7z");
+
+        // first session: the connection breaks in the middle of the transfer
+        m_server.setDropConnectionAfter(200 * 1024);
+        {
+            QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("archive.7z"),
+                target, resumeDir.path()));
+            QSignalSpy aborted(downloader.data(), &FileDownloader::downloadAborted);
+            downloader->download();
+            QTRY_COMPARE_WITH_TIMEOUT(aborted.count(), 1, 10000);
+        }
+        QVERIFY(!QFile::exists(target));
+        QCOMPARE(QDir(resumeDir.path()).entryList(QStringList() << QLatin1String("*.part"),
+            QDir::Files).count(), 1);
+
+        // second session: a fresh downloader continues where the first one stopped
+        m_server.clearRequests();
+        QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("archive.7z"),
+            target, resumeDir.path()));
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        QCOMPARE(m_server.requests().count(), 1);
+        const QByteArray range = m_server.requests().first().headers.value("range");
+        QVERIFY(range.startsWith("bytes="));
+        QVERIFY(range.mid(6).toLongLong() > 0);
+        QCOMPARE(m_server.requests().first().headers.value("if-range"),
+            LocalHttpServer::eTag(content));
+
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+        QVERIFY(QDir(resumeDir.path()).entryList(QDir::Files).isEmpty());
+    }
+
+    void testErrorResponseDiscardsPartialDownload()
+    {
+        const QByteArray content = fileContent(256 * 1024);
+        m_server.addFile("unavailable.7z", content);
+        m_server.setErrorBody("<html><body>Service Unavailable</body></html>");
+
+        QTemporaryDir targetDir;
+        QTemporaryDir resumeDir;
+        const QString target = targetDir.path() + QLatin1String("/unavailable.7z");
+
+        m_server.setDropConnectionAfter(100 * 1024);
+        {
+            QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("unavailable.7z"),
+                target, resumeDir.path()));
+            QSignalSpy aborted(downloader.data(), &FileDownloader::downloadAborted);
+            downloader->download();
+            QTRY_COMPARE_WITH_TIMEOUT(aborted.count(), 1, 10000);
+        }
+        QCOMPARE(QDir(resumeDir.path()).entryList(QStringList() << QLatin1String("*.part"),
+            QDir::Files).count(), 1);
+
+        // the error page must neither end up in the partial download nor be resumed later
+        m_server.failNextRequests("unavailable.7z", 1);
+        {
+            QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("unavailable.7z"),
+                target, resumeDir.path()));
+            QSignalSpy aborted(downloader.data(), &FileDownloader::downloadAborted);
+            downloader->download();
+            QTRY_COMPARE_WITH_TIMEOUT(aborted.count(), 1, 10000);
+        }
+        QVERIFY(!QFile::exists(target));
+        QVERIFY(QDir(resumeDir.path()).entryList(QDir::Files).isEmpty());
+
+        m_server.clearRequests();
+        QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("unavailable.7z"),
+            target, resumeDir.path()));
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        QCOMPARE(m_server.requests().count(), 1);
+        QVERIFY(!m_server.requests().first().headers.contains("range"));
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+
+    void testSegmentedDownload()
+    {
+        const QByteArray content = fileContent(3 * 1024 * 1024 + 17);
+        m_server.addFile("segmented.7z", content);
+
+        QTemporaryDir targetDir;
+        const QString target = targetDir.path() + QLatin1String("/segmented.7z");
+        QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("segmented.7z"),
+            target, QString()));
+        downloader->setMaxSegments(4);
+        downloader->setSegmentThreshold(1024 * 1024);
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        int rangeRequests = 0;
+        foreach (const LocalHttpServer::Request &request, m_server.requests()) {
+            if (request.headers.contains("range"))
+                ++rangeRequests;
+        }
+        QCOMPARE(rangeRequests, 3);
+
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+
+    void testSegmentedDownloadWithoutRangeSupport()
+    {
+        const QByteArray content = fileContent(2 * 1024 * 1024);
+        m_server.addFile("single.7z", content);
+        m_server.setAcceptRanges(false);
+
+        QTemporaryDir targetDir;
+        const QString target = targetDir.path() + QLatin1String("/single.7z");
+        QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("single.7z"),
+            target, QString()));
+        downloader->setMaxSegments(4);
+        downloader->setSegmentThreshold(1024 * 1024);
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        QCOMPARE(m_server.requests().count(), 1);
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+
+    void testRestartWithoutRangeSupport()
+    {
+        const QByteArray content = fileContent(256 * 1024);
+        m_server.addFile("norange.7z", content);
+
+        QTemporaryDir targetDir;
+        QTemporaryDir resumeDir;
+        const QString target = targetDir.path() + QLatin1String("/norange.7z");
+
+        m_server.setDropConnectionAfter(100 * 1024);
+        {
+            QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("norange.7z"),
+                target, resumeDir.path()));
+            QSignalSpy aborted(downloader.data(), &FileDownloader::downloadAborted);
+            downloader->download();
+            QTRY_COMPARE_WITH_TIMEOUT(aborted.count(), 1, 10000);
+        }
+
+        // the server answers the range request with the full file
+        m_server.setAcceptRanges(false);
+        QScopedPointer<FileDownloader> downloader(createDownloader(m_server.url("norange.7z"),
+            target, resumeDir.path()));
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+
+private:
+    LocalHttpServer m_server;
+};
+
+QTEST_MAIN(tst_HttpDownloader)
+
+#include "tst_httpdownloader.moc"
@@ -11,6 +11,8 @@ SUBDIRS += \
     extractarchiveoperationtest \
     lib7zfacade \
     fileutils \
+    filemanifest \
+    fileremover \
     unicodeexecutable \
     scriptengine \
     consumeoutputoperationtest \
@@ -39,7 +41,13 @@ SUBDIRS += \
     globalsettingsoperation \
     elevatedexecuteoperation \
     treename \
-    createoffline
+    createoffline \
+    httpdownloader \
+    localfiledownloader \
+    archivecache \
+    downloadfiletask \
+    downloadarchivesjob \
+    mirrorselector
 
 win32 {
     SUBDIRS += registerfiletypeoperation \
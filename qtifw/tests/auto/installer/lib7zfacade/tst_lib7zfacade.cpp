@@ -26,15 +26,25 @@
 **
 **************************************************************************/
 
+#include <lib7z_archive.h>
 #include <lib7z_create.h>
 #include <lib7z_extract.h>
 #include <lib7z_facade.h>
 #include <lib7z_list.h>
 
+#include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
+#include <QThread>
+
+Q_DECLARE_METATYPE(Lib7z::Compression)
+Q_DECLARE_METATYPE(Lib7z::Method)
 
 class tst_lib7zfacade : public QObject
 {
@@ -138,6 +148,48 @@ private slots:
 
     }
 
+    void testCreateArchiveHash()
+    {
+        try {
+            const QString path = tempSourceFile("Source File 1.");
+            const QByteArray prefix("data in front of the archive");
+
+            QTemporaryFile target;
+            QVERIFY(target.open());
+            target.write(prefix);
+
+            QCryptographicHash hash(QCryptographicHash::Sha1);
+            Lib7z::createArchive(&target, QStringList() << path, Lib7z::Compression::Normal,
+                Lib7z::Method::Lzma2, 0, &hash);
+            QCOMPARE(target.pos(), target.size());
+
+            QVERIFY(target.seek(0));
+            const QByteArray written = target.readAll();
+            QVERIFY(written.startsWith(prefix));
+            const QByteArray archive = written.mid(prefix.size());
+            QVERIFY(archive.startsWith(QByteArray::fromHex("377ABCAF271C")));
+            QCOMPARE(hash.result(), QCryptographicHash::hash(archive, QCryptographicHash::Sha1));
+
+            // a write-only device is read back through its file name
+            QTemporaryFile tmp;
+            QVERIFY(tmp.open());
+            QFile writeOnly(tmp.fileName());
+            QVERIFY(writeOnly.open(QIODevice::WriteOnly));
+            QCryptographicHash hash2(QCryptographicHash::Sha256);
+            Lib7z::createArchive(&writeOnly, QStringList() << path, Lib7z::Compression::Normal,
+                Lib7z::Method::Lzma2, 0, &hash2);
+            writeOnly.close();
+            QCOMPARE(Lib7z::listArchive(&tmp).count(), 1);
+            QVERIFY(tmp.seek(0));
+            QCOMPARE(hash2.result(), QCryptographicHash::hash(tmp.readAll(),
+                QCryptographicHash::Sha256));
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during create archive.");
+        }
+    }
+
     void testExtractArchive()
     {
         QFile source(":///data/valid.7z");
@@ -153,6 +205,447 @@ private slots:
         }
     }
 
+    void testArchiveHandle()
+    {
+        QFile source(":///data/valid.7z");
+        QVERIFY(source.open(QIODevice::ReadOnly));
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+
+        try {
+            // list and extract without opening the archive again
+            Lib7z::ArchiveHandle handle(&source);
+            const QVector<Lib7z::File> files = handle.files();
+            QCOMPARE(files.count(), 1);
+            QCOMPARE(files.first(), m_file);
+
+            handle.extract(targetDir.path());
+            QCOMPARE(QFileInfo(targetDir.path() + QLatin1Char('/') + files.first().path).size(),
+                qint64(m_file.uncompressedSize));
+            QCOMPARE(handle.files(), files);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error while using the archive handle.");
+        }
+    }
+
+    void testExtractArchiveConcurrently_data()
+    {
+        QTest::addColumn<int>("threads");
+        QTest::newRow("one thread") << 1;
+        QTest::newRow("four threads") << 4;
+        QTest::newRow("one per core") << 0;
+    }
+
+    void testExtractArchiveConcurrently()
+    {
+        QFETCH(int, threads);
+
+        // without compression every file ends up in its own folder
+        QTemporaryDir sourceDir;
+        QVERIFY(sourceDir.isValid());
+        QHash<QString, QByteArray> contents;
+        for (int i = 0; i < 8; ++i) {
+            const QString name = QString::fromLatin1("sub%1/file%2.txt").arg(i % 3).arg(i);
+            contents.insert(name, QByteArray::number(i).repeated((i + 1) * 4096));
+            writeFile(sourceDir.path() + QLatin1Char('/') + name, contents.value(name));
+        }
+
+        QTemporaryDir archiveDir;
+        QVERIFY(archiveDir.isValid());
+        const QString archivePath = archiveDir.path() + QLatin1String("/folders.7z");
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        try {
+            Lib7z::createArchive(archivePath, QStringList() << sourceDir.path() + QLatin1String("/*"),
+                Lib7z::TmpFile::No, Lib7z::Compression::Non);
+
+            QFile archive(archivePath);
+            QVERIFY(archive.open(QIODevice::ReadOnly));
+            Lib7z::extractArchive(&archive, targetDir.path(), nullptr, threads);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        }
+
+        for (auto it = contents.constBegin(); it != contents.constEnd(); ++it) {
+            QFile file(targetDir.path() + QLatin1Char('/') + it.key());
+            QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.fileName()));
+            QCOMPARE(file.readAll(), it.value());
+        }
+    }
+
+    void testExtractZstdFrames()
+    {
+        if (!Lib7z::isSupportedMethod(Lib7z::Method::Zstd))
+            QSKIP("Zstandard support is not built, see IFW_ZSTD.");
+
+        // written by another Zstandard encoder: several frames without content size, with a
+        // skippable frame after the first one
+        QFile archive(":///data/zstd-frames.7z");
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        Lib7z::extractArchive(&archive, targetDir.path());
+
+        QByteArray expected;
+        for (int i = 1; i <= 20000; ++i)
+            expected += "line " + QByteArray::number(i) + '\n';
+        QFile frames(targetDir.path() + QLatin1String("/frames.txt"));
+        QVERIFY(frames.open(QIODevice::ReadOnly));
+        QCOMPARE(frames.readAll(), expected);
+        QCOMPARE(QFileInfo(targetDir.path() + QLatin1String("/empty.txt")).size(), qint64(0));
+    }
+
+    void benchmarkExtractArchiveConcurrently_data()
+    {
+        QTest::addColumn<int>("threads");
+        for (int threads = 1; threads < QThread::idealThreadCount(); threads *= 2)
+            QTest::newRow(qPrintable(QString::fromLatin1("%1 threads").arg(threads))) << threads;
+        QTest::newRow("one per core") << 0;
+    }
+
+    void benchmarkExtractArchiveConcurrently()
+    {
+        // Set IFW_LIB7Z_BENCHMARK_SIZE to the size of the archive contents in MiB, for example
+        // 1024, to run the benchmark. The archive is created once with fast compression, which
+        // uses a small solid block size and therefore produces many folders.
+        const int size = qEnvironmentVariableIntValue("IFW_LIB7Z_BENCHMARK_SIZE");
+        if (size <= 0)
+            QSKIP("Set IFW_LIB7Z_BENCHMARK_SIZE to run the benchmark.");
+
+        QFETCH(int, threads);
+        if (m_benchmarkArchive.isEmpty())
+            QVERIFY(createBenchmarkArchive(size));
+
+        QFile archive(m_benchmarkArchive);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QBENCHMARK {
+            QTemporaryDir targetDir(m_benchmarkDir.path() + QLatin1String("/extract-XXXXXX"));
+            QVERIFY(targetDir.isValid());
+            QVERIFY(archive.seek(0));
+            Lib7z::extractArchive(&archive, targetDir.path(), nullptr, threads);
+        }
+    }
+
+    void testExtractNestedFiles()
+    {
+        // many small files in nested directories, and one file larger than the write buffer
+        QTemporaryDir sourceDir;
+        QVERIFY(sourceDir.isValid());
+        QHash<QString, QByteArray> contents;
+        QRandomGenerator generator(7);
+        for (int i = 0; i < 200; ++i) {
+            const QString name = QString::fromLatin1("dir%1/sub%2/file%3.txt").arg(i % 10)
+                .arg(i % 3).arg(i);
+            contents.insert(name, QByteArray::number(generator.generate64())
+                .repeated(int(generator.bounded(1, 400))));
+        }
+        contents.insert(QLatin1String("dir0/large.bin"), QByteArray(3 * 1024 * 1024 + 17, 'x'));
+        for (auto it = contents.constBegin(); it != contents.constEnd(); ++it)
+            writeFile(sourceDir.path() + QLatin1Char('/') + it.key(), it.value());
+
+        QTemporaryDir archiveDir;
+        QVERIFY(archiveDir.isValid());
+        const QString archiveName = archiveDir.path() + QLatin1String("/nested.7z");
+        Lib7z::createArchive(archiveName, QStringList() << sourceDir.path() + QLatin1String("/*"),
+            Lib7z::TmpFile::No);
+
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        QFile archive(archiveName);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        Lib7z::extractArchive(&archive, targetDir.path());
+
+        for (auto it = contents.constBegin(); it != contents.constEnd(); ++it) {
+            QFile file(targetDir.path() + QLatin1Char('/') + it.key());
+            QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.fileName()));
+            QCOMPARE(file.size(), qint64(it.value().size()));
+            QCOMPARE(file.readAll(), it.value());
+        }
+    }
+
+    void testExtractSymlinks()
+    {
+#ifdef Q_OS_WIN
+        QSKIP("Extracting symlinks is not supported on Windows.");
+#else
+        QTemporaryDir sourceDir;
+        QVERIFY(sourceDir.isValid());
+        writeFile(sourceDir.path() + QLatin1String("/lib/libfoo.so.1.2"), "library");
+        QVERIFY(QFile::link(QLatin1String("libfoo.so.1.2"), sourceDir.path()
+            + QLatin1String("/lib/libfoo.so.1")));
+        QVERIFY(QFile::link(QLatin1String("lib"), sourceDir.path() + QLatin1String("/lib64")));
+        QVERIFY(QFile::link(QLatin1String("missing"), sourceDir.path()
+            + QLatin1String("/dangling")));
+
+        QTemporaryDir archiveDir;
+        QVERIFY(archiveDir.isValid());
+        const QString archiveName = archiveDir.path() + QLatin1String("/links.7z");
+        Lib7z::createArchive(archiveName, QStringList() << sourceDir.path() + QLatin1String("/*"),
+            Lib7z::TmpFile::No);
+
+        // existing files and links are replaced
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        writeFile(targetDir.path() + QLatin1String("/lib/libfoo.so.1"), "old content");
+        QVERIFY(QFile::link(QLatin1String("elsewhere"), targetDir.path()
+            + QLatin1String("/dangling")));
+
+        QFile archive(archiveName);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        Lib7z::extractArchive(&archive, targetDir.path());
+
+        const QString target = targetDir.path();
+        QVERIFY(QFileInfo(target + QLatin1String("/lib/libfoo.so.1")).isSymLink());
+        QCOMPARE(QFile::symLinkTarget(target + QLatin1String("/lib/libfoo.so.1")),
+            target + QLatin1String("/lib/libfoo.so.1.2"));
+        QVERIFY(QFileInfo(target + QLatin1String("/lib64")).isSymLink());
+        QVERIFY(QFileInfo(target + QLatin1String("/lib64/libfoo.so.1.2")).isFile());
+        QVERIFY(QFileInfo(target + QLatin1String("/dangling")).isSymLink());
+        QCOMPARE(QFile::symLinkTarget(target + QLatin1String("/dangling")),
+            target + QLatin1String("/missing"));
+#endif
+    }
+
+    void testExtractDeduplicated()
+    {
+        QTemporaryDir sourceDir;
+        QVERIFY(sourceDir.isValid());
+        QByteArray content;
+        for (int i = 0; i < 2000; ++i)
+            content += QByteArray::number(i) + ' ';
+        writeFile(sourceDir.path() + QLatin1String("/plugins/libplugin.so"), content);
+        writeFile(sourceDir.path() + QLatin1String("/small.txt"), "small file");
+
+        QTemporaryDir archiveDir;
+        QVERIFY(archiveDir.isValid());
+        const QString archiveName = archiveDir.path() + QLatin1String("/dedup.7z");
+        Lib7z::createArchive(archiveName, QStringList() << sourceDir.path() + QLatin1String("/*"),
+            Lib7z::TmpFile::No);
+
+        const auto extract = [&](const QString &target) {
+            QFile archive(archiveName);
+            QVERIFY(archive.open(QIODevice::ReadOnly));
+            Lib7z::ExtractCallback *callback = new Lib7z::ExtractCallback;
+            callback->setDeduplicateFiles(true);
+            Lib7z::extractArchive(&archive, target, callback);
+        };
+        const auto readFile = [](const QString &fileName) {
+            QFile file(fileName);
+            return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+        };
+
+        QTemporaryDir first;
+        QTemporaryDir second;
+        QTemporaryDir third;
+        QVERIFY(first.isValid() && second.isValid() && third.isValid());
+        extract(first.path());
+        extract(second.path());
+        QCOMPARE(readFile(second.path() + QLatin1String("/plugins/libplugin.so")), content);
+        QCOMPARE(readFile(second.path() + QLatin1String("/small.txt")), QByteArray("small file"));
+
+        // changing a deduplicated file in place leaves the other one intact
+        QFile duplicate(second.path() + QLatin1String("/plugins/libplugin.so"));
+        QVERIFY(duplicate.open(QIODevice::ReadWrite));
+        duplicate.write("XXXX");
+        duplicate.close();
+        QCOMPARE(readFile(first.path() + QLatin1String("/plugins/libplugin.so")), content);
+
+        // removing a deduplicated file leaves the other one intact
+        QVERIFY(QFile::remove(second.path() + QLatin1String("/plugins/libplugin.so")));
+        QCOMPARE(readFile(first.path() + QLatin1String("/plugins/libplugin.so")), content);
+
+        // a candidate that was changed since is not used
+        QFile changed(first.path() + QLatin1String("/plugins/libplugin.so"));
+        QVERIFY(changed.open(QIODevice::ReadWrite));
+        QVERIFY(changed.seek(content.size() - 4));
+        changed.write("XXXX");
+        changed.close();
+        extract(third.path());
+        QCOMPARE(readFile(third.path() + QLatin1String("/plugins/libplugin.so")), content);
+    }
+
+    void benchmarkExtractSmallFiles()
+    {
+        // Set IFW_LIB7Z_BENCHMARK_FILES to the number of files, for example 10000, to run the
+        // benchmark. The files are between 1 and 4 KiB in size and spread over 100 directories.
+        const int count = qEnvironmentVariableIntValue("IFW_LIB7Z_BENCHMARK_FILES");
+        if (count <= 0)
+            QSKIP("Set IFW_LIB7Z_BENCHMARK_FILES to run the benchmark.");
+
+        QVERIFY(m_benchmarkDir.isValid());
+        const QString sourceDir = m_benchmarkDir.path() + QLatin1String("/small");
+        QRandomGenerator generator(42);
+        for (int i = 0; i < count; ++i) {
+            writeFile(QString::fromLatin1("%1/dir%2/file%3.txt").arg(sourceDir).arg(i % 100).arg(i),
+                QByteArray::number(generator.generate64(), 36).repeated(
+                int(generator.bounded(1024, 4096)) / 13));
+        }
+
+        const QString archiveName = m_benchmarkDir.path() + QLatin1String("/small.7z");
+        Lib7z::createArchive(archiveName, QStringList() << sourceDir + QLatin1String("/*"),
+            Lib7z::TmpFile::No, Lib7z::Compression::Fastest);
+
+        QFile archive(archiveName);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QElapsedTimer timer;
+        int runs = 0;
+        timer.start();
+        QBENCHMARK {
+            QTemporaryDir targetDir(m_benchmarkDir.path() + QLatin1String("/extract-XXXXXX"));
+            QVERIFY(targetDir.isValid());
+            QVERIFY(archive.seek(0));
+            Lib7z::extractArchive(&archive, targetDir.path());
+            ++runs;
+        }
+        qInfo("%.0f files/s", double(count) * runs * 1000 / qMax<qint64>(1, timer.elapsed()));
+    }
+
+    void testZstdRoundTrip_data()
+    {
+        QTest::addColumn<Lib7z::Compression>("level");
+        QTest::newRow("fastest") << Lib7z::Compression::Fastest;
+        QTest::newRow("normal") << Lib7z::Compression::Normal;
+        QTest::newRow("ultra") << Lib7z::Compression::Ultra;
+    }
+
+    void testZstdRoundTrip()
+    {
+        QFETCH(Lib7z::Compression, level);
+
+        QTemporaryDir sourceDir;
+        QVERIFY(sourceDir.isValid());
+        QHash<QString, QByteArray> contents;
+        QRandomGenerator generator(11);
+        QByteArray random(3 * 1024 * 1024, Qt::Uninitialized);
+        for (int i = 0; i < random.size(); ++i)
+            random[i] = char(generator.bounded(256));
+        contents.insert(QLatin1String("random.bin"), random);
+        contents.insert(QLatin1String("text.txt"), QByteArray("Zstandard round trip. ").repeated(50000));
+        contents.insert(QLatin1String("empty.txt"), QByteArray());
+        contents.insert(QLatin1String("sub/small.txt"), QByteArray("small"));
+        for (auto it = contents.constBegin(); it != contents.constEnd(); ++it)
+            writeFile(sourceDir.path() + QLatin1Char('/') + it.key(), it.value());
+
+        QTemporaryDir archiveDir;
+        QVERIFY(archiveDir.isValid());
+        const QString archiveName = archiveDir.path() + QLatin1String("/zstd.7z");
+        const QStringList sources(sourceDir.path() + QLatin1String("/*"));
+        if (!Lib7z::isSupportedMethod(Lib7z::Method::Zstd)) {
+            QVERIFY_EXCEPTION_THROWN(Lib7z::createArchive(archiveName, sources, Lib7z::TmpFile::No,
+                level, Lib7z::Method::Zstd), Lib7z::SevenZipException);
+            QSKIP("Zstandard support is not built, see IFW_ZSTD.");
+        }
+        Lib7z::createArchive(archiveName, sources, Lib7z::TmpFile::No, level, Lib7z::Method::Zstd);
+
+        QFile archive(archiveName);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QVERIFY(Lib7z::isSupportedArchive(&archive));
+        QCOMPARE(Lib7z::listArchive(&archive).count(), contents.count() + 1); // and "sub"
+
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        QVERIFY(archive.seek(0));
+        Lib7z::extractArchive(&archive, targetDir.path());
+        for (auto it = contents.constBegin(); it != contents.constEnd(); ++it) {
+            QFile file(targetDir.path() + QLatin1Char('/') + it.key());
+            QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.fileName()));
+            QCOMPARE(file.readAll(), it.value());
+        }
+    }
+
+    void benchmarkExtractMethods_data()
+    {
+        QTest::addColumn<Lib7z::Method>("method");
+        QTest::newRow("lzma2") << Lib7z::Method::Lzma2;
+        QTest::newRow("zstd") << Lib7z::Method::Zstd;
+    }
+
+    void benchmarkExtractMethods()
+    {
+        // Compares the extraction speed of the compression methods, on archives created from
+        // the same IFW_LIB7Z_BENCHMARK_SIZE MiB of data with normal compression.
+        const int size = qEnvironmentVariableIntValue("IFW_LIB7Z_BENCHMARK_SIZE");
+        if (size <= 0)
+            QSKIP("Set IFW_LIB7Z_BENCHMARK_SIZE to run the benchmark.");
+
+        QFETCH(Lib7z::Method, method);
+        if (!Lib7z::isSupportedMethod(method))
+            QSKIP("The compression method is not supported by this build.");
+        if (m_benchmarkArchive.isEmpty())
+            QVERIFY(createBenchmarkArchive(size));
+
+        const QString archiveName = QString::fromLatin1("%1/method%2.7z").arg(m_benchmarkDir.path())
+            .arg(int(method));
+        if (!QFileInfo::exists(archiveName)) {
+            Lib7z::createArchive(archiveName, QStringList() << m_benchmarkDir.path()
+                + QLatin1String("/source/*"), Lib7z::TmpFile::No, Lib7z::Compression::Normal, method);
+        }
+
+        QFile archive(archiveName);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        qInfo("archive size: %lld bytes", archive.size());
+        QElapsedTimer timer;
+        int runs = 0;
+        timer.start();
+        QBENCHMARK {
+            QTemporaryDir targetDir(m_benchmarkDir.path() + QLatin1String("/extract-XXXXXX"));
+            QVERIFY(targetDir.isValid());
+            QVERIFY(archive.seek(0));
+            Lib7z::extractArchive(&archive, targetDir.path());
+            ++runs;
+        }
+        qInfo("%.1f MiB/s", double(size) * runs * 1000 / qMax<qint64>(1, timer.elapsed()));
+    }
+
+private:
+    void writeFile(const QString &fileName, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(fileName).absolutePath());
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(data), qint64(data.size()));
+    }
+
+    bool createBenchmarkArchive(int sizeInMiB)
+    {
+        if (!m_benchmarkDir.isValid())
+            return false;
+
+        // compressible, but not trivially, content split into files of 64 MiB
+        const QString sourceDir = m_benchmarkDir.path() + QLatin1String("/source");
+        QRandomGenerator generator(42);
+        QByteArray words;
+        for (int i = 0; i < 4096; ++i)
+            words += QByteArray::number(generator.generate(), 36) + ' ';
+
+        const qint64 fileSize = 64 * 1024 * 1024;
+        qint64 remaining = qint64(sizeInMiB) * 1024 * 1024;
+        for (int i = 0; remaining > 0; ++i) {
+            QByteArray data;
+            data.reserve(int(qMin(remaining, fileSize)));
+            while (data.size() < qMin(remaining, fileSize)) {
+                const int offset = int(generator.bounded(words.size() / 2));
+                data += words.mid(offset, int(generator.bounded(64, words.size() / 2)));
+            }
+            data.truncate(int(qMin(remaining, fileSize)));
+            writeFile(QString::fromLatin1("%1/file%2.txt").arg(sourceDir).arg(i), data);
+            remaining -= data.size();
+        }
+
+        m_benchmarkArchive = m_benchmarkDir.path() + QLatin1String("/benchmark.7z");
+        try {
+            Lib7z::createArchive(m_benchmarkArchive, QStringList() << sourceDir + QLatin1String("/*"),
+                Lib7z::TmpFile::No, Lib7z::Compression::Fastest);
+        } catch (const Lib7z::SevenZipException &e) {
+            qWarning() << e.message();
+            m_benchmarkArchive.clear();
+            return false;
+        }
+        return true;
+    }
+
 private:
     QString tempSourceFile(const QByteArray &data, const QString &templateName = QString())
     {
@@ -168,6 +661,8 @@ private:
 
 private:
     Lib7z::File m_file;
+    QTemporaryDir m_benchmarkDir;
+    QString m_benchmarkArchive;
 };
 
 QTEST_MAIN(tst_lib7zfacade)
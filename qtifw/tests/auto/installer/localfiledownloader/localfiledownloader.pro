@@ -0,0 +1,3 @@
+include(../../qttest.pri)
+
+SOURCES += tst_localfiledownloader.cpp
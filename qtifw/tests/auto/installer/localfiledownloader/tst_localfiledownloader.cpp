@@ -0,0 +1,143 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <filedownloader.h>
+#include <filedownloaderfactory.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDUpdater;
+
+class tst_LocalFileDownloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    FileDownloader *createDownloader(const QString &source, const QString &fileName)
+    {
+        FileDownloader *downloader = FileDownloaderFactory::instance().create(QLatin1String("file"));
+        downloader->setUrl(QUrl::fromLocalFile(source));
+        downloader->setDownloadedFileName(fileName);
+        downloader->setAutoRemoveDownloadedFile(false);
+        return downloader;
+    }
+
+    QByteArray fileContent(int size)
+    {
+        QByteArray content;
+        content.reserve(size);
+        for (int i = 0; i < size; ++i)
+            content.append(char(i % 251));
+        return content;
+    }
+
+private slots:
+    void testCopy_data()
+    {
+        QTest::addColumn<QString>("sourceDirectory");
+        QTest::addColumn<int>("size");
+
+        // larger than the copy block size, so the file is copied in several chunks
+        QTest::newRow("same file system") << QDir::tempPath() << 20 * 1024 * 1024 + 17;
+        QTest::newRow("empty file") << QDir::tempPath() << 0;
+#ifdef Q_OS_LINUX
+        // copy_file_range() refuses to copy across file systems, sendfile() takes over
+        QTest::newRow("different file system") << QString::fromLatin1("/dev/shm")
+            << 20 * 1024 * 1024 + 17;
+#endif
+    }
+
+    void testCopy()
+    {
+        QFETCH(QString, sourceDirectory);
+        QFETCH(int, size);
+
+        if (!QFileInfo(sourceDirectory).isWritable())
+            QSKIP("Source directory is not writable.");
+        QTemporaryDir sourceDir(sourceDirectory + QLatin1String("/localfiledownloader-XXXXXX"));
+        QVERIFY(sourceDir.isValid());
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+
+        const QByteArray content = fileContent(size);
+        const QString source = sourceDir.path() + QLatin1String("/archive.7z");
+        {
+            QFile file(source);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QCOMPARE(file.write(content), qint64(content.size()));
+        }
+
+        const QString target = targetDir.path() + QLatin1String("/archive.7z");
+        QScopedPointer<FileDownloader> downloader(createDownloader(source, target));
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 30000);
+
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.size(), qint64(size));
+        QVERIFY(file.readAll() == content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+
+#ifdef Q_OS_LINUX
+    void testCopyFileWithoutSize()
+    {
+        // Files in /proc report a size of zero, but do have contents.
+        QFile proc(QLatin1String("/proc/version"));
+        QVERIFY(proc.open(QIODevice::ReadOnly));
+        QCOMPARE(proc.size(), qint64(0));
+        const QByteArray content = proc.readAll();
+        QVERIFY(!content.isEmpty());
+
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        const QString target = targetDir.path() + QLatin1String("/version");
+        QScopedPointer<FileDownloader> downloader(createDownloader(proc.fileName(), target));
+        QSignalSpy completed(downloader.data(), &FileDownloader::downloadCompleted);
+        downloader->download();
+        QTRY_COMPARE_WITH_TIMEOUT(completed.count(), 1, 10000);
+
+        QFile file(target);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+        QCOMPARE(downloader->sha1Sum(), QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+#endif
+};
+
+QTEST_MAIN(tst_LocalFileDownloader)
+
+#include "tst_localfiledownloader.moc"
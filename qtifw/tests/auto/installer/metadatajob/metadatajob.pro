@@ -1,6 +1,6 @@
 include(../../qttest.pri)
 
-QT += qml
+QT += qml network
 
 SOURCES += tst_metadatajob.cpp
 
@@ -33,9 +33,13 @@
 #include <component.h>
 #include <errors.h>
 #include <fileutils.h>
+#include <mirrorselector.h>
 #include <packagemanagercore.h>
 #include <progresscoordinator.h>
 
+#include "../shared/localhttpserver.h"
+
+#include <QTemporaryDir>
 #include <QTest>
 
 using namespace QInstaller;
@@ -100,6 +104,179 @@ private slots:
         metadata.waitForFinished();
         QCOMPARE(metadata.metadata().count(), 1);
     }
+
+    void testConditionalUpdatesXmlFetch()
+    {
+        QFile updatesXml(":///data/repository/Updates.xml");
+        QVERIFY(updatesXml.open(QIODevice::ReadOnly));
+        const QByteArray content = updatesXml.readAll();
+
+        LocalHttpServer server;
+        server.addFile("repository/Updates.xml", content);
+        QVERIFY(server.start());
+
+        QTemporaryDir cacheDir;
+        QVERIFY(cacheDir.isValid());
+
+        Settings settings = Settings::fromFileAndPrefix(":///data/config.xml", ":///data");
+        PackageManagerCore core;
+        core.setInstaller();
+        QSet<Repository> repoList;
+        repoList.insert(Repository::fromUserInput(server.url("repository")));
+        core.settings().setDefaultRepositories(repoList);
+
+        {
+            MetadataJob metadata;
+            metadata.setPackageManagerCore(&core);
+            metadata.setCacheDirectory(cacheDir.path());
+            metadata.start();
+            metadata.waitForFinished();
+            QCOMPARE(metadata.metadata().count(), 1);
+        }
+        QCOMPARE(server.requests().count(), 1);
+        QCOMPARE(server.requests().first().path, QByteArray("/repository/Updates.xml"));
+        QCOMPARE(server.requests().first().headers.value("cache-control"), QByteArray("no-cache"));
+        QVERIFY(!server.requests().first().headers.contains("if-none-match"));
+        server.clearRequests();
+
+        // A new job, as after an installer restart, revalidates the cached copy.
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        metadata.setCacheDirectory(cacheDir.path());
+        metadata.start();
+        metadata.waitForFinished();
+        QCOMPARE(metadata.error(), int(Job::NoError));
+        QCOMPARE(metadata.metadata().count(), 1);
+        QCOMPARE(server.requests().count(), 1);
+        QCOMPARE(server.requests().first().headers.value("if-none-match"),
+            LocalHttpServer::eTag(content));
+
+        QFile fetched(metadata.metadata().first().directory + QLatin1String("/Updates.xml"));
+        QVERIFY(fetched.open(QIODevice::ReadOnly));
+        QCOMPARE(fetched.readAll(), content);
+    }
+
+    void testMetaCache()
+    {
+        QFile updatesXml(":///data/repository/Updates.xml");
+        QVERIFY(updatesXml.open(QIODevice::ReadOnly));
+        QFile metaArchive(":///data/repository/C/1.0.0-1meta.7z");
+        QVERIFY(metaArchive.open(QIODevice::ReadOnly));
+
+        LocalHttpServer server;
+        server.addFile("repository/Updates.xml", updatesXml.readAll());
+        server.addFile("repository/C/1.0.0-1meta.7z", metaArchive.readAll());
+        QVERIFY(server.start());
+
+        QTemporaryDir cacheDir;
+        QVERIFY(cacheDir.isValid());
+
+        Settings settings = Settings::fromFileAndPrefix(":///data/config.xml", ":///data");
+        PackageManagerCore core;
+        core.setInstaller();
+        QSet<Repository> repoList;
+        repoList.insert(Repository::fromUserInput(server.url("repository")));
+        core.settings().setDefaultRepositories(repoList);
+
+        // Cache miss, the meta archive is downloaded and stored.
+        {
+            MetadataJob metadata;
+            metadata.setPackageManagerCore(&core);
+            metadata.setCacheDirectory(cacheDir.path());
+            metadata.start();
+            metadata.waitForFinished();
+            QCOMPARE(metadata.error(), int(Job::NoError));
+            QCOMPARE(metadata.metadata().count(), 1);
+            QVERIFY(QFileInfo(metadata.metadata().first().directory + QLatin1String("/C")).isDir());
+        }
+        QCOMPARE(server.requests().count(), 2);
+        QCOMPARE(server.requests().last().path, QByteArray("/repository/C/1.0.0-1meta.7z"));
+        QVERIFY(QFileInfo(cacheDir.path() + QLatin1String("/meta/5b3939da1af492382c68388fc796837e4c36b876")).isDir());
+        server.clearRequests();
+
+        // Updates.xml is answered with 304 Not Modified and the meta data comes from the cache.
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        metadata.setCacheDirectory(cacheDir.path());
+        metadata.start();
+        metadata.waitForFinished();
+        QCOMPARE(metadata.error(), int(Job::NoError));
+        QCOMPARE(metadata.metadata().count(), 1);
+        QVERIFY(QFileInfo(metadata.metadata().first().directory + QLatin1String("/C")).isDir());
+        QCOMPARE(server.requests().count(), 1);
+        QCOMPARE(server.requests().first().path, QByteArray("/repository/Updates.xml"));
+        QVERIFY(server.requests().first().headers.contains("if-none-match"));
+    }
+
+    void testConditionalFetchFromMirror()
+    {
+        QFile updatesXml(":///data/repository/Updates.xml");
+        QVERIFY(updatesXml.open(QIODevice::ReadOnly));
+        const QByteArray content = updatesXml.readAll();
+
+        // The repository URL itself is unreachable, so the mirror is chosen.
+        LocalHttpServer server;
+        server.addFile("mirror/Updates.xml", content);
+        QVERIFY(server.start());
+
+        QTemporaryDir cacheDir;
+        QVERIFY(cacheDir.isValid());
+
+        Settings settings = Settings::fromFileAndPrefix(":///data/config.xml", ":///data");
+        PackageManagerCore core;
+        core.setInstaller();
+        Repository repo = Repository::fromUserInput(server.url("repository"));
+        repo.setMirrors(QList<QUrl>() << QUrl(server.url("mirror")));
+        QSet<Repository> repoList;
+        repoList.insert(repo);
+        core.settings().setDefaultRepositories(repoList);
+
+        MirrorSelector selector;
+        {
+            MetadataJob metadata;
+            metadata.setPackageManagerCore(&core);
+            metadata.setMirrorSelector(&selector);
+            metadata.addDownloadType(DownloadType::UpdatesXML);
+            metadata.setCacheDirectory(cacheDir.path());
+            metadata.start();
+            metadata.waitForFinished();
+            QCOMPARE(metadata.error(), int(Job::NoError));
+        }
+        QCOMPARE(server.requests().last().path, QByteArray("/mirror/Updates.xml"));
+        server.clearRequests();
+
+        // The validators returned by the mirror are sent to the mirror...
+        {
+            MetadataJob metadata;
+            metadata.setPackageManagerCore(&core);
+            metadata.setMirrorSelector(&selector);
+            metadata.addDownloadType(DownloadType::UpdatesXML);
+            metadata.setCacheDirectory(cacheDir.path());
+            metadata.start();
+            metadata.waitForFinished();
+            QCOMPARE(metadata.error(), int(Job::NoError));
+            QCOMPARE(metadata.metadata().count(), 1);
+        }
+        QCOMPARE(server.requests().count(), 1);
+        QCOMPARE(server.requests().first().path, QByteArray("/mirror/Updates.xml"));
+        QCOMPARE(server.requests().first().headers.value("if-none-match"),
+            LocalHttpServer::eTag(content));
+        server.clearRequests();
+
+        // ...but never to the repository URL itself.
+        server.addFile("repository/Updates.xml", content);
+        MetadataJob metadata;
+        metadata.setPackageManagerCore(&core);
+        metadata.addDownloadType(DownloadType::UpdatesXML);
+        metadata.setCacheDirectory(cacheDir.path());
+        metadata.start();
+        metadata.waitForFinished();
+        QCOMPARE(metadata.error(), int(Job::NoError));
+        QCOMPARE(metadata.metadata().count(), 1);
+        QCOMPARE(server.requests().count(), 1);
+        QCOMPARE(server.requests().first().path, QByteArray("/repository/Updates.xml"));
+        QVERIFY(!server.requests().first().headers.contains("if-none-match"));
+    }
 };
 
 
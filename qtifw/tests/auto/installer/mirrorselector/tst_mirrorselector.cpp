@@ -0,0 +1,138 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include "../shared/localhttpserver.h"
+
+#include <mirrorselector.h>
+#include <repository.h>
+
+#include <QSignalSpy>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_MirrorSelector : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRanking()
+    {
+        LocalHttpServer primary;    // serves no Updates.xml, so it is unreachable
+        LocalHttpServer mirror;
+        mirror.addFile("repository/Updates.xml", "<Updates/>");
+        QVERIFY(primary.start());
+        QVERIFY(mirror.start());
+
+        Repository repository(QUrl(primary.url("repository")), true);
+        repository.setMirrors(QList<QUrl>() << QUrl(mirror.url("repository")));
+
+        MirrorSelector selector;
+        QVERIFY(!selector.isProbed(repository.url()));
+        QSignalSpy spy(&selector, &MirrorSelector::finished);
+        selector.probe(QList<Repository>() << repository, nullptr);
+        QVERIFY(selector.isProbing());
+        QVERIFY(spy.wait());
+
+        QVERIFY(selector.isProbed(repository.url()));
+        QCOMPARE(selector.preferredUrl(repository.url()), QUrl(mirror.url("repository")));
+
+        const QList<MirrorSelector::Measurement> measurements = selector.measurements(repository.url());
+        QCOMPARE(measurements.count(), 2);
+        QVERIFY(measurements.at(0).reachable);
+        QVERIFY(measurements.at(0).latency >= 0);
+        QVERIFY(!measurements.at(1).reachable);
+
+        QCOMPARE(mirror.requests().count(), 1);
+        QCOMPARE(mirror.requests().first().path, QByteArray("/repository/Updates.xml"));
+        QCOMPARE(mirror.requests().first().headers.value("cache-control"), QByteArray("no-cache"));
+    }
+
+    void testMirrorUrl()
+    {
+        LocalHttpServer primary;
+        LocalHttpServer mirror;
+        primary.addFile("repository/Updates.xml", "<Updates/>");
+        mirror.addFile("repository/Updates.xml", "<Updates/>");
+        QVERIFY(primary.start());
+        QVERIFY(mirror.start());
+
+        Repository repository(QUrl(primary.url("repository")), true);
+        repository.setMirrors(QList<QUrl>() << QUrl(mirror.url("repository")));
+
+        MirrorSelector selector;
+        QSignalSpy spy(&selector, &MirrorSelector::finished);
+        selector.probe(QList<Repository>() << repository, nullptr);
+        QVERIFY(spy.wait());
+
+        const QString archive = primary.url("repository/A/1.0.0content.7z");
+        QCOMPARE(selector.mirrorCount(archive), 2);
+        QStringList urls;
+        urls << selector.mirrorUrl(archive, 0) << selector.mirrorUrl(archive, 1);
+        QVERIFY(urls.contains(archive));
+        QVERIFY(urls.contains(mirror.url("repository/A/1.0.0content.7z")));
+        QCOMPARE(selector.mirrorUrl(archive, 0),
+            selector.preferredUrl(repository.url()).toString() + QLatin1String("/A/1.0.0content.7z"));
+        QVERIFY(selector.mirrorUrl(archive, 2).isEmpty());
+
+        // URLs outside of probed repositories are left alone.
+        const QString other = QLatin1String("http://example.com/repository/A/1.0.0content.7z");
+        QCOMPARE(selector.mirrorCount(other), 1);
+        QCOMPARE(selector.mirrorUrl(other, 0), other);
+        QVERIFY(selector.mirrorUrl(other, 1).isEmpty());
+    }
+
+    void testTimeout()
+    {
+        QTcpServer silent;  // accepts connections but never answers
+        QVERIFY(silent.listen(QHostAddress::LocalHost));
+        LocalHttpServer mirror;
+        QVERIFY(mirror.start());
+
+        const QUrl url(QString::fromLatin1("http://127.0.0.1:%1/repository").arg(silent.serverPort()));
+        Repository repository(url, true);
+        repository.setMirrors(QList<QUrl>() << QUrl(mirror.url("repository")));
+
+        MirrorSelector selector;
+        selector.setTimeout(200);
+        QSignalSpy spy(&selector, &MirrorSelector::finished);
+        selector.probe(QList<Repository>() << repository, nullptr);
+        QVERIFY(spy.wait(5000));
+        QVERIFY(!selector.isProbing());
+
+        // Neither answered successfully, the declared order is kept.
+        QCOMPARE(selector.preferredUrl(url), url);
+        foreach (const MirrorSelector::Measurement &measurement, selector.measurements(url))
+            QVERIFY(!measurement.reachable);
+    }
+};
+
+QTEST_MAIN(tst_MirrorSelector)
+
+#include "tst_mirrorselector.moc"
@@ -40,6 +40,7 @@
 #include <QTemporaryFile>
 #include <QTest>
 #include <QRegularExpression>
+#include <QtConcurrentRun>
 
 using namespace QInstaller;
 
@@ -227,6 +228,108 @@ private slots:
         }
     }
 
+    void testComponentByNameIndex()
+    {
+        PackageManagerCore core;
+        core.setPackageManager();
+
+        Component *root = new NamedComponent(&core, QLatin1String("root"));
+        core.appendRootComponent(root);
+        QCOMPARE(core.componentByName(QLatin1String("root")), root);
+        QVERIFY(core.componentByName(QLatin1String("root.child")) == 0);
+
+        // the index follows children added after a lookup
+        Component *child = new NamedComponent(&core, QLatin1String("root.child"),
+            QLatin1String("2.0.0"));
+        root->appendComponent(child);
+        QCOMPARE(core.componentByName(QLatin1String("root.child")), child);
+        QCOMPARE(core.componentByName(QLatin1String("root.child->=2.0.0")), child);
+        QVERIFY(core.componentByName(QLatin1String("root.child->2.0.0")) == 0);
+
+        // renamed and removed components
+        child->setValue(scName, QLatin1String("root.renamed"));
+        QVERIFY(core.componentByName(QLatin1String("root.child")) == 0);
+        QCOMPARE(core.componentByName(QLatin1String("root.renamed")), child);
+        root->removeComponent(child);
+        QVERIFY(core.componentByName(QLatin1String("root.renamed")) == 0);
+        delete child;
+
+        // with equal names, the first component matching the version is returned
+        Component *older = new NamedComponent(&core, QLatin1String("twin"), QLatin1String("1.0.0"));
+        Component *newer = new NamedComponent(&core, QLatin1String("twin"), QLatin1String("3.0.0"));
+        root->appendComponent(older);
+        root->appendComponent(newer);
+        QCOMPARE(core.componentByName(QLatin1String("twin")), core.components(
+            PackageManagerCore::ComponentType::AllNoReplacements).at(1));
+        QCOMPARE(core.componentByName(QLatin1String("twin->=2.0.0")), newer);
+        QCOMPARE(core.componentByName(QLatin1String("twin-<2.0.0")), older);
+
+        // a deleted component is removed from the index
+        QCOMPARE(core.componentByName(QLatin1String("twin->=2.0.0")), newer);
+        delete newer;
+        QVERIFY(core.componentByName(QLatin1String("twin->=2.0.0")) == 0);
+        QCOMPARE(core.componentByName(QLatin1String("twin")), older);
+    }
+
+    void testComponentByNameFromThreads()
+    {
+        PackageManagerCore core;
+        core.setPackageManager();
+        Component *root = new NamedComponent(&core, QLatin1String("root"));
+        core.appendRootComponent(root);
+        QList<Component *> children;
+        for (int i = 0; i < 100; ++i) {
+            children.append(new NamedComponent(&core, QString::fromLatin1("root.child%1").arg(i)));
+            root->appendComponent(children.last());
+        }
+
+        // lookups from worker threads while the index is rebuilt
+        const auto lookup = [&core, &children]() {
+            for (int run = 0; run < 100; ++run) {
+                for (int i = 0; i < children.count(); ++i) {
+                    if (core.componentByName(QString::fromLatin1("root.child%1").arg(i))
+                            != children.at(i)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+        QList<QFuture<bool> > lookups;
+        for (int i = 0; i < 4; ++i)
+            lookups.append(QtConcurrent::run(lookup));
+        for (int i = 0; i < 1000; ++i)
+            core.invalidateComponentIndex();
+        foreach (QFuture<bool> result, lookups)
+            QVERIFY(result.result());
+    }
+
+    void benchmarkComponentByName()
+    {
+        // 10000 synthetic components, 100 root components with 99 children each
+        PackageManagerCore core;
+        core.setPackageManager();
+        QStringList names;
+        for (int i = 0; i < 100; ++i) {
+            const QString rootName = QString::fromLatin1("root%1").arg(i);
+            Component *root = new NamedComponent(&core, rootName);
+            names.append(rootName);
+            for (int j = 0; j < 99; ++j) {
+                const QString childName = QString::fromLatin1("%1.child%2").arg(rootName).arg(j);
+                root->appendComponent(new NamedComponent(&core, childName));
+                names.append(childName);
+            }
+            core.appendRootComponent(root);
+        }
+        QCOMPARE(core.components(PackageManagerCore::ComponentType::AllNoReplacements).count(),
+            10000);
+
+        QBENCHMARK {
+            foreach (const QString &name, names)
+                QVERIFY(core.componentByName(name) != 0);
+        }
+    }
+
     void testRequiredDiskSpace()
     {
         // test installer
@@ -117,6 +117,40 @@ private slots:
         QCOMPARE(r1, r2);
     }
 
+    void testRepositoryMirrorsRoundTrip()
+    {
+        Repository repo(QUrl("http://example.com/repository"), false);
+        repo.setUsername("tester");
+        repo.setMirrors(QList<QUrl>() << QUrl("http://mirror1.example.com/repository")
+            << QUrl("https://mirror2.example.com/repository?a=1"));
+
+        // QDataStream operators
+        QByteArray data;
+        {
+            QDataStream out(&data, QIODevice::WriteOnly);
+            out << repo << Repository(QUrl("http://example.com/plain"), false);
+        }
+        QDataStream in(data);
+        Repository restored, plain;
+        in >> restored >> plain;
+        QCOMPARE(in.status(), QDataStream::Ok);
+        QCOMPARE(restored, repo);
+        QCOMPARE(restored.username(), QString("tester"));
+        QCOMPARE(restored.mirrors(), repo.mirrors());
+        QCOMPARE(plain.url(), QUrl("http://example.com/plain"));
+        QCOMPARE(plain.mirrors(), QList<QUrl>());
+
+        // user repositories stored in the settings
+        Settings settings;
+        settings.setUserRepositories(QSet<Repository>() << repo);
+        QCOMPARE(settings.userRepositories().values().at(0).mirrors(), repo.mirrors());
+        settings.addUserRepositories(QSet<Repository>() << plain);
+        foreach (const Repository &userRepo, settings.userRepositories()) {
+            QCOMPARE(userRepo.mirrors(), userRepo.url() == repo.url() ? repo.mirrors()
+                : QList<QUrl>());
+        }
+    }
+
     void testUpdateRepositoryCategories()
     {
         Settings settings;
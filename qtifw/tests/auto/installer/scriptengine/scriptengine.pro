@@ -7,4 +7,5 @@ SOURCES += tst_scriptengine.cpp
 DEFINES += "BUILDDIR=\\\"$$OUT_PWD\\\""
 
 RESOURCES += \
-    scriptengine.qrc
+    scriptengine.qrc \
+    ..\shared\config.qrc
@@ -26,6 +26,8 @@
 **
 **************************************************************************/
 
+#include "../shared/packagemanager.h"
+
 #include <component.h>
 #include <errors.h>
 #include <updateoperation.h>
@@ -427,6 +429,23 @@ private slots:
         }
     }
 
+    void loadPostLoadComponentScript()
+    {
+        QTemporaryDir targetDir;
+        QVERIFY(targetDir.isValid());
+        QScopedPointer<PackageManagerCore> core(PackageManager::getPackageManagerWithInit
+            (targetDir.path(), ":///data/postloadrepository"));
+
+        // the script of A resolves Default=script and creates the operations of A, the script
+        // of B is never needed
+        QCOMPARE(core->installDefaultComponentsSilently(), PackageManagerCore::Success);
+        QCOMPARE(core->value("postLoadComponentALoaded"), QString("true"));
+        QVERIFY(core->value("postLoadComponentBLoaded").isEmpty());
+        QVERIFY(core->componentByName("A")->isInstalled());
+        QVERIFY(!core->componentByName("B")->isInstalled());
+        QVERIFY(QDir(targetDir.path() + QLatin1String("/postload")).exists());
+    }
+
     void loadComponentUserInterfaces()
     {
        try {
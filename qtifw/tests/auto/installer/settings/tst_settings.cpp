@@ -126,6 +126,8 @@ void tst_Settings::loadTutorialConfig()
     QCOMPARE(settings.controlScript(), QString());
 
     QCOMPARE(settings.supportsModify(), true);
+    QCOMPARE(settings.pipelinedInstallation(), false);
+    QCOMPARE(settings.maxSegmentsPerDownload(), 1);
 }
 
 void tst_Settings::loadFullConfig()
@@ -0,0 +1,224 @@
+/**************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#ifndef LOCALHTTPSERVER_H
+#define LOCALHTTPSERVER_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+/*
+    Minimal HTTP/1.1 server to test downloads against. Serves the files added with addFile()
+    with an ETag, supports byte ranges, If-Range and If-None-Match and can drop a connection in the middle of
+    the response to simulate a network failure, or answer requests for a file with a server error.
+    Every connection is closed after one response.
+*/
+class LocalHttpServer : public QTcpServer
+{
+public:
+    struct Request
+    {
+        QByteArray method;
+        QByteArray path;
+        QHash<QByteArray, QByteArray> headers;
+    };
+
+    LocalHttpServer()
+        : m_acceptRanges(true)
+        , m_dropConnectionAfter(-1)
+        , m_openConnections(0)
+        , m_maxOpenConnections(0)
+    {
+        connect(this, &QTcpServer::newConnection, [this]() {
+            while (QTcpSocket *socket = nextPendingConnection()) {
+                QPointer<QTcpSocket> guard(socket);
+                m_maxOpenConnections = qMax(m_maxOpenConnections, ++m_openConnections);
+                connect(socket, &QTcpSocket::disconnected, [this]() { --m_openConnections; });
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                connect(socket, &QTcpSocket::readyRead, [this, guard]() {
+                    if (guard)
+                        handleRequest(guard);
+                });
+            }
+        });
+    }
+
+    bool start() { return listen(QHostAddress::LocalHost); }
+
+    QString url(const QByteArray &path) const
+    {
+        return QString::fromLatin1("http://127.0.0.1:%1/%2").arg(serverPort())
+            .arg(QString::fromLatin1(path));
+    }
+
+    void addFile(const QByteArray &path, const QByteArray &content)
+    {
+        m_files.insert('/' + path, content);
+    }
+
+    void setAcceptRanges(bool accept) { m_acceptRanges = accept; }
+
+    // Answers the next \a count requests for \a path with 503 Service Unavailable.
+    void failNextRequests(const QByteArray &path, int count) { m_failures.insert('/' + path, count); }
+
+    // Sends \a body with error responses, like the error page of a real server.
+    void setErrorBody(const QByteArray &body) { m_errorBody = body; }
+
+    // Closes the connection of the next response after \a bytes of the body have been sent.
+    void setDropConnectionAfter(qint64 bytes) { m_dropConnectionAfter = bytes; }
+
+    QList<Request> requests() const { return m_requests; }
+    void clearRequests() { m_requests.clear(); }
+
+    // The highest number of connections that were open at the same time.
+    int maxOpenConnections() const { return m_maxOpenConnections; }
+
+    static QByteArray eTag(const QByteArray &content)
+    {
+        return '"' + QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex() + '"';
+    }
+
+private:
+    void handleRequest(QTcpSocket *socket)
+    {
+        QByteArray &buffer = m_buffers[socket];
+        buffer += socket->readAll();
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        m_buffers.remove(socket);
+
+        Request request;
+        const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        request.method = requestLine.value(0);
+        request.path = requestLine.value(1);
+        for (int i = 1; i < lines.count(); ++i) {
+            const int colon = lines.at(i).indexOf(':');
+            if (colon > 0) {
+                request.headers.insert(lines.at(i).left(colon).trimmed().toLower(),
+                    lines.at(i).mid(colon + 1).trimmed());
+            }
+        }
+        m_requests.append(request);
+
+        const int query = request.path.indexOf('?');
+        const QByteArray path = query < 0 ? request.path : request.path.left(query);
+        if (m_failures.value(path) > 0) {
+            --m_failures[path];
+            writeError(socket, "503 Service Unavailable");
+            return;
+        }
+        if (!m_files.contains(path)) {
+            writeError(socket, "404 Not Found");
+            return;
+        }
+
+        const QByteArray content = m_files.value(path);
+        const QByteArray tag = eTag(content);
+        if (request.headers.value("if-none-match") == tag) {
+            socket->write("HTTP/1.1 304 Not Modified\r\nETag: " + tag + "\r\nContent-Length: 0\r\n"
+                "Connection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+
+        bool partial = false;
+        qint64 first = 0;
+        qint64 last = content.size() - 1;
+        const QByteArray range = request.headers.value("range");
+        const QByteArray ifRange = request.headers.value("if-range");
+        if (m_acceptRanges && range.startsWith("bytes=") && (ifRange.isEmpty() || ifRange == tag)) {
+            const QList<QByteArray> bounds = range.mid(6).split('-');
+            first = bounds.value(0).toLongLong();
+            if (!bounds.value(1).isEmpty())
+                last = qMin(last, bounds.value(1).toLongLong());
+            if (first >= content.size() || first > last) {
+                writeError(socket, "416 Range Not Satisfiable");
+                return;
+            }
+            partial = true;
+        }
+
+        const QByteArray body = content.mid(first, last - first + 1);
+        QByteArray header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        if (partial) {
+            header += "Content-Range: bytes " + QByteArray::number(first) + '-'
+                + QByteArray::number(last) + '/' + QByteArray::number(content.size()) + "\r\n";
+        }
+        if (m_acceptRanges)
+            header += "Accept-Ranges: bytes\r\n";
+        header += "ETag: " + tag + "\r\nConnection: close\r\n\r\n";
+        socket->write(header);
+        if (request.method == "HEAD") {
+            socket->disconnectFromHost();
+            return;
+        }
+
+        if (m_dropConnectionAfter >= 0) {
+            socket->write(body.left(m_dropConnectionAfter));
+            m_dropConnectionAfter = -1;
+            socket->flush();
+            socket->waitForBytesWritten(1000);
+            socket->abort();
+            socket->deleteLater();
+            return;
+        }
+        socket->write(body);
+        socket->disconnectFromHost();
+    }
+
+    void writeError(QTcpSocket *socket, const QByteArray &status)
+    {
+        socket->write("HTTP/1.1 " + status + "\r\nContent-Length: "
+            + QByteArray::number(m_errorBody.size()) + "\r\nConnection: close\r\n\r\n" + m_errorBody);
+        socket->disconnectFromHost();
+    }
+
+private:
+    bool m_acceptRanges;
+    qint64 m_dropConnectionAfter;
+    int m_openConnections;
+    int m_maxOpenConnections;
+    QHash<QByteArray, QByteArray> m_files;
+    QHash<QByteArray, int> m_failures;
+    QByteArray m_errorBody;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+    QList<Request> m_requests;
+};
+
+#endif // LOCALHTTPSERVER_H
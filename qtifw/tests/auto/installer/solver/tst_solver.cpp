@@ -34,6 +34,7 @@
 #include <packagemanagercore.h>
 #include <settings.h>
 
+#include <QRandomGenerator>
 #include <QTest>
 
 using namespace QInstaller;
@@ -141,6 +142,67 @@ private slots:
             qPrintable(cycle.first.data()));
     }
 
+    void sortGraphCycles()
+    {
+        Graph<QString> graph;
+        graph.addEdge("A", "B");
+        graph.addEdge("B", "A");
+        graph.addEdge("C", "D");
+        graph.addEdge("D", "E");
+        graph.addEdge("E", "C");
+        graph.addEdge("F", "A");
+
+        const QList<QString> resolved = graph.sort();
+        QCOMPARE(resolved.count(), 6);
+        QVERIFY(graph.hasCycle());
+        QCOMPARE(graph.cycles().count(), 2);
+        QCOMPARE(graph.cycle(), qMakePair(QString("B"), QString("A")));
+        QCOMPARE(graph.cycles().last(), qMakePair(QString("E"), QString("C")));
+    }
+
+    void sortGraphDeepChain()
+    {
+        // deeper than a recursive visit could go on the default stack
+        const int count = 1000000;
+        Graph<int> graph;
+        for (int i = 0; i < count - 1; ++i)
+            graph.addEdge(i, i + 1);
+
+        const QList<int> resolved = graph.sort();
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(resolved.count(), count);
+        QCOMPARE(resolved.first(), count - 1);
+        QCOMPARE(resolved.last(), 0);
+    }
+
+    void benchmarkSortGraph()
+    {
+        const int count = 50000;
+        QRandomGenerator random(42);
+        Graph<QString> graph;
+        for (int i = 0; i < count; ++i) {
+            const QString node = QString::fromLatin1("node%1").arg(i);
+            graph.addNode(node);
+            for (int j = 0; i > 0 && j < 4; ++j)
+                graph.addEdge(node, QString::fromLatin1("node%1").arg(random.bounded(i)));
+        }
+
+        QList<QString> resolved;
+        QBENCHMARK {
+            resolved = graph.sort();
+        }
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(resolved.count(), count);
+
+        QHash<QString, int> positions;
+        for (int i = 0; i < resolved.count(); ++i)
+            positions.insert(resolved.at(i), i);
+        foreach (const QString &node, graph.nodes()) {
+            foreach (const QString &edge, graph.edges(node))
+                QVERIFY(positions.value(edge) < positions.value(node));
+        }
+    }
+
     void resolveInstaller_data()
     {
         QTest::addColumn<PackageManagerCore *>("core");
@@ -299,6 +361,104 @@ private slots:
         delete core;
     }
 
+    void resolveRandomGraph_data()
+    {
+        QTest::addColumn<quint32>("seed");
+        for (quint32 seed = 1; seed <= 20; ++seed)
+            QTest::newRow(qPrintable(QString::fromLatin1("Seed %1").arg(seed))) << seed;
+    }
+
+    void resolveRandomGraph()
+    {
+        QFETCH(quint32, seed);
+        QRandomGenerator random(seed);
+
+        // Components only depend and auto depend on components with a lower index, so the
+        // graph has no cycles.
+        const int count = 200;
+        PackageManagerCore core;
+        core.setPackageManager();
+        QList<Component *> components;
+        for (int i = 0; i < count; ++i) {
+            NamedComponent *component = new NamedComponent(&core, QString::fromLatin1("C%1").arg(i));
+            if (i > 0) {
+                const int dependencies = random.bounded(3);
+                for (int j = 0; j < dependencies; ++j)
+                    component->addDependency(QString::fromLatin1("C%1").arg(random.bounded(i)));
+                if (random.bounded(4) == 0) {
+                    const int autoDependencies = 1 + random.bounded(2);
+                    for (int j = 0; j < autoDependencies; ++j)
+                        component->addAutoDependOn(QString::fromLatin1("C%1").arg(random.bounded(i)));
+                }
+            }
+            core.appendRootComponent(component);
+            components.append(component);
+        }
+
+        QList<Component *> selected;
+        for (int i = 0; i < 5; ++i) {
+            Component *component = components.at(random.bounded(count));
+            if (!selected.contains(component) && component->autoDependencies().isEmpty())
+                selected.append(component);
+        }
+
+        // Full fixed point of the dependencies and auto dependencies.
+        QSet<QString> expected;
+        QList<Component *> pending = selected;
+        forever {
+            while (!pending.isEmpty()) {
+                Component *component = pending.takeLast();
+                if (expected.contains(component->name()))
+                    continue;
+                expected.insert(component->name());
+                foreach (const QString &dependency, component->dependencies())
+                    pending.append(core.componentByName(dependency));
+            }
+            foreach (Component *component, components) {
+                if (expected.contains(component->name()) || component->autoDependencies().isEmpty())
+                    continue;
+                if (expected.contains(component->autoDependencies().toSet()))
+                    pending.append(component);
+            }
+            if (pending.isEmpty())
+                break;
+        }
+
+        InstallerCalculator calc(core.components(PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(calc.appendComponentsToInstall(selected));
+        const QList<Component *> result = calc.orderedComponentsToInstall();
+
+        QSet<QString> names;
+        foreach (Component *component, result) {
+            foreach (const QString &dependency, component->dependencies())
+                QVERIFY2(names.contains(dependency), qPrintable(component->name()));
+            names.insert(component->name());
+        }
+        QCOMPARE(result.count(), names.count());
+        QCOMPARE(names, expected);
+
+        // Uninstalling a component removes all installed components depending on it.
+        foreach (Component *component, result)
+            component->setInstalled();
+        Component *toUninstall = result.first();
+        QSet<Component *> expectedToUninstall;
+        pending = QList<Component *>() << toUninstall;
+        while (!pending.isEmpty()) {
+            Component *component = pending.takeLast();
+            if (expectedToUninstall.contains(component))
+                continue;
+            expectedToUninstall.insert(component);
+            foreach (Component *dependee, result) {
+                if (dependee->dependencies().contains(component->name()))
+                    pending.append(dependee);
+            }
+        }
+
+        UninstallerCalculator uninstallCalc(result);
+        uninstallCalc.appendComponentsToUninstall(QList<Component *>() << toUninstall);
+        foreach (Component *component, expectedToUninstall)
+            QVERIFY2(uninstallCalc.componentsToUninstall().contains(component), qPrintable(component->name()));
+    }
 
     void checkComponent_data()
     {
@@ -338,6 +338,34 @@ private slots:
         verifyComponentMetaUpdatesXml();
     }
 
+    void testArchiveChecksumsInUpdatesXml()
+    {
+        ignoreMessagesForComponentSha(QStringList () << "A" << "B", false);
+        generateRepo(true, false, false);
+
+        QFile updatesXml(m_repositoryDir + QDir::separator() + "Updates.xml");
+        QVERIFY(updatesXml.open(QIODevice::ReadOnly));
+        QDomDocument doc;
+        QVERIFY(doc.setContent(&updatesXml));
+
+        int archiveCount = 0;
+        const QDomNodeList packageUpdates = doc.documentElement().elementsByTagName("PackageUpdate");
+        for (int i = 0; i < packageUpdates.count(); ++i) {
+            const QDomElement update = packageUpdates.at(i).toElement();
+            const QString name = update.firstChildElement("Name").text();
+            const QDomElement archive = update.firstChildElement("ArchiveChecksums")
+                .firstChildElement("Archive");
+            QVERIFY(!archive.isNull());
+            QCOMPARE(archive.attribute("name"), QString("content.7z"));
+
+            const QString archivePath = m_repositoryDir + "/" + name + "/1.0.0content.7z";
+            QCOMPARE(archive.attribute("sha1"), VerifyInstaller::fileContent(archivePath + ".sha1"));
+            QCOMPARE(archive.attribute("size").toLongLong(), QFileInfo(archivePath).size());
+            ++archiveCount;
+        }
+        QCOMPARE(archiveCount, 2);
+    }
+
     void testWithComponentAndUniteMeta()
     {
         ignoreMessagesForComponentSha(QStringList() << "A" << "B", false);
@@ -149,9 +149,17 @@ int main(int argc, char *argv[])
                 "9 (Ultra compressing)\n"
                 "Defaults to 5 (Normal compression)."
             ), QLatin1String("5"), QLatin1String("5"));
+        const QCommandLineOption method = QCommandLineOption(QStringList()
+            << QLatin1String("m") << QLatin1String("method"),
+            QCoreApplication::translate("archivegen",
+                "lzma2 (LZMA2 compression)\n"
+                "zstd (Zstandard compression, faster to extract)\n"
+                "Defaults to lzma2."
+            ), QLatin1String("method"), QLatin1String("lzma2"));
 
         parser.addOption(verbose);
         parser.addOption(compression);
+        parser.addOption(method);
         parser.addPositionalArgument(QLatin1String("archive"),
             QCoreApplication::translate("archivegen", "Compressed archive to create."));
         parser.addPositionalArgument(QLatin1String("sources"),
@@ -183,9 +191,18 @@ int main(int argc, char *argv[])
                 "Unknown compression level \"%1\". See 'archivgen --help'.").arg(value));
         }
 
+        const QString methodName = parser.value(method).toLower();
+        Lib7z::Method compressionMethod = Lib7z::Method::Lzma2;
+        if (methodName == QLatin1String("zstd")) {
+            compressionMethod = Lib7z::Method::Zstd;
+        } else if (methodName != QLatin1String("lzma2")) {
+            throw QInstaller::Error(QCoreApplication::translate("archivegen",
+                "Unknown compression method \"%1\". See 'archivgen --help'.").arg(methodName));
+        }
+
         Lib7z::initSevenZ();
         Lib7z::createArchive(args[0], args.mid(1), Lib7z::TmpFile::No, Lib7z::Compression(value),
-            [&] () -> Lib7z::UpdateCallback * {
+            compressionMethod, [&] () -> Lib7z::UpdateCallback * {
                 if (parser.isSet(verbose))
                     return new VerbosePrinterCallback;
                 return new FailOnErrorCallback;
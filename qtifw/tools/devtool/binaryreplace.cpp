@@ -34,6 +34,7 @@
 #include <errors.h>
 #include <fileio.h>
 #include <fileutils.h>
+#include <lib7z_archive.h>
 #include <lib7z_extract.h>
 #include <lib7z_facade.h>
 #include <lib7z_list.h>
@@ -72,8 +73,9 @@ int BinaryReplace::replace(const QString &source, const QString &target)
             QFile archive(newInstallerBasePath);
             if (archive.open(QIODevice::ReadOnly)) {
                 try {
-                    Lib7z::extractArchive(&archive, QDir::tempPath());
-                    const QVector<Lib7z::File> files = Lib7z::listArchive(&archive);
+                    Lib7z::ArchiveHandle handle(&archive);
+                    handle.extract(QDir::tempPath());
+                    const QVector<Lib7z::File> files = handle.files();
                     newInstallerBasePath = QDir::tempPath() + QLatin1Char('/') + files.value(0)
                         .path;
                     result = EXIT_SUCCESS;